@@ -18,6 +18,7 @@ public:
 
 private:
   static volatile ticks_t ms_delayCount;
+  static volatile ticks_t ms_ticks;
 
 public:
   // Default constructor
@@ -33,9 +34,18 @@ public:
   static void
   sleep(ticks_t ticks);
 
+  // Milliseconds since start(), wraps after ~49 days.
+  inline static ticks_t
+  getTicks(void)
+  {
+    return ms_ticks;
+  }
+
   inline static void
   tick(void)
   {
+    ++ms_ticks;
+
     // Decrement to zero the counter used by the delay routine.
     if (ms_delayCount != 0u)
       {
@@ -15,6 +15,7 @@ extern "C" void HAL_IncTick(void);
 // ----------------------------------------------------------------------------
 
 volatile Timer::ticks_t Timer::ms_delayCount;
+volatile Timer::ticks_t Timer::ms_ticks;
 
 // ----------------------------------------------------------------------------
 
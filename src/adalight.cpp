@@ -0,0 +1,151 @@
+#include "adalight.h"
+#include <string.h>
+
+using cmdc0de::AdalightReceiver;
+using cmdc0de::SerialPort;
+using cmdc0de::TripleBuffer;
+using cmdc0de::LedBuffer;
+
+static const uint8_t Magic[3] = { 'A', 'd', 'a' };
+
+AdalightReceiver::AdalightReceiver(SerialPort *port, TripleBuffer *frames) :
+		Port(port), FrameBuffers(frames), State(HEADER), Header(), HeaderFill(0), Discard(0), PayloadBytes(0),
+				DiscardLeft(0), Phase(0), StallSeen(false), StallPhase(0), StallRemaining(0), StallTiming(false),
+				StallStart(0), Frames(0), HeaderErrors(0), Overruns(0), Stalls(0) {
+
+}
+
+AdalightReceiver::~AdalightReceiver() {
+
+}
+
+void AdalightReceiver::init(uint32_t baud, uint8_t irqPriority) {
+	Port->init(baud, USART_StopBits_1, irqPriority);
+	USART_ITConfig(Port->getUSART(), USART_IT_IDLE, ENABLE);
+	USART_ITConfig(Port->getUSART(), USART_IT_ERR, ENABLE);
+	armHeader(0);
+}
+
+// keep the first bytes of Header and read the rest of it
+void AdalightReceiver::armHeader(uint8_t keep) {
+	State = HEADER;
+	HeaderFill = keep;
+	Phase++;
+	Port->armRx(&Header[keep], HEADER_SIZE - keep, true);
+}
+
+void AdalightReceiver::resync() {
+	Port->stopRx();
+	armHeader(0);
+}
+
+void AdalightReceiver::headerReceived() {
+	uint8_t start = 0;
+	if (memcmp(Header, Magic, sizeof(Magic)) == 0 && (Header[3] ^ Header[4] ^ 0x55) == Header[5]) {
+		LedBuffer *back = FrameBuffers->getBack();
+		uint32_t room = back->getNumLeds() * 3;
+		PayloadBytes = ((Header[3] << 8 | Header[4]) + 1) * 3;
+		DiscardLeft = PayloadBytes > room ? PayloadBytes - room : 0;
+		State = PAYLOAD;
+		Phase++;
+		Port->armRx(back->getLeds(), PayloadBytes - DiscardLeft, true);
+		return;
+	}
+	HeaderErrors++;
+	// the next header can start anywhere after the first byte, keep whatever could be its beginning
+	for (start = 1; start < HEADER_SIZE; start++) {
+		uint8_t n = HEADER_SIZE - start;
+		if (n > sizeof(Magic))
+			n = sizeof(Magic);
+		if (memcmp(&Header[start], Magic, n) == 0)
+			break;
+	}
+	memmove(Header, &Header[start], HEADER_SIZE - start);
+	armHeader(HEADER_SIZE - start);
+}
+
+void AdalightReceiver::discard() {
+	uint16_t n = DiscardLeft > 0xFFFF ? 0xFFFF : DiscardLeft;
+	DiscardLeft -= n;
+	State = DISCARD;
+	Phase++;
+	Port->armRx(&Discard, n, false);
+}
+
+void AdalightReceiver::payloadReceived() {
+	if (DiscardLeft > 0) {
+		discard();
+		return;
+	}
+	LedBuffer *back = FrameBuffers->getBack();
+	uint32_t room = back->getNumLeds() * 3;
+	if (PayloadBytes < room)
+		memset(back->getLeds() + PayloadBytes, 0, room - PayloadBytes);
+	// re-arm first, the next header may already be arriving
+	armHeader(0);
+	FrameBuffers->publish();
+	Frames++;
+}
+
+void AdalightReceiver::handleDMAISR() {
+	if (!Port->rxComplete())
+		return;
+	switch (State) {
+	case HEADER:
+		headerReceived();
+		break;
+	case PAYLOAD:
+	case DISCARD:
+		payloadReceived();
+		break;
+	}
+}
+
+void AdalightReceiver::handleUSARTISR() {
+	USART_TypeDef *usart = Port->getUSART();
+	uint16_t sr = usart->SR;
+	if (!(sr & (USART_FLAG_IDLE | USART_FLAG_ORE | USART_FLAG_FE | USART_FLAG_NE)))
+		return;
+	// SR then DR clears IDLE and the error flags, the DMA has already taken the data byte
+	(void) usart->DR;
+	if (sr & USART_FLAG_ORE) {
+		Overruns++;
+		resync();
+		return;
+	}
+	if (sr & USART_FLAG_IDLE) {
+		bool midFrame = State != HEADER || HeaderFill > 0 || Port->getRxRemaining() != HEADER_SIZE;
+		if (midFrame) {
+			StallPhase = Phase;
+			StallRemaining = Port->getRxRemaining();
+			StallSeen = true;
+		}
+	}
+}
+
+void AdalightReceiver::poll(uint32_t now) {
+	if (!StallSeen)
+		return;
+	if (Phase != StallPhase || Port->getRxRemaining() != StallRemaining) {
+		// data came in after the pause
+		StallSeen = false;
+		StallTiming = false;
+		return;
+	}
+	if (!StallTiming) {
+		StallTiming = true;
+		StallStart = now;
+		return;
+	}
+	if (now - StallStart >= STALL_TIMEOUT_MS) {
+		__disable_irq();
+		// a byte may have arrived since the check above
+		if (Phase == StallPhase && Port->getRxRemaining() == StallRemaining) {
+			Stalls++;
+			resync();
+		}
+		StallSeen = false;
+		StallTiming = false;
+		__enable_irq();
+	}
+}
@@ -0,0 +1,75 @@
+#ifndef __ADALIGHT_H__
+#define __ADALIGHT_H__
+
+#include "serialport.h"
+#include "ledbuffer.h"
+
+namespace cmdc0de {
+
+/*
+ * Receives Adalight frames (Prismatik, Hyperion, Boblight...) over a USART:
+ * 	'A' 'd' 'a' count-1 high byte, count-1 low byte, high ^ low ^ 0x55, then count * R,G,B
+ *
+ * No byte is touched by the CPU. The RX DMA runs in phases, re-armed from its transfer complete interrupt:
+ * 	HEADER:  6 bytes into Header, checked and if it is not a header the buffer is scanned for the next 'A'
+ * 	         and only the missing bytes are read again
+ * 	PAYLOAD: straight into the back buffer of the TripleBuffer, publish hands it to the main loop
+ * 	DISCARD: leds beyond the buffer go into one byte with memory increment off
+ * Frames with fewer leds than the buffer leave the rest black.
+ *
+ * The IDLE line interrupt flags a frame that stopped part way. USB serial adapters can pause inside a
+ * frame, so poll (main loop) only drops it once the line has stayed quiet for STALL_TIMEOUT_MS.
+ * Overruns drop the frame at once, the header scan then finds the start of the next one.
+ */
+class AdalightReceiver {
+public:
+	static const uint8_t HEADER_SIZE = 6;
+	static const uint16_t STALL_TIMEOUT_MS = 50;
+public:
+	AdalightReceiver(SerialPort *port, TripleBuffer *frames);
+	~AdalightReceiver();
+	//priority should be above (numerically lower than) the strand DMA
+	void init(uint32_t baud, uint8_t irqPriority);
+	void handleUSARTISR();
+	void handleDMAISR();
+	void poll(uint32_t now);
+	uint32_t getFrames() const {return Frames;}
+	uint32_t getHeaderErrors() const {return HeaderErrors;}
+	uint32_t getOverruns() const {return Overruns;}
+	uint32_t getStalls() const {return Stalls;}
+protected:
+	enum STATE {
+		HEADER,
+		PAYLOAD,
+		DISCARD
+	};
+	void armHeader(uint8_t keep);
+	void headerReceived();
+	void payloadReceived();
+	void discard();
+	void resync();
+private:
+	SerialPort *Port;
+	TripleBuffer *FrameBuffers;
+	volatile STATE State;
+	uint8_t Header[HEADER_SIZE];
+	uint8_t HeaderFill;
+	uint8_t Discard;
+	uint32_t PayloadBytes;
+	uint32_t DiscardLeft;
+	//bumped every time the DMA is re-armed, lets poll tell a stalled transfer from a new one
+	volatile uint32_t Phase;
+	volatile bool StallSeen;
+	uint32_t StallPhase;
+	uint16_t StallRemaining;
+	bool StallTiming;
+	uint32_t StallStart;
+	volatile uint32_t Frames;
+	volatile uint32_t HeaderErrors;
+	volatile uint32_t Overruns;
+	volatile uint32_t Stalls;
+};
+
+} //cmdc0de
+
+#endif
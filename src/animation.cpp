@@ -0,0 +1,144 @@
+#include "animation.h"
+
+using cmdc0de::AnimationPlayer;
+using cmdc0de::LedBuffer;
+
+static inline uint16_t read16(const uint8_t *p) {
+	return p[0] | (p[1] << 8);
+}
+
+AnimationPlayer::AnimationPlayer() :
+		Effect("animation"), Data(0), Size(0), Pos(0), NumLeds(0), NumFrames(0), FrameMS(0), CurrentFrame(0),
+				NextFrame(0), Errors(0) {
+
+}
+
+AnimationPlayer::~AnimationPlayer() {
+
+}
+
+bool AnimationPlayer::load(const uint8_t *data, uint32_t size) {
+	Data = 0;
+	NumFrames = 0;
+	if (size < HEADER_SIZE || data[0] != 'L' || data[1] != 'E' || data[2] != 'D' || data[3] != 'A') {
+		return false;
+	}
+	if (read16(&data[4]) == 0 || read16(&data[6]) == 0 || read16(&data[10]) != 0) {
+		return false;
+	}
+	Data = data;
+	Size = size;
+	NumLeds = read16(&data[4]);
+	NumFrames = read16(&data[6]);
+	FrameMS = read16(&data[8]);
+	if (FrameMS == 0)
+		FrameMS = 1;
+	rewind();
+	return true;
+}
+
+void AnimationPlayer::rewind() {
+	Pos = HEADER_SIZE;
+	CurrentFrame = 0;
+}
+
+bool AnimationPlayer::decodeRaw(LedBuffer *leds, uint16_t n) {
+	if (Pos + NumLeds * 3 > Size)
+		return false;
+	const uint8_t *p = &Data[Pos];
+	for (uint16_t i = 0; i < n; i++, p += 3) {
+		leds->setLed(i, p[0], p[1], p[2]);
+	}
+	Pos += NumLeds * 3;
+	return true;
+}
+
+bool AnimationPlayer::decodeRLE(LedBuffer *leds, uint16_t n) {
+	uint16_t led = 0;
+	while (led < NumLeds) {
+		if (Pos + 4 > Size)
+			return false;
+		const uint8_t *p = &Data[Pos];
+		uint16_t count = p[0];
+		if (count == 0 || led + count > NumLeds)
+			return false;
+		for (uint16_t end = led + count; led < end; led++) {
+			if (led < n)
+				leds->setLed(led, p[1], p[2], p[3]);
+		}
+		Pos += 4;
+	}
+	return true;
+}
+
+bool AnimationPlayer::decodeDelta(LedBuffer *leds, uint16_t n) {
+	uint16_t led = 0;
+	while (led < NumLeds) {
+		if (Pos + 2 > Size)
+			return false;
+		uint16_t skip = Data[Pos];
+		uint16_t count = Data[Pos + 1];
+		Pos += 2;
+		if (led + skip + count > NumLeds || Pos + count * 3 > Size)
+			return false;
+		led += skip;
+		const uint8_t *p = &Data[Pos];
+		for (uint16_t end = led + count; led < end; led++, p += 3) {
+			if (led < n)
+				leds->setLed(led, p[0], p[1], p[2]);
+		}
+		Pos += count * 3;
+	}
+	return true;
+}
+
+bool AnimationPlayer::decodeNext(LedBuffer *leds) {
+	bool ok = false;
+	uint16_t n = NumLeds < leds->getNumLeds() ? NumLeds : leds->getNumLeds();
+
+	if (Data == 0)
+		return false;
+	if (CurrentFrame >= NumFrames)
+		rewind();
+	if (Pos < Size) {
+		uint8_t type = Data[Pos++];
+		switch (type) {
+		case FRAME_RAW:
+			ok = decodeRaw(leds, n);
+			break;
+		case FRAME_RLE:
+			ok = decodeRLE(leds, n);
+			break;
+		case FRAME_DELTA:
+			// a delta has nothing to apply to on the first frame
+			ok = CurrentFrame > 0 && decodeDelta(leds, n);
+			break;
+		default:
+			break;
+		}
+	}
+	if (!ok) {
+		Errors++;
+		rewind();
+		return false;
+	}
+	CurrentFrame++;
+	return true;
+}
+
+void AnimationPlayer::start(LedBuffer *leds, uint32_t now) {
+	rewind();
+	decodeNext(leds);
+	NextFrame = now + FrameMS;
+}
+
+void AnimationPlayer::render(LedBuffer *leds, uint32_t now) {
+	// deltas have to be applied in order, catch up at most a few frames if we fell behind
+	for (int i = 0; i < 4 && (int32_t) (now - NextFrame) >= 0; i++) {
+		NextFrame += FrameMS;
+		if (!decodeNext(leds))
+			break;
+	}
+	if ((int32_t) (now - NextFrame) >= 0)
+		NextFrame = now + FrameMS;
+}
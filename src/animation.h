@@ -0,0 +1,66 @@
+#ifndef __ANIMATION_H__
+#define __ANIMATION_H__
+
+#include "effect.h"
+
+namespace cmdc0de {
+
+/*
+ * Pre-rendered animation played back from flash (tools/animpack.cpp builds them).
+ *
+ * Format, all values little endian:
+ * 	header:	'L' 'E' 'D' 'A', uint16 numLeds, uint16 numFrames, uint16 frameMS, uint16 flags (0)
+ * 	frames:	uint8 type followed by its payload, every frame covers numLeds pixels
+ * 		FRAME_RAW:		numLeds * R,G,B
+ * 		FRAME_RLE:		runs of [count 1-255][R][G][B]
+ * 		FRAME_DELTA:	changes against the previous frame as [skip 0-255][count 0-255][count * R,G,B],
+ * 						skip leds stay as they are, a 0 count lets skips longer than 255 be chained
+ * The first frame must be a key frame (RAW or RLE), playback loops back to it.
+ *
+ * The data is decoded straight into the LedBuffer one frame at a time with setLed, so with a dirty map
+ * only the leds a delta frame touches get re-encoded. It can be a const array linked into the firmware
+ * or a blob written to otherwise unused flash and passed by address.
+ */
+class AnimationPlayer : public Effect {
+public:
+	enum FRAME_TYPE {
+		FRAME_RAW = 1,
+		FRAME_RLE = 2,
+		FRAME_DELTA = 3
+	};
+	static const uint16_t HEADER_SIZE = 12;
+public:
+	AnimationPlayer();
+	virtual ~AnimationPlayer();
+	//returns false if the header is not valid, nothing is played then
+	bool load(const uint8_t *data, uint32_t size);
+	uint16_t getNumLeds() const {return NumLeds;}
+	uint16_t getNumFrames() const {return NumFrames;}
+	uint16_t getFrameMS() const {return FrameMS;}
+	uint16_t getCurrentFrame() const {return CurrentFrame;}
+	//frames that were corrupt or ran past the end of the data, playback restarts when that happens
+	uint32_t getErrors() const {return Errors;}
+	//decodes the next frame into leds, returns false (and rewinds) on a corrupt frame
+	bool decodeNext(LedBuffer *leds);
+	void rewind();
+	virtual void start(LedBuffer *leds, uint32_t now);
+	virtual void render(LedBuffer *leds, uint32_t now);
+private:
+	bool decodeRaw(LedBuffer *leds, uint16_t n);
+	bool decodeRLE(LedBuffer *leds, uint16_t n);
+	bool decodeDelta(LedBuffer *leds, uint16_t n);
+private:
+	const uint8_t *Data;
+	uint32_t Size;
+	uint32_t Pos;
+	uint16_t NumLeds;
+	uint16_t NumFrames;
+	uint16_t FrameMS;
+	uint16_t CurrentFrame;
+	uint32_t NextFrame;
+	uint32_t Errors;
+};
+
+} //cmdc0de
+
+#endif
@@ -0,0 +1,178 @@
+#include "benchmark.h"
+#include "cyclecounter.h"
+#include "pixelmath.h"
+#include "noise.h"
+#include "ledmatrix.h"
+#include "font.h"
+#include "particles.h"
+#include "diag/Trace.h"
+
+using cmdc0de::Benchmark;
+using cmdc0de::CycleCounter;
+using cmdc0de::PixelMath;
+using cmdc0de::Noise;
+using cmdc0de::LedBuffer;
+using cmdc0de::LedMatrix;
+using cmdc0de::TextScroller;
+using cmdc0de::ParticleSystem;
+using cmdc0de::ParticleSystemBase;
+using cmdc0de::RGB;
+
+static const uint32_t BENCH_LEDS = 64;
+static const uint32_t BENCH_ITERATIONS = 16;
+
+static uint8_t BenchA[BENCH_LEDS * 3];
+static uint8_t BenchB[BENCH_LEDS * 3];
+static uint8_t BenchOut[BENCH_LEDS * 3];
+
+// 32x8 ticker panel
+static const uint16_t PANEL_WIDTH = 32;
+static const uint16_t PANEL_HEIGHT = 8;
+static uint8_t BenchPanel[PANEL_WIDTH * PANEL_HEIGHT * 3];
+
+void Benchmark::report(const char *name, uint32_t cycles, uint32_t iterations) {
+	trace_printf("%-16s %8u cycles/frame (%u leds)\n", name, cycles / iterations, BENCH_LEDS);
+}
+
+void Benchmark::reportSamples(const char *name, uint32_t cycles, uint32_t samples) {
+	trace_printf("%-16s %8u cycles/sample\n", name, cycles / samples);
+}
+
+void Benchmark::runAll() {
+	CycleCounter::init();
+	runPixelMath();
+	runNoise();
+	runMatrix();
+	runParticles();
+}
+
+void Benchmark::runPixelMath() {
+	LedBuffer a(&BenchA[0], BENCH_LEDS);
+	LedBuffer b(&BenchB[0], BENCH_LEDS);
+	LedBuffer out(&BenchOut[0], BENCH_LEDS);
+	uint32_t start;
+	uint32_t i, j;
+
+	for (i = 0; i < sizeof(BenchA); i++) {
+		BenchA[i] = i * 7;
+		BenchB[i] = i * 13;
+	}
+
+	start = CycleCounter::now();
+	for (i = 0; i < BENCH_ITERATIONS; i++)
+		PixelMath::fill(&out, RGB::RED);
+	report("fill", CycleCounter::since(start), BENCH_ITERATIONS);
+
+	start = CycleCounter::now();
+	for (i = 0; i < BENCH_ITERATIONS; i++)
+		PixelMath::scale(&a, 250);
+	report("scale", CycleCounter::since(start), BENCH_ITERATIONS);
+
+	start = CycleCounter::now();
+	for (i = 0; i < BENCH_ITERATIONS; i++)
+		PixelMath::addSaturate(&out, &b);
+	report("addSaturate", CycleCounter::since(start), BENCH_ITERATIONS);
+
+	start = CycleCounter::now();
+	for (i = 0; i < BENCH_ITERATIONS; i++)
+		PixelMath::blend(&out, &a, &b, 100);
+	report("blend", CycleCounter::since(start), BENCH_ITERATIONS);
+
+	start = CycleCounter::now();
+	for (i = 0; i < BENCH_ITERATIONS; i++)
+		PixelMath::fadeToward(&out, RGB::BLUE, 16);
+	report("fadeToward", CycleCounter::since(start), BENCH_ITERATIONS);
+
+	// the per byte loops these replace, for comparison
+	start = CycleCounter::now();
+	for (i = 0; i < BENCH_ITERATIONS; i++)
+		for (j = 0; j < sizeof(BenchA); j++)
+			BenchA[j] = (BenchA[j] * 251) >> 8;
+	report("scale (bytes)", CycleCounter::since(start), BENCH_ITERATIONS);
+
+	start = CycleCounter::now();
+	for (i = 0; i < BENCH_ITERATIONS; i++)
+		for (j = 0; j < sizeof(BenchA); j++)
+			BenchOut[j] = (BenchA[j] * 156 + BenchB[j] * 100) >> 8;
+	report("blend (bytes)", CycleCounter::since(start), BENCH_ITERATIONS);
+}
+
+void Benchmark::runNoise() {
+	uint32_t start;
+	uint32_t i, j;
+	uint32_t sink = 0;
+
+	// one sample per led per frame
+	start = CycleCounter::now();
+	for (i = 0; i < BENCH_ITERATIONS; i++)
+		for (j = 0; j < BENCH_LEDS; j++)
+			sink += Noise::noise8(j * 40 + i * 16);
+	reportSamples("noise 1D", CycleCounter::since(start), BENCH_ITERATIONS * BENCH_LEDS);
+
+	start = CycleCounter::now();
+	for (i = 0; i < BENCH_ITERATIONS; i++)
+		for (j = 0; j < BENCH_LEDS; j++)
+			sink += Noise::noise8(j * 40, i * 16);
+	reportSamples("noise 2D", CycleCounter::since(start), BENCH_ITERATIONS * BENCH_LEDS);
+
+	start = CycleCounter::now();
+	for (i = 0; i < BENCH_ITERATIONS; i++)
+		for (j = 0; j < BENCH_LEDS; j++)
+			sink += Noise::noise8(j * 40, j * 8, i * 16);
+	reportSamples("noise 3D", CycleCounter::since(start), BENCH_ITERATIONS * BENCH_LEDS);
+
+	// keeps the loops from being optimized away
+	trace_printf("%-16s %8u\n", "noise checksum", sink);
+}
+
+void Benchmark::runMatrix() {
+	LedBuffer panel(&BenchPanel[0], PANEL_WIDTH * PANEL_HEIGHT);
+	LedMatrix matrix(PANEL_WIDTH, PANEL_HEIGHT, LedMatrix::SERPENTINE, 0);
+	TextScroller ticker(&matrix, "The quick brown fox jumps over the lazy dog 0123456789", RGB::WHITE, RGB::BLUE, 40);
+	uint32_t start, worst = 0, total = 0;
+	uint32_t i;
+
+	matrix.addStrand(&panel);
+	ticker.start(&panel, 0);
+	// one frame per 25ms step covers every scroll position once
+	for (i = 0; i < 400; i++) {
+		start = CycleCounter::now();
+		ticker.render(&panel, i * 25);
+		uint32_t c = CycleCounter::since(start);
+		total += c;
+		if (c > worst)
+			worst = c;
+	}
+	trace_printf("%-16s %8u cycles/frame avg, %u worst (%ux%u, budget %u for 16ms)\n", "text scroll", total / 400,
+			worst, PANEL_WIDTH, PANEL_HEIGHT, SystemCoreClock / 1000 * 16);
+
+	start = CycleCounter::now();
+	for (i = 0; i < BENCH_ITERATIONS; i++)
+		matrix.fill(RGB::RED);
+	trace_printf("%-16s %8u cycles/frame (%ux%u)\n", "matrix fill", CycleCounter::since(start) / BENCH_ITERATIONS,
+			PANEL_WIDTH, PANEL_HEIGHT);
+}
+
+void Benchmark::runParticles() {
+	// function static so the pool is only linked in when the benchmark is
+	static ParticleSystem<128> particles;
+	LedBuffer out(&BenchOut[0], BENCH_LEDS);
+	uint32_t start, cycles = 0, rendered = 0;
+	uint32_t i;
+
+	particles.setGravity(-ParticleSystemBase::toFixed(20), 0);
+	particles.setBounds(BENCH_LEDS, 0);
+	for (i = 0; i < BENCH_ITERATIONS * 4; i++) {
+		// top the pool back up outside the timed part, lifetimes are long so most survive the frame
+		while (particles.spawn(ParticleSystemBase::toFixed(i % BENCH_LEDS), 0, ParticleSystemBase::toFixed(10), 0,
+				RGB::RED, 5000))
+			;
+		rendered += particles.getActiveCount();
+		start = CycleCounter::now();
+		particles.update(20);
+		particles.render(&out);
+		cycles += CycleCounter::since(start);
+	}
+	trace_printf("%-16s %8u cycles/particle, %u particles per ms of frame time\n", "particles", cycles / rendered,
+			SystemCoreClock / 1000 / (cycles / rendered));
+}
@@ -0,0 +1,26 @@
+#ifndef __BENCHMARK_H__
+#define __BENCHMARK_H__
+
+#include <stdint.h>
+
+namespace cmdc0de {
+
+/*
+ * On target benchmarks, results are cycle counts from the DWT counter written to the trace device.
+ * main runs them at startup when built with WS2812_BENCHMARK defined.
+ */
+class Benchmark {
+public:
+	static void runAll();
+	static void runPixelMath();
+	static void runNoise();
+	static void runMatrix();
+	static void runParticles();
+private:
+	static void report(const char *name, uint32_t cycles, uint32_t iterations);
+	static void reportSamples(const char *name, uint32_t cycles, uint32_t samples);
+};
+
+} //cmdc0de
+
+#endif
@@ -0,0 +1,121 @@
+#include "canbus.h"
+
+using cmdc0de::CanBus;
+using cmdc0de::CanMessage;
+namespace canproto = cmdc0de::canproto;
+
+static const uint32_t QUANTA_PER_BIT = 18;
+
+CanBus::CanBus() {
+
+}
+
+CanBus::~CanBus() {
+
+}
+
+bool CanBus::init(uint32_t bitrate, bool loopback, uint8_t irqPriority) {
+	GPIO_InitTypeDef gpio;
+	CAN_InitTypeDef can;
+	NVIC_InitTypeDef nvic;
+	RCC_ClocksTypeDef clocks;
+
+	RCC_GetClocksFreq(&clocks);
+	if (bitrate == 0 || clocks.PCLK1_Frequency % (bitrate * QUANTA_PER_BIT) != 0)
+		return false;
+
+	RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOA | RCC_APB2Periph_AFIO, ENABLE);
+	RCC_APB1PeriphClockCmd(RCC_APB1Periph_CAN1, ENABLE);
+	gpio.GPIO_Pin = GPIO_Pin_11;
+	gpio.GPIO_Mode = GPIO_Mode_IPU;
+	gpio.GPIO_Speed = GPIO_Speed_50MHz;
+	GPIO_Init(GPIOA, &gpio);
+	gpio.GPIO_Pin = GPIO_Pin_12;
+	gpio.GPIO_Mode = GPIO_Mode_AF_PP;
+	GPIO_Init(GPIOA, &gpio);
+
+	CAN_DeInit(CAN1);
+	CAN_StructInit(&can);
+	can.CAN_TTCM = DISABLE;
+	can.CAN_ABOM = ENABLE;
+	can.CAN_AWUM = DISABLE;
+	can.CAN_NART = DISABLE;
+	can.CAN_RFLM = DISABLE;
+	can.CAN_TXFP = ENABLE;
+	can.CAN_Mode = loopback ? CAN_Mode_Silent_LoopBack : CAN_Mode_Normal;
+	can.CAN_SJW = CAN_SJW_1tq;
+	can.CAN_BS1 = CAN_BS1_13tq;
+	can.CAN_BS2 = CAN_BS2_4tq;
+	can.CAN_Prescaler = clocks.PCLK1_Frequency / (bitrate * QUANTA_PER_BIT);
+	if (CAN_Init(CAN1, &can) != CAN_InitStatus_Success)
+		return false;
+
+	nvic.NVIC_IRQChannelPreemptionPriority = irqPriority;
+	nvic.NVIC_IRQChannelSubPriority = 0;
+	nvic.NVIC_IRQChannelCmd = ENABLE;
+	nvic.NVIC_IRQChannel = USB_LP_CAN1_RX0_IRQn;
+	NVIC_Init(&nvic);
+	nvic.NVIC_IRQChannel = USB_HP_CAN1_TX_IRQn;
+	NVIC_Init(&nvic);
+	CAN_ITConfig(CAN1, CAN_IT_FMP0, ENABLE);
+	return true;
+}
+
+void CanBus::setFilter(uint8_t bank, uint32_t id, uint32_t mask) {
+	CAN_FilterInitTypeDef filter;
+	// 32 bit filter registers hold the extended id from bit 3 up, IDE is bit 2 and has to match as well
+	uint32_t fr = (id << 3) | CAN_Id_Extended;
+	uint32_t mr = (mask << 3) | CAN_Id_Extended;
+	filter.CAN_FilterNumber = bank;
+	filter.CAN_FilterMode = CAN_FilterMode_IdMask;
+	filter.CAN_FilterScale = CAN_FilterScale_32bit;
+	filter.CAN_FilterIdHigh = fr >> 16;
+	filter.CAN_FilterIdLow = fr & 0xFFFF;
+	filter.CAN_FilterMaskIdHigh = mr >> 16;
+	filter.CAN_FilterMaskIdLow = mr & 0xFFFF;
+	filter.CAN_FilterFIFOAssignment = CAN_Filter_FIFO0;
+	filter.CAN_FilterActivation = ENABLE;
+	CAN_FilterInit(&filter);
+}
+
+void CanBus::acceptNode(uint8_t node) {
+	setFilter(0, canproto::nodeFilter(node), canproto::NODE_MASK);
+	setFilter(1, canproto::nodeFilter(canproto::BROADCAST), canproto::NODE_MASK);
+}
+
+bool CanBus::transmit(const CanMessage &m) {
+	CanTxMsg tx;
+	tx.StdId = 0;
+	tx.ExtId = m.Id;
+	tx.IDE = CAN_Id_Extended;
+	tx.RTR = CAN_RTR_Data;
+	tx.DLC = m.Length;
+	for (uint8_t i = 0; i < m.Length; i++) {
+		tx.Data[i] = m.Data[i];
+	}
+	return CAN_Transmit(CAN1, &tx) != CAN_TxStatus_NoMailBox;
+}
+
+bool CanBus::receive(CanMessage &m) {
+	CanRxMsg rx;
+	if (CAN_MessagePending(CAN1, CAN_FIFO0) == 0)
+		return false;
+	CAN_Receive(CAN1, CAN_FIFO0, &rx);
+	m.Id = rx.ExtId;
+	m.Length = rx.DLC > 8 ? 8 : rx.DLC;
+	for (uint8_t i = 0; i < m.Length; i++) {
+		m.Data[i] = rx.Data[i];
+	}
+	return true;
+}
+
+void CanBus::enableTxInterrupt(bool on) {
+	CAN_ITConfig(CAN1, CAN_IT_TME, on ? ENABLE : DISABLE);
+}
+
+bool CanBus::txComplete() {
+	if (CAN_GetITStatus(CAN1, CAN_IT_TME) == RESET)
+		return false;
+	CAN_ClearITPendingBit(CAN1, CAN_IT_TME);
+	return true;
+}
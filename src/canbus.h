@@ -0,0 +1,42 @@
+#ifndef __CANBUS_H__
+#define __CANBUS_H__
+
+#include "stm32f10x_conf.h"
+#include "cancodec.h"
+
+namespace cmdc0de {
+
+/*
+ * bxCAN (CAN1) on its default pins, RX PA11 and TX PA12, to a CAN transceiver. The pins are the USB ones,
+ * so no USB in a CAN build.
+ *
+ * Bit timing is 18 time quanta from the 36MHz APB1 clock (sample point at 78%), so the bitrate has to
+ * divide 2MHz: 1M, 500k, 250k, 125k... The transmit mailboxes run in FIFO order (TXFP) instead of id
+ * priority so messages leave in the order they were queued. Automatic bus-off recovery is on.
+ * Loopback uses the silent loopback mode: messages come back through the filters into the receive FIFO
+ * and nothing reaches the pins, a single board can be tested without a bus.
+ *
+ * Received messages go to FIFO 0 and raise USB_LP_CAN1_RX0, an emptied mailbox raises USB_HP_CAN1_TX
+ * once enableTxInterrupt is on.
+ */
+class CanBus {
+public:
+	CanBus();
+	~CanBus();
+	bool init(uint32_t bitrate, bool loopback, uint8_t irqPriority);
+	//filter banks: messages addressed to node and broadcasts, everything else never reaches the FIFO
+	void acceptNode(uint8_t node);
+	//false if all 3 mailboxes are full
+	bool transmit(const CanMessage &m);
+	bool receive(CanMessage &m);
+	void enableTxInterrupt(bool on);
+	//checks and clears the request complete flags of the mailboxes
+	bool txComplete();
+	uint8_t getErrorCount() const {return CAN_GetReceiveErrorCounter(CAN1);}
+protected:
+	void setFilter(uint8_t bank, uint32_t id, uint32_t mask);
+};
+
+} //cmdc0de
+
+#endif
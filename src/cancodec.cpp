@@ -0,0 +1,121 @@
+#include "cancodec.h"
+#include <string.h>
+
+using cmdc0de::CanSegmenter;
+using cmdc0de::CanReassembler;
+using cmdc0de::CanMessage;
+using cmdc0de::LedBuffer;
+namespace canproto = cmdc0de::canproto;
+
+CanSegmenter::CanSegmenter(const Slice *slices, uint8_t count) :
+		Slices(slices), Count(count), Leds(0), Frame(0), Current(0), Offset(0), Done(true) {
+
+}
+
+CanSegmenter::~CanSegmenter() {
+
+}
+
+void CanSegmenter::start(LedBuffer *leds, uint16_t frame) {
+	Leds = leds;
+	Frame = frame;
+	Current = 0;
+	Offset = 0;
+	Done = false;
+}
+
+uint32_t CanSegmenter::messagesPerFrame() const {
+	uint32_t n = 1;
+	for (uint8_t i = 0; i < Count; i++) {
+		n += (Slices[i].NumLeds * 3 + 7) / 8;
+	}
+	return n;
+}
+
+// the part of the slice the buffer holds, the offset in the id is 16 bits
+uint32_t CanSegmenter::sliceBytes(const Slice &s) const {
+	uint32_t numLeds = 0;
+	if (Leds->getBitsPerLed() == 24 && s.FirstLed < Leds->getNumLeds()) {
+		numLeds = Leds->getNumLeds() - s.FirstLed;
+		if (numLeds > s.NumLeds)
+			numLeds = s.NumLeds;
+	}
+	uint32_t bytes = numLeds * 3;
+	return bytes > 0xFFFF ? 0xFFFF : bytes;
+}
+
+bool CanSegmenter::next(CanMessage &m) {
+	if (Done)
+		return false;
+	while (Current < Count) {
+		const Slice &s = Slices[Current];
+		uint32_t bytes = sliceBytes(s);
+		if (Offset < bytes) {
+			uint16_t n = bytes - Offset < 8 ? bytes - Offset : 8;
+			m.Id = canproto::makeId(canproto::PIXELS, s.Node, Offset);
+			m.Length = n;
+			memcpy(m.Data, Leds->getLed(s.FirstLed) + Offset, n);
+			Offset += n;
+			return true;
+		}
+		Current++;
+		Offset = 0;
+	}
+	m.Id = canproto::makeId(canproto::LATCH, canproto::BROADCAST, Frame);
+	m.Length = 0;
+	Done = true;
+	return true;
+}
+
+CanReassembler::CanReassembler(uint8_t node) :
+		Node(node), Received(), LastFrame(0), Frames(0), Incomplete(0) {
+
+}
+
+CanReassembler::~CanReassembler() {
+
+}
+
+void CanReassembler::clear() {
+	memset(Received, 0, sizeof(Received));
+}
+
+CanReassembler::RESULT CanReassembler::receive(const CanMessage &m, LedBuffer *leds) {
+	uint8_t node = canproto::getNode(m.Id);
+	uint16_t offset = canproto::getOffset(m.Id);
+	uint32_t room = leds->getNumLeds() * 3;
+	if (leds->getBitsPerLed() != 24)
+		return IGNORED;
+	if (room > MAX_MESSAGES * 8)
+		room = MAX_MESSAGES * 8;
+	switch (canproto::getType(m.Id)) {
+	case canproto::PIXELS: {
+		if (node != Node || (offset & 7) != 0 || offset >= room)
+			return IGNORED;
+		uint16_t n = m.Length > 8 ? 8 : m.Length;
+		memcpy(leds->getLeds() + offset, m.Data, room - offset < n ? room - offset : n);
+		uint16_t msg = offset / 8;
+		Received[msg >> 5] |= 1u << (msg & 31);
+		return PIXELS;
+	}
+	case canproto::LATCH: {
+		if (node != Node && node != canproto::BROADCAST)
+			return IGNORED;
+		LastFrame = offset;
+		uint16_t messages = (room + 7) / 8;
+		bool complete = true;
+		for (uint16_t i = 0; i < messages && complete; i++) {
+			complete = (Received[i >> 5] & (1u << (i & 31))) != 0;
+		}
+		clear();
+		if (!complete) {
+			Incomplete++;
+			return INCOMPLETE;
+		}
+		Frames++;
+		return FRAME;
+	}
+	default:
+		return IGNORED;
+	}
+}
@@ -0,0 +1,114 @@
+#ifndef __CANCODEC_H__
+#define __CANCODEC_H__
+
+#include "ledbuffer.h"
+
+namespace cmdc0de {
+
+/*
+ * Pixel distribution over CAN, 29 bit extended ids:
+ * 	bits 28-24 type, 23-16 node, 15-0 offset
+ * 	PIXELS: up to 8 bytes of R,G,B data for node, offset is the byte offset into its buffer
+ * 	LATCH:  sent to BROADCAST after every node got its pixels, offset is a frame number, no data
+ * Nodes only need the ids of their own node and BROADCAST, so a hardware filter on the node bits
+ * (nodeFilter/NODE_MASK, the same pair works for bxCAN filter banks and SocketCAN CAN_RAW_FILTER)
+ * keeps everything else out of the receive FIFO.
+ *
+ * The sender must send the messages of a frame in order (the bxCAN transmit FIFO mode, not id priority)
+ * so the latch goes out last. CanReassembler keeps a bit per message of the frame and only reports a
+ * frame on the latch if every message covering its buffer arrived, the master has to send each node as
+ * many leds as it has.
+ */
+struct CanMessage {
+	uint32_t Id;
+	uint8_t Length;
+	uint8_t Data[8];
+};
+
+namespace canproto {
+	static const uint8_t BROADCAST = 0xFF;
+	static const uint32_t NODE_MASK = 0x00FF0000;
+	enum TYPE {
+		PIXELS = 0x01,
+		LATCH = 0x02
+	};
+	inline uint32_t makeId(uint8_t type, uint8_t node, uint16_t offset) {
+		return ((uint32_t) (type & 0x1F) << 24) | ((uint32_t) node << 16) | offset;
+	}
+	inline uint8_t getType(uint32_t id) {return (id >> 24) & 0x1F;}
+	inline uint8_t getNode(uint32_t id) {return (id >> 16) & 0xFF;}
+	inline uint16_t getOffset(uint32_t id) {return id & 0xFFFF;}
+	//id to match under NODE_MASK
+	inline uint32_t nodeFilter(uint8_t node) {return (uint32_t) node << 16;}
+}
+
+/*
+ * Master side, cuts the slices of a frame into messages for their nodes and ends with the latch.
+ * A slice is cut short where the buffer ends, nothing is sent from a packed buffer.
+ */
+class CanSegmenter {
+public:
+	struct Slice {
+		uint8_t Node;
+		uint16_t FirstLed;
+		uint16_t NumLeds;
+	};
+public:
+	//slices is used in place
+	CanSegmenter(const Slice *slices, uint8_t count);
+	~CanSegmenter();
+	void start(LedBuffer *leds, uint16_t frame);
+	//false once the latch was handed out
+	bool next(CanMessage &m);
+	//messages one frame takes, latch included
+	uint32_t messagesPerFrame() const;
+protected:
+	uint32_t sliceBytes(const Slice &s) const;
+private:
+	const Slice *Slices;
+	uint8_t Count;
+	LedBuffer *Leds;
+	uint16_t Frame;
+	uint8_t Current;
+	uint16_t Offset;
+	bool Done;
+};
+
+/*
+ * Node side, writes PIXELS messages into the raw pixels of a buffer (invalidate/publish before use).
+ * Everything is ignored for a packed buffer.
+ */
+class CanReassembler {
+public:
+	//largest buffer tracked, 8 bytes per message
+	static const uint16_t MAX_MESSAGES = 512;
+	enum RESULT {
+		//not for this node, or pixels past the end of the buffer
+		IGNORED,
+		PIXELS,
+		//latch of a complete frame, publish it
+		FRAME,
+		//latch with messages missing, the frame is dropped
+		INCOMPLETE
+	};
+public:
+	CanReassembler(uint8_t node);
+	~CanReassembler();
+	RESULT receive(const CanMessage &m, LedBuffer *leds);
+	uint8_t getNode() const {return Node;}
+	uint16_t getLastFrame() const {return LastFrame;}
+	uint32_t getFrames() const {return Frames;}
+	uint32_t getIncomplete() const {return Incomplete;}
+protected:
+	void clear();
+private:
+	uint8_t Node;
+	uint32_t Received[MAX_MESSAGES / 32];
+	uint16_t LastFrame;
+	uint32_t Frames;
+	uint32_t Incomplete;
+};
+
+} //cmdc0de
+
+#endif
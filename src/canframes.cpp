@@ -0,0 +1,76 @@
+#include "canframes.h"
+
+using cmdc0de::CanFrameSender;
+using cmdc0de::CanFrameReceiver;
+using cmdc0de::CanBus;
+using cmdc0de::CanSegmenter;
+using cmdc0de::CanReassembler;
+using cmdc0de::CanMessage;
+using cmdc0de::TripleBuffer;
+using cmdc0de::LedBuffer;
+
+CanFrameSender::CanFrameSender(CanBus *bus, CanSegmenter *segmenter) :
+		Bus(bus), Segmenter(segmenter), Held(), Holding(false), Busy(false), Frame(0), Frames(0) {
+
+}
+
+CanFrameSender::~CanFrameSender() {
+
+}
+
+void CanFrameSender::fill() {
+	while (1) {
+		if (!Holding) {
+			if (!Segmenter->next(Held)) {
+				Busy = false;
+				Frames++;
+				Bus->enableTxInterrupt(false);
+				return;
+			}
+			Holding = true;
+		}
+		if (!Bus->transmit(Held))
+			return;
+		Holding = false;
+	}
+}
+
+bool CanFrameSender::send(LedBuffer *leds) {
+	if (Busy)
+		return false;
+	Segmenter->start(leds, Frame++);
+	Busy = true;
+	Holding = false;
+	NVIC_DisableIRQ(USB_HP_CAN1_TX_IRQn);
+	fill();
+	if (Busy)
+		Bus->enableTxInterrupt(true);
+	NVIC_EnableIRQ(USB_HP_CAN1_TX_IRQn);
+	return true;
+}
+
+void CanFrameSender::handleTxISR() {
+	if (Bus->txComplete() && Busy)
+		fill();
+}
+
+CanFrameReceiver::CanFrameReceiver(CanBus *bus, uint8_t node, TripleBuffer *frames) :
+		Bus(bus), Reassembler(node), FrameBuffers(frames) {
+
+}
+
+CanFrameReceiver::~CanFrameReceiver() {
+
+}
+
+void CanFrameReceiver::init() {
+	Bus->acceptNode(Reassembler.getNode());
+}
+
+void CanFrameReceiver::handleRxISR() {
+	CanMessage m;
+	while (Bus->receive(m)) {
+		if (Reassembler.receive(m, FrameBuffers->getBack()) == CanReassembler::FRAME)
+			FrameBuffers->publish();
+	}
+}
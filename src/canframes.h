@@ -0,0 +1,56 @@
+#ifndef __CANFRAMES_H__
+#define __CANFRAMES_H__
+
+#include "canbus.h"
+
+namespace cmdc0de {
+
+/*
+ * Master: send queues the first messages of a frame (3 mailboxes) and the mailbox empty interrupt keeps
+ * them topped up until the latch is out. The buffer is read while that happens, do not render into it
+ * before isBusy is false (64 leds are 25 messages, ~3.3ms at 1Mbit).
+ */
+class CanFrameSender {
+public:
+	CanFrameSender(CanBus *bus, CanSegmenter *segmenter);
+	~CanFrameSender();
+	//false if the previous frame is still going out
+	bool send(LedBuffer *leds);
+	bool isBusy() const {return Busy;}
+	void handleTxISR();
+	uint32_t getFrames() const {return Frames;}
+protected:
+	void fill();
+private:
+	CanBus *Bus;
+	CanSegmenter *Segmenter;
+	//a message the mailboxes had no room for yet
+	CanMessage Held;
+	bool Holding;
+	volatile bool Busy;
+	uint16_t Frame;
+	volatile uint32_t Frames;
+};
+
+/*
+ * Node: the FIFO 0 interrupt reassembles PIXELS straight into the back buffer of the TripleBuffer and a
+ * latch of a complete frame publishes it. Frames with a message missing are dropped, the strand keeps
+ * showing the last good one.
+ */
+class CanFrameReceiver {
+public:
+	CanFrameReceiver(CanBus *bus, uint8_t node, TripleBuffer *frames);
+	~CanFrameReceiver();
+	//sets up the filters for the node
+	void init();
+	void handleRxISR();
+	CanReassembler *getReassembler() {return &Reassembler;}
+private:
+	CanBus *Bus;
+	CanReassembler Reassembler;
+	TripleBuffer *FrameBuffers;
+};
+
+} //cmdc0de
+
+#endif
@@ -0,0 +1,112 @@
+#include "commands.h"
+#include <string.h>
+
+using cmdc0de::CommandHandler;
+using cmdc0de::TripleBuffer;
+using cmdc0de::PowerManager;
+using cmdc0de::EffectRunner;
+using cmdc0de::UartStream;
+using cmdc0de::PacketWriter;
+using cmdc0de::FrameDecoder;
+namespace protocol = cmdc0de::protocol;
+
+CommandHandler::CommandHandler(TripleBuffer *frames, PowerManager *power, EffectRunner *runner, UartStream *stream) :
+		FrameBuffers(frames), Power(power), Runner(runner), Stream(stream), Decoder(), Type(0), Length(0), Args(),
+				Brightness(255), HaveBase(true), Streaming(false), Acking(false), FramePackets(0),
+				Rejected(0) {
+
+}
+
+CommandHandler::~CommandHandler() {
+
+}
+
+void CommandHandler::begin(uint8_t type, uint16_t len) {
+	Type = type;
+	Length = len;
+	memset(Args, 0, sizeof(Args));
+	HaveBase = true;
+	if (type == protocol::FRAME) {
+		Decoder.begin(FrameBuffers->getBack(), FrameDecoder::RAW, 0);
+	} else if (type == protocol::FRAME_RLE) {
+		Decoder.begin(FrameBuffers->getBack(), FrameDecoder::RLE, 0);
+	} else if (type == protocol::FRAME_DELTA) {
+		HaveBase = FrameBuffers->getLatest() != 0;
+		Decoder.begin(FrameBuffers->getBack(), FrameDecoder::DELTA, FrameBuffers->getLatest());
+	}
+}
+
+void CommandHandler::data(const uint8_t *bytes, uint16_t len, uint16_t offset) {
+	if (isFrame()) {
+		// the parser hands the payload over in order, the decoder keeps its own position
+		Decoder.feed(bytes, len);
+	} else {
+		for (uint16_t i = 0; i < len && offset + i < sizeof(Args); i++) {
+			Args[offset + i] = bytes[i];
+		}
+	}
+}
+
+void CommandHandler::end(bool crcOk) {
+	if (isFrame()) {
+		// the header check passed, so a bad frame still counts against the streamer's window
+		FramePackets++;
+		if (crcOk && Decoder.finish() && HaveBase) {
+			FrameBuffers->publish();
+			Streaming = true;
+		} else {
+			Rejected++;
+		}
+		if (Acking)
+			sendFlow();
+		return;
+	}
+	if (!crcOk)
+		return;
+	switch (Type) {
+	case protocol::BRIGHTNESS:
+		if (Length >= 1) {
+			Brightness = Args[0];
+			Power->setMaxBrightness(Brightness);
+		}
+		break;
+	case protocol::SELECT_EFFECT:
+		if (Length >= 1) {
+			Runner->selectEffect(Args[0]);
+			Streaming = false;
+		}
+		break;
+	case protocol::STATS:
+		sendStats();
+		break;
+	case protocol::FLOW_CONTROL:
+		if (Length >= 1)
+			Acking = Args[0] != 0;
+		sendFlow();
+		break;
+	default:
+		break;
+	}
+}
+
+void CommandHandler::sendStats() {
+	uint8_t payload[protocol::STATS_SIZE];
+	PacketParser *parser = Stream->getParser();
+	int16_t effect = Runner->getCurrentEffect();
+	PacketWriter::put32(&payload[0], parser->getPackets());
+	PacketWriter::put32(&payload[4], parser->getCRCErrors());
+	PacketWriter::put32(&payload[8], parser->getHeaderErrors());
+	PacketWriter::put32(&payload[12], Stream->getOverruns());
+	PacketWriter::put32(&payload[16], FrameBuffers->getDropped());
+	payload[20] = Brightness;
+	payload[21] = effect < 0 ? 0xFF : effect;
+	Stream->sendPacket(protocol::STATS | protocol::REPLY, payload, sizeof(payload));
+}
+
+void CommandHandler::sendFlow() {
+	uint8_t payload[protocol::FLOW_SIZE];
+	PacketWriter::put32(&payload[0], FramePackets);
+	PacketWriter::put32(&payload[4], Rejected);
+	PacketWriter::put32(&payload[8], FrameBuffers->getDropped());
+	Stream->sendPacket(protocol::FLOW_CONTROL | protocol::REPLY, payload, sizeof(payload));
+}
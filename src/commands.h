@@ -0,0 +1,60 @@
+#ifndef __COMMANDS_H__
+#define __COMMANDS_H__
+
+#include "protocol.h"
+#include "framecodec.h"
+#include "uartstream.h"
+#include "power.h"
+#include "effect.h"
+
+namespace cmdc0de {
+
+/*
+ * Acts on the packets of the binary protocol (protocol.h):
+ * 	FRAME:         payload is copied from the receive ring into the back buffer as it arrives and published
+ * 	               once the CRC checks out, a frame also switches the board to streaming
+ * 	FRAME_RLE,
+ * 	FRAME_DELTA:   same, but decoded by a FrameDecoder as the bytes arrive, a delta starts from a copy of the
+ * 	               last published frame and is dropped if there is none yet
+ * 	BRIGHTNESS:    max brightness of the PowerManager
+ * 	SELECT_EFFECT: picks an effect and leaves streaming
+ * 	STATS:         replies with the receive counters
+ * 	FLOW_CONTROL:  turns acknowledging frame packets on or off, a streamer keeps its window of frames in flight
+ * 	               by the counts in the reply (replies that find the TX busy are skipped, the counts catch up)
+ * Runs in the UartStream interrupt, the main loop only looks at isStreaming.
+ */
+class CommandHandler : public PacketHandler {
+public:
+	CommandHandler(TripleBuffer *frames, PowerManager *power, EffectRunner *runner, UartStream *stream);
+	virtual ~CommandHandler();
+	virtual void begin(uint8_t type, uint16_t len);
+	virtual void data(const uint8_t *bytes, uint16_t len, uint16_t offset);
+	virtual void end(bool crcOk);
+	bool isStreaming() const {return Streaming;}
+	uint8_t getBrightness() const {return Brightness;}
+protected:
+	void sendStats();
+	void sendFlow();
+	bool isFrame() const {return Type==protocol::FRAME || Type==protocol::FRAME_RLE || Type==protocol::FRAME_DELTA;}
+private:
+	TripleBuffer *FrameBuffers;
+	PowerManager *Power;
+	EffectRunner *Runner;
+	UartStream *Stream;
+	FrameDecoder Decoder;
+	uint8_t Type;
+	uint16_t Length;
+	//first bytes of the payload of the small packets
+	uint8_t Args[4];
+	uint8_t Brightness;
+	//false if a delta arrived with nothing to apply it to
+	bool HaveBase;
+	volatile bool Streaming;
+	bool Acking;
+	uint32_t FramePackets;
+	uint32_t Rejected;
+};
+
+} //cmdc0de
+
+#endif
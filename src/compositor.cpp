@@ -0,0 +1,132 @@
+#include "compositor.h"
+
+using cmdc0de::Compositor;
+using cmdc0de::Effect;
+using cmdc0de::LedBuffer;
+
+// a + (b - a) * amount / 255
+static inline uint8_t mix(uint8_t a, uint8_t b, uint8_t amount) {
+	return a + ((((int16_t) b - a) * (amount + (amount >> 7))) >> 8);
+}
+
+static inline uint8_t blendChannel(uint8_t below, uint8_t above, Compositor::BLEND_MODE mode) {
+	switch (mode) {
+	case Compositor::ADD: {
+		uint16_t s = below + above;
+		return s > 255 ? 255 : s;
+	}
+	case Compositor::MULTIPLY:
+		return (below * (above + 1)) >> 8;
+	case Compositor::SCREEN:
+		return 255 - (((255 - below) * (256 - above)) >> 8);
+	case Compositor::NORMAL:
+	default:
+		return above;
+	}
+}
+
+Compositor::Compositor(const char *name, LedBuffer *transitionBuffer) :
+		Effect(name), Layers(), LayerCount(0), TransitionBuffer(transitionBuffer), FadeEffect(0), FadeLayer(-1),
+				FadeStart(0), FadeDuration(0) {
+
+}
+
+Compositor::~Compositor() {
+
+}
+
+int8_t Compositor::addLayer(Effect *effect, LedBuffer *buffer, BLEND_MODE mode, uint8_t opacity) {
+	if (LayerCount == MAX_LAYERS) {
+		return -1;
+	}
+	Layers[LayerCount].LayerEffect = effect;
+	Layers[LayerCount].Buffer = buffer;
+	Layers[LayerCount].Mode = mode;
+	Layers[LayerCount].Opacity = opacity;
+	return LayerCount++;
+}
+
+void Compositor::setBlendMode(uint8_t layer, BLEND_MODE mode) {
+	if (layer < LayerCount)
+		Layers[layer].Mode = mode;
+}
+
+void Compositor::setOpacity(uint8_t layer, uint8_t opacity) {
+	if (layer < LayerCount)
+		Layers[layer].Opacity = opacity;
+}
+
+Effect *Compositor::getLayerEffect(uint8_t layer) {
+	return layer < LayerCount ? Layers[layer].LayerEffect : 0;
+}
+
+bool Compositor::crossfade(uint8_t layer, Effect *to, uint32_t durationMS, uint32_t now) {
+	if (layer >= LayerCount || FadeLayer >= 0 || TransitionBuffer == 0) {
+		return false;
+	}
+	to->start(TransitionBuffer, now);
+	FadeEffect = to;
+	FadeLayer = layer;
+	FadeStart = now;
+	FadeDuration = durationMS > 0 ? durationMS : 1;
+	return true;
+}
+
+void Compositor::start(LedBuffer *leds, uint32_t now) {
+	(void) leds;
+	for (uint8_t l = 0; l < LayerCount; l++) {
+		if (Layers[l].LayerEffect)
+			Layers[l].LayerEffect->start(Layers[l].Buffer, now);
+	}
+}
+
+void Compositor::render(LedBuffer *leds, uint32_t now) {
+	uint8_t fadeAmount = 0;
+	uint8_t l;
+
+	if (FadeLayer >= 0) {
+		uint32_t elapsed = now - FadeStart;
+		if (elapsed >= FadeDuration) {
+			// fade is over, the incoming effect and its buffer become the layer
+			Layer &layer = Layers[FadeLayer];
+			LedBuffer *old = layer.Buffer;
+			layer.Buffer = TransitionBuffer;
+			layer.LayerEffect = FadeEffect;
+			TransitionBuffer = old;
+			FadeLayer = -1;
+			FadeEffect = 0;
+		} else {
+			fadeAmount = (elapsed * 255) / FadeDuration;
+			FadeEffect->render(TransitionBuffer, now);
+		}
+	}
+	for (l = 0; l < LayerCount; l++) {
+		if (Layers[l].LayerEffect)
+			Layers[l].LayerEffect->render(Layers[l].Buffer, now);
+	}
+
+	// single pass: every pixel is pulled through all the layers before moving on
+	uint8_t scratch[3];
+	uint8_t fadeScratch[3];
+	for (uint16_t i = 0; i < leds->getNumLeds(); i++) {
+		uint8_t out[3] = { 0, 0, 0 };
+		for (l = 0; l < LayerCount; l++) {
+			const Layer &layer = Layers[l];
+			if (i >= layer.Buffer->getNumLeds())
+				continue;
+			const uint8_t *c = layer.Buffer->getColor(i, scratch);
+			uint8_t faded[3];
+			if (l == FadeLayer && i < TransitionBuffer->getNumLeds()) {
+				const uint8_t *in = TransitionBuffer->getColor(i, fadeScratch);
+				faded[0] = mix(c[0], in[0], fadeAmount);
+				faded[1] = mix(c[1], in[1], fadeAmount);
+				faded[2] = mix(c[2], in[2], fadeAmount);
+				c = faded;
+			}
+			for (uint8_t ch = 0; ch < 3; ch++) {
+				out[ch] = mix(out[ch], blendChannel(out[ch], c[ch], layer.Mode), layer.Opacity);
+			}
+		}
+		leds->setLed(i, out[0], out[1], out[2]);
+	}
+}
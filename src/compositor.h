@@ -0,0 +1,61 @@
+#ifndef __COMPOSITOR_H__
+#define __COMPOSITOR_H__
+
+#include "effect.h"
+
+namespace cmdc0de {
+
+/*
+ * Runs several effects into their own layer buffers and combines them into the output buffer.
+ *
+ * Layers are combined bottom (layer 0) to top in a single pass over the pixels, each layer is mixed onto
+ * what is below it with its blend mode and then opacity (255 = fully opaque).
+ * A layer can crossfade to a different effect over a period of time, the incoming effect renders into the
+ * transition buffer and is mixed in during the same pass, when the fade completes the buffers are swapped.
+ * One crossfade can run at a time.
+ *
+ * The compositor is itself an Effect so it can be registered with the EffectRunner like any other.
+ * Layer buffers can be any LedBuffer type, they are read with getColor.
+ */
+class Compositor : public Effect {
+public:
+	enum BLEND_MODE {
+		NORMAL = 0,
+		ADD,
+		MULTIPLY,
+		SCREEN
+	};
+	static const uint8_t MAX_LAYERS = 4;
+public:
+	Compositor(const char *name, LedBuffer *transitionBuffer);
+	virtual ~Compositor();
+	//returns layer index or -1 if there is no room
+	int8_t addLayer(Effect *effect, LedBuffer *buffer, BLEND_MODE mode, uint8_t opacity);
+	uint8_t getLayerCount() const {return LayerCount;}
+	void setBlendMode(uint8_t layer, BLEND_MODE mode);
+	void setOpacity(uint8_t layer, uint8_t opacity);
+	Effect *getLayerEffect(uint8_t layer);
+	//returns false if the layer does not exist or a crossfade is already running
+	bool crossfade(uint8_t layer, Effect *to, uint32_t durationMS, uint32_t now);
+	bool isCrossfading() const {return FadeLayer >= 0;}
+	virtual void start(LedBuffer *leds, uint32_t now);
+	virtual void render(LedBuffer *leds, uint32_t now);
+private:
+	struct Layer {
+		Effect *LayerEffect;
+		LedBuffer *Buffer;
+		BLEND_MODE Mode;
+		uint8_t Opacity;
+	};
+	Layer Layers[MAX_LAYERS];
+	uint8_t LayerCount;
+	LedBuffer *TransitionBuffer;
+	Effect *FadeEffect;
+	int8_t FadeLayer;
+	uint32_t FadeStart;
+	uint32_t FadeDuration;
+};
+
+} //cmdc0de
+
+#endif
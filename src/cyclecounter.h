@@ -0,0 +1,29 @@
+#ifndef __CYCLECOUNTER_H__
+#define __CYCLECOUNTER_H__
+
+#include "cmsis_device.h"
+
+namespace cmdc0de {
+
+/*
+ * Core clock cycle counter from the DWT unit, used for benchmarks and render time accounting.
+ * Wraps after ~59 seconds at 72MHz, only ever use differences of two readings.
+ */
+class CycleCounter {
+public:
+	static void init() {
+		CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+		DWT->CYCCNT = 0;
+		DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	}
+	static uint32_t now() {
+		return DWT->CYCCNT;
+	}
+	static uint32_t since(uint32_t start) {
+		return DWT->CYCCNT - start;
+	}
+};
+
+} //cmdc0de
+
+#endif
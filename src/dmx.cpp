@@ -0,0 +1,103 @@
+#include "dmx.h"
+
+using cmdc0de::DmxReceiver;
+using cmdc0de::SerialPort;
+using cmdc0de::UniverseMapper;
+using cmdc0de::TripleBuffer;
+
+DmxReceiver::DmxReceiver(SerialPort *port, uint16_t universe, UniverseMapper *mapper, TripleBuffer *frames) :
+		Port(port), Universe(universe), Mapper(mapper), FrameBuffers(frames), Buffers(), Filling(&Buffers[0][0]),
+				Sink(0), Receiving(false), Slots(0), Packets(0), Frames(0), Ignored(0), Overruns(0) {
+
+}
+
+DmxReceiver::~DmxReceiver() {
+
+}
+
+void DmxReceiver::init(uint8_t irqPriority) {
+	Port->init(BAUD, USART_StopBits_2, irqPriority);
+	// with DMA on, framing and overrun errors only interrupt through EIE
+	USART_ITConfig(Port->getUSART(), USART_IT_ERR, ENABLE);
+	// whatever is on the line now is the middle of a packet, wait for a break
+	armSink();
+}
+
+void DmxReceiver::armPacket() {
+	Filling = (Filling == &Buffers[0][0]) ? &Buffers[1][0] : &Buffers[0][0];
+	Receiving = true;
+	Port->armRx(Filling, PACKET_SIZE, true);
+}
+
+void DmxReceiver::armSink() {
+	Receiving = false;
+	Port->armRx(&Sink, 0xFFFF, false);
+}
+
+void DmxReceiver::publishFrame() {
+	FrameBuffers->publish();
+	Mapper->clearArrived();
+	Frames++;
+}
+
+void DmxReceiver::packetReceived(const uint8_t *packet, uint16_t len) {
+	Packets++;
+	if (packet[0] != 0) {
+		Ignored++;
+		return;
+	}
+	Slots = len - 1;
+	if (!Mapper->isMapped(Universe))
+		return;
+	if (Mapper->hasArrived(Universe)) {
+		// came round again before the rest of the frame, send what there is
+		publishFrame();
+	}
+	Mapper->write(Universe, &packet[1], Slots, FrameBuffers->getBack());
+	if (Mapper->arrived(Universe))
+		publishFrame();
+}
+
+void DmxReceiver::handleDMAISR() {
+	if (!Port->rxComplete())
+		return;
+	if (Receiving) {
+		// all 512 slots are in, no need to wait for the break
+		const uint8_t *done = Filling;
+		armSink();
+		packetReceived(done, PACKET_SIZE);
+	} else {
+		// no break for 65535 byte times, keep waiting
+		armSink();
+	}
+}
+
+void DmxReceiver::handleUSARTISR() {
+	USART_TypeDef *usart = Port->getUSART();
+	uint16_t sr = usart->SR;
+	if (!(sr & (USART_FLAG_ORE | USART_FLAG_FE | USART_FLAG_NE)))
+		return;
+	// SR then DR clears the error flags, the DMA has already taken the data byte
+	(void) usart->DR;
+	if (sr & USART_FLAG_ORE) {
+		// the packet has a hole in it, drop it and pick up at the next break
+		Overruns++;
+		Port->stopRx();
+		armSink();
+		return;
+	}
+	if (!(sr & USART_FLAG_FE))
+		return;
+	if (Receiving) {
+		uint16_t received = PACKET_SIZE - Port->getRxRemaining();
+		const uint8_t *done = Filling;
+		Port->stopRx();
+		armPacket();
+		// the last byte is the break
+		if (received > 1)
+			packetReceived(done, received - 1);
+	} else {
+		Port->stopRx();
+		armPacket();
+	}
+}
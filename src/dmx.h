@@ -0,0 +1,69 @@
+#ifndef __DMX_H__
+#define __DMX_H__
+
+#include "serialport.h"
+#include "universe.h"
+
+namespace cmdc0de {
+
+/*
+ * DMX512 input on a USART at 250k baud 8N2, behind an RS-485 transceiver with its receiver always enabled.
+ *
+ * A packet is a break (line low for at least 88us), the mark after break, a start code and up to 512 slots.
+ * The break reads as a 0 byte with a framing error, so the error interrupt marks the packet boundary:
+ * 	- the RX DMA is re-armed into the other of 2 packet buffers and the one just filled is mapped into the
+ * 	  back buffer of the TripleBuffer while the next packet arrives
+ * 	- the 0 byte of the break itself went through the DMA as well (RXNE comes up with FE and the DMA takes
+ * 	  it long before the interrupt gets to look), it is the last byte received and is not part of the packet
+ * A packet of all 512 slots ends with the DMA transfer complete instead and is mapped as soon as the last slot
+ * is in rather than at the next break, the DMA then drops bytes into a sink until the break.
+ * Packets with a start code other than 0 (RDM, text...) are counted and ignored.
+ *
+ * Several receivers (one per USART, each with its own universe number) can share a UniverseMapper and
+ * TripleBuffer if their interrupts have the same priority. A frame is published once every mapped universe
+ * arrived, or when one comes round again before the rest did, so a line that went quiet does not hold up
+ * the others.
+ */
+class DmxReceiver {
+public:
+	static const uint32_t BAUD = 250000;
+	//start code and 512 slots
+	static const uint16_t PACKET_SIZE = 513;
+public:
+	DmxReceiver(SerialPort *port, uint16_t universe, UniverseMapper *mapper, TripleBuffer *frames);
+	~DmxReceiver();
+	//priority should be above (numerically lower than) the strand DMA
+	void init(uint8_t irqPriority);
+	void handleUSARTISR();
+	void handleDMAISR();
+	uint32_t getPackets() const {return Packets;}
+	uint32_t getFrames() const {return Frames;}
+	uint32_t getIgnored() const {return Ignored;}
+	uint32_t getOverruns() const {return Overruns;}
+	//slots in the last packet with start code 0
+	uint16_t getSlots() const {return Slots;}
+protected:
+	void armPacket();
+	void armSink();
+	void packetReceived(const uint8_t *packet, uint16_t len);
+	void publishFrame();
+private:
+	SerialPort *Port;
+	uint16_t Universe;
+	UniverseMapper *Mapper;
+	TripleBuffer *FrameBuffers;
+	uint8_t Buffers[2][PACKET_SIZE];
+	uint8_t *Filling;
+	uint8_t Sink;
+	//false while the DMA is dropping bytes into Sink
+	volatile bool Receiving;
+	uint16_t Slots;
+	volatile uint32_t Packets;
+	volatile uint32_t Frames;
+	volatile uint32_t Ignored;
+	volatile uint32_t Overruns;
+};
+
+} //cmdc0de
+
+#endif
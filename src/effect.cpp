@@ -0,0 +1,90 @@
+#include "effect.h"
+#include "cyclecounter.h"
+#include <string.h>
+
+using cmdc0de::Effect;
+using cmdc0de::EffectRegistry;
+using cmdc0de::EffectRunner;
+using cmdc0de::LedBuffer;
+using cmdc0de::CycleCounter;
+
+EffectRegistry::EffectRegistry() :
+		Effects(), EffectStats(), Count(0) {
+
+}
+
+EffectRegistry::~EffectRegistry() {
+
+}
+
+int16_t EffectRegistry::add(Effect *e) {
+	if (Count == MAX_EFFECTS) {
+		return -1;
+	}
+	Effects[Count] = e;
+	memset(&EffectStats[Count], 0, sizeof(Stats));
+	return Count++;
+}
+
+int16_t EffectRegistry::find(const char *name) const {
+	for (uint8_t i = 0; i < Count; i++) {
+		if (strcmp(Effects[i]->getName(), name) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+void EffectRegistry::resetStats() {
+	memset(&EffectStats[0], 0, sizeof(EffectStats));
+}
+
+EffectRunner::EffectRunner(EffectRegistry *registry, LedBuffer *leds, uint32_t frameIntervalMS) :
+		Registry(registry), Leds(leds), FrameInterval(frameIntervalMS), NextFrame(0), LateFrames(0),
+				CurrentEffect(-1), PendingEffect(0) {
+
+}
+
+EffectRunner::~EffectRunner() {
+
+}
+
+void EffectRunner::nextEffect() {
+	if (Registry->getCount() > 0) {
+		selectEffect((CurrentEffect + 1) % Registry->getCount());
+	}
+}
+
+bool EffectRunner::update(uint32_t now) {
+	if ((int32_t) (now - NextFrame) < 0) {
+		return false;
+	}
+	if (CurrentEffect < 0 || (now - NextFrame) >= FrameInterval) {
+		if (CurrentEffect >= 0)
+			LateFrames++;
+		NextFrame = now;
+	}
+	NextFrame += FrameInterval;
+
+	int16_t pending = PendingEffect;
+	if (pending != CurrentEffect && Registry->get(pending) != 0) {
+		CurrentEffect = pending;
+		Registry->get(CurrentEffect)->start(Leds, now);
+	}
+	Effect *e = Registry->get(CurrentEffect);
+	if (e == 0) {
+		return false;
+	}
+
+	uint32_t start = CycleCounter::now();
+	e->render(Leds, now);
+	uint32_t cycles = CycleCounter::since(start);
+
+	EffectRegistry::Stats *stats = Registry->getStats(CurrentEffect);
+	stats->Frames++;
+	stats->LastCycles = cycles;
+	stats->TotalCycles += cycles;
+	if (cycles > stats->MaxCycles)
+		stats->MaxCycles = cycles;
+	return true;
+}
@@ -0,0 +1,89 @@
+#ifndef __EFFECT_H__
+#define __EFFECT_H__
+
+#include "ledbuffer.h"
+
+namespace cmdc0de {
+
+/*
+ * Base class of everything that draws a frame.
+ * now is in milliseconds (Timer::getTicks), effects should derive their animation from it rather than
+ * from the number of render calls so they run at the same speed whatever the frame rate is.
+ */
+class Effect {
+public:
+	Effect(const char *name) : Name(name) {}
+	virtual ~Effect() {}
+	const char *getName() const {return Name;}
+	//called when the effect becomes the active one, before its first render
+	virtual void start(LedBuffer *leds, uint32_t now) {(void)leds; (void)now;}
+	virtual void render(LedBuffer *leds, uint32_t now) = 0;
+private:
+	const char *Name;
+};
+
+/*
+ * Fixed size table of effects, effects are expected to be statically allocated and outlive the registry.
+ * Also keeps render time accounting per effect.
+ */
+class EffectRegistry {
+public:
+	static const uint8_t MAX_EFFECTS = 16;
+	struct Stats {
+		uint32_t Frames;
+		uint32_t LastCycles;
+		uint32_t MaxCycles;
+		uint64_t TotalCycles;
+	};
+public:
+	EffectRegistry();
+	~EffectRegistry();
+	//returns the index of the effect or -1 if the registry is full
+	int16_t add(Effect *e);
+	Effect *get(uint8_t idx) {return idx < Count ? Effects[idx] : 0;}
+	int16_t find(const char *name) const;
+	uint8_t getCount() const {return Count;}
+	Stats *getStats(uint8_t idx) {return idx < Count ? &EffectStats[idx] : 0;}
+	void resetStats();
+private:
+	Effect *Effects[MAX_EFFECTS];
+	Stats EffectStats[MAX_EFFECTS];
+	uint8_t Count;
+};
+
+/*
+ * Drives the active effect at a fixed frame interval.
+ *
+ * selectEffect only records the request (it is safe to call from an ISR), the switch happens at the next
+ * frame boundary inside update so the new effect renders that frame and no frame is dropped.
+ * usage:
+ * 		if(runner.update(Timer::getTicks())) {
+ * 			leds.sendColors(&buffer, timeout);
+ * 		}
+ */
+class EffectRunner {
+public:
+	EffectRunner(EffectRegistry *registry, LedBuffer *leds, uint32_t frameIntervalMS);
+	~EffectRunner();
+	void selectEffect(uint8_t idx) {PendingEffect = idx;}
+	void nextEffect();
+	int16_t getCurrentEffect() const {return CurrentEffect;}
+	//renders a frame if one is due, returns true if the buffer has a new frame
+	bool update(uint32_t now);
+	void setFrameInterval(uint32_t ms) {FrameInterval = ms;}
+	uint32_t getFrameInterval() const {return FrameInterval;}
+	//frames that were due but started late by a full interval or more
+	uint32_t getLateFrames() const {return LateFrames;}
+private:
+	EffectRegistry *Registry;
+	LedBuffer *Leds;
+	uint32_t FrameInterval;
+	uint32_t NextFrame;
+	uint32_t LateFrames;
+	int16_t CurrentEffect;
+	volatile int16_t PendingEffect;
+};
+
+} //cmdc0de
+
+#endif
@@ -0,0 +1,209 @@
+#include "effects.h"
+#include "noise.h"
+#include "lut.h"
+#include <string.h>
+#include <stdlib.h>
+
+using cmdc0de::RandomEffect;
+using cmdc0de::SolidEffect;
+using cmdc0de::NoiseEffect;
+using cmdc0de::Noise;
+using cmdc0de::FireEffect;
+using cmdc0de::PlasmaEffect;
+using cmdc0de::SineWaveEffect;
+using cmdc0de::ColorWipeEffect;
+using cmdc0de::LedBuffer;
+using cmdc0de::RGB;
+
+// small xorshift, rand() is far more than effects need
+static uint32_t RandomState = 0x2545F491;
+
+static uint8_t random8() {
+	RandomState ^= RandomState << 13;
+	RandomState ^= RandomState >> 17;
+	RandomState ^= RandomState << 5;
+	return RandomState;
+}
+
+//random in [low, high)
+static uint8_t random8(uint8_t low, uint8_t high) {
+	return low + (((uint16_t) random8() * (high - low)) >> 8);
+}
+
+// 256 phase units per period, speed periods per 10s. Taking now modulo 10s keeps the math in
+// 32 bits and is seamless because a whole number of periods fit in 10s
+static uint8_t phase(uint32_t now, uint8_t speed) {
+	return ((now % 10000) * speed * 256) / 10000;
+}
+
+static uint8_t qadd8(uint8_t a, uint8_t b) {
+	uint16_t s = a + b;
+	return s > 255 ? 255 : s;
+}
+
+static uint8_t qsub8(uint8_t a, uint8_t b) {
+	return a > b ? a - b : 0;
+}
+
+RandomEffect::RandomEffect(uint32_t holdMS) :
+		Effect("random"), HoldMS(holdMS), NextChange(0) {
+
+}
+
+RandomEffect::~RandomEffect() {
+
+}
+
+void RandomEffect::start(LedBuffer *leds, uint32_t now) {
+	(void) leds;
+	NextChange = now;
+}
+
+void RandomEffect::render(LedBuffer *leds, uint32_t now) {
+	if ((int32_t) (now - NextChange) < 0) {
+		return;
+	}
+	NextChange = now + HoldMS;
+	for (int i = 0; i < leds->getNumLeds(); i++) {
+		leds->setLed(i, rand() % 256, rand() % 256, rand() % 256);
+	}
+}
+
+SolidEffect::SolidEffect(const RGB &color) :
+		Effect("solid"), Color(color) {
+
+}
+
+SolidEffect::~SolidEffect() {
+
+}
+
+void SolidEffect::render(LedBuffer *leds, uint32_t now) {
+	(void) now;
+	leds->fill(Color);
+}
+
+NoiseEffect::NoiseEffect(uint16_t scale, uint16_t speed) :
+		Effect("noise"), Scale(scale), Speed(speed) {
+
+}
+
+NoiseEffect::~NoiseEffect() {
+
+}
+
+void NoiseEffect::render(LedBuffer *leds, uint32_t now) {
+	// now * Speed / 1000 split into whole seconds and the rest, the product would overflow 32 bits after
+	// 2^32 / Speed ms and jump the noise field, this way t only wraps with its own 16 bits
+	uint16_t t = (now / 1000) * Speed + ((now % 1000) * Speed) / 1000;
+	uint16_t x = 0;
+	for (int i = 0; i < leds->getNumLeds(); i++, x += Scale) {
+		leds->setLed(i, Noise::noise8(x, t), Noise::noise8(x + 0x5500, t), Noise::noise8(x + 0xAA00, t));
+	}
+}
+
+FireEffect::FireEffect(uint8_t *heat, uint16_t numLeds, uint8_t cooling, uint8_t sparking) :
+		Effect("fire"), Heat(heat), NumLeds(numLeds), Cooling(cooling), Sparking(sparking) {
+
+}
+
+FireEffect::~FireEffect() {
+
+}
+
+void FireEffect::start(LedBuffer *leds, uint32_t now) {
+	(void) leds;
+	(void) now;
+	memset(Heat, 0, NumLeds);
+}
+
+void FireEffect::render(LedBuffer *leds, uint32_t now) {
+	(void) now;
+	uint16_t n = NumLeds < leds->getNumLeds() ? NumLeds : leds->getNumLeds();
+	int i;
+	if (n == 0)
+		return;
+	// short strands cool faster, up to the whole heat range
+	uint16_t cooling = ((Cooling * 10) / n) + 2;
+	uint8_t maxCooling = cooling > 255 ? 255 : cooling;
+
+	for (i = 0; i < n; i++) {
+		Heat[i] = qsub8(Heat[i], random8(0, maxCooling));
+	}
+	for (i = n - 1; i >= 2; i--) {
+		Heat[i] = (Heat[i - 1] + Heat[i - 2] + Heat[i - 2]) / 3;
+	}
+	if (random8() < Sparking) {
+		uint8_t y = random8(0, n < 7 ? n : 7);
+		Heat[y] = qadd8(Heat[y], random8(160, 255));
+	}
+	for (i = 0; i < n; i++) {
+		const uint8_t *c = heatColor(Heat[i]);
+		leds->setLed(i, c[0], c[1], c[2]);
+	}
+}
+
+PlasmaEffect::PlasmaEffect(uint8_t scale, uint8_t speed) :
+		Effect("plasma"), Scale(scale), Speed(speed) {
+
+}
+
+PlasmaEffect::~PlasmaEffect() {
+
+}
+
+void PlasmaEffect::render(LedBuffer *leds, uint32_t now) {
+	uint8_t t1 = phase(now, Speed);
+	uint8_t t2 = t1 / 3;
+	uint8_t p1 = t1, p2 = 0;
+	for (int i = 0; i < leds->getNumLeds(); i++, p1 += Scale, p2 += Scale / 2 + 1) {
+		uint8_t v = (sin8(p1) + sin8(p2 - t2)) >> 1;
+		leds->setLed(i, sin8(v), sin8(v + 85), sin8(v + 170));
+	}
+}
+
+SineWaveEffect::SineWaveEffect(const RGB &color, uint8_t wavelength, uint8_t speed) :
+		Effect("sinewave"), Color(color), Wavelength(wavelength), Speed(speed) {
+
+}
+
+SineWaveEffect::~SineWaveEffect() {
+
+}
+
+void SineWaveEffect::render(LedBuffer *leds, uint32_t now) {
+	uint8_t p = -phase(now, Speed);
+	for (int i = 0; i < leds->getNumLeds(); i++, p += Wavelength) {
+		uint8_t b = sin8(p);
+		leds->setLed(i, scale8(Color.getR(), b), scale8(Color.getG(), b), scale8(Color.getB(), b));
+	}
+}
+
+ColorWipeEffect::ColorWipeEffect(const RGB &color, uint16_t msPerLed) :
+		Effect("colorwipe"), Color(color), MSPerLed(msPerLed ? msPerLed : 1), Start(0), Clearing(false) {
+
+}
+
+ColorWipeEffect::~ColorWipeEffect() {
+
+}
+
+void ColorWipeEffect::start(LedBuffer *leds, uint32_t now) {
+	leds->fill(RGB::BLACK);
+	Start = now;
+	Clearing = false;
+}
+
+void ColorWipeEffect::render(LedBuffer *leds, uint32_t now) {
+	uint32_t pos = (now - Start) / MSPerLed;
+	if (pos >= leds->getNumLeds()) {
+		leds->fill(Clearing ? RGB::BLACK : Color);
+		Clearing = !Clearing;
+		Start = now;
+		return;
+	}
+	const RGB &c = Clearing ? RGB::BLACK : Color;
+	for (uint32_t i = 0; i <= pos; i++) {
+		leds->setLed(i, c);
+	}
+}
@@ -0,0 +1,116 @@
+#ifndef __EFFECTS_H__
+#define __EFFECTS_H__
+
+#include "effect.h"
+
+namespace cmdc0de {
+
+/*
+ * Every led gets a new random color each HoldMS milliseconds.
+ */
+class RandomEffect : public Effect {
+public:
+	RandomEffect(uint32_t holdMS);
+	virtual ~RandomEffect();
+	virtual void start(LedBuffer *leds, uint32_t now);
+	virtual void render(LedBuffer *leds, uint32_t now);
+private:
+	uint32_t HoldMS;
+	uint32_t NextChange;
+};
+
+/*
+ * Whole strand one color.
+ */
+class SolidEffect : public Effect {
+public:
+	SolidEffect(const RGB &color);
+	virtual ~SolidEffect();
+	void setColor(const RGB &color) {Color = color;}
+	virtual void render(LedBuffer *leds, uint32_t now);
+private:
+	RGB Color;
+};
+
+/*
+ * Slowly drifting color clouds, each channel is its own 2D noise field (position, time).
+ * Scale is how far apart neighbouring leds are in noise space (256 = one lattice cell),
+ * Speed is how many noise units time moves per second.
+ */
+class NoiseEffect : public Effect {
+public:
+	NoiseEffect(uint16_t scale, uint16_t speed);
+	virtual ~NoiseEffect();
+	virtual void render(LedBuffer *leds, uint32_t now);
+private:
+	uint16_t Scale;
+	uint16_t Speed;
+};
+
+/*
+ * Fire2012 style fire: every frame the cells cool, heat drifts up the strand and new sparks ignite at the base.
+ * heat must hold one byte per led.  It advances one step per render so it is tuned for ~50 fps.
+ * Cooling 20-100 (higher = shorter flames), sparking 50-200 (chance out of 255 of a new spark per frame).
+ */
+class FireEffect : public Effect {
+public:
+	FireEffect(uint8_t *heat, uint16_t numLeds, uint8_t cooling, uint8_t sparking);
+	virtual ~FireEffect();
+	virtual void start(LedBuffer *leds, uint32_t now);
+	virtual void render(LedBuffer *leds, uint32_t now);
+private:
+	uint8_t *Heat;
+	uint16_t NumLeds;
+	uint8_t Cooling;
+	uint8_t Sparking;
+};
+
+/*
+ * Two interfering sine waves mapped through a sine rainbow.
+ * Scale is phase step between leds (0-255 is one period), Speed is periods per 10 seconds.
+ */
+class PlasmaEffect : public Effect {
+public:
+	PlasmaEffect(uint8_t scale, uint8_t speed);
+	virtual ~PlasmaEffect();
+	virtual void render(LedBuffer *leds, uint32_t now);
+private:
+	uint8_t Scale;
+	uint8_t Speed;
+};
+
+/*
+ * Travelling sine shaped brightness wave of one color.
+ * Wavelength is the phase step between leds (0-255 is one period), Speed is periods per 10 seconds.
+ */
+class SineWaveEffect : public Effect {
+public:
+	SineWaveEffect(const RGB &color, uint8_t wavelength, uint8_t speed);
+	virtual ~SineWaveEffect();
+	virtual void render(LedBuffer *leds, uint32_t now);
+private:
+	RGB Color;
+	uint8_t Wavelength;
+	uint8_t Speed;
+};
+
+/*
+ * Paints the strand one led at a time with Color, then wipes it back to black, and repeats.
+ */
+class ColorWipeEffect : public Effect {
+public:
+	//msPerLed 0 is taken as 1
+	ColorWipeEffect(const RGB &color, uint16_t msPerLed);
+	virtual ~ColorWipeEffect();
+	virtual void start(LedBuffer *leds, uint32_t now);
+	virtual void render(LedBuffer *leds, uint32_t now);
+private:
+	RGB Color;
+	uint16_t MSPerLed;
+	uint32_t Start;
+	bool Clearing;
+};
+
+} //cmdc0de
+
+#endif
@@ -0,0 +1,180 @@
+#include "font.h"
+
+using cmdc0de::Font;
+using cmdc0de::TextScroller;
+using cmdc0de::LedMatrix;
+using cmdc0de::LedBuffer;
+using cmdc0de::RGB;
+
+static const char FIRST_CHAR = ' ';
+static const char LAST_CHAR = '~';
+
+static const uint8_t Glyphs[(LAST_CHAR - FIRST_CHAR + 1) * Font::GLYPH_WIDTH] = {
+		0x00, 0x00, 0x00, 0x00, 0x00, // ' '
+		0x00, 0x00, 0x5F, 0x00, 0x00, // !
+		0x00, 0x07, 0x00, 0x07, 0x00, // "
+		0x14, 0x7F, 0x14, 0x7F, 0x14, // #
+		0x24, 0x2A, 0x7F, 0x2A, 0x12, // $
+		0x23, 0x13, 0x08, 0x64, 0x62, // %
+		0x36, 0x49, 0x55, 0x22, 0x50, // &
+		0x00, 0x05, 0x03, 0x00, 0x00, // '
+		0x00, 0x1C, 0x22, 0x41, 0x00, // (
+		0x00, 0x41, 0x22, 0x1C, 0x00, // )
+		0x08, 0x2A, 0x1C, 0x2A, 0x08, // *
+		0x08, 0x08, 0x3E, 0x08, 0x08, // +
+		0x00, 0x50, 0x30, 0x00, 0x00, // ,
+		0x08, 0x08, 0x08, 0x08, 0x08, // -
+		0x00, 0x60, 0x60, 0x00, 0x00, // .
+		0x20, 0x10, 0x08, 0x04, 0x02, // /
+		0x3E, 0x51, 0x49, 0x45, 0x3E, // 0
+		0x00, 0x42, 0x7F, 0x40, 0x00, // 1
+		0x42, 0x61, 0x51, 0x49, 0x46, // 2
+		0x21, 0x41, 0x45, 0x4B, 0x31, // 3
+		0x18, 0x14, 0x12, 0x7F, 0x10, // 4
+		0x27, 0x45, 0x45, 0x45, 0x39, // 5
+		0x3C, 0x4A, 0x49, 0x49, 0x30, // 6
+		0x01, 0x71, 0x09, 0x05, 0x03, // 7
+		0x36, 0x49, 0x49, 0x49, 0x36, // 8
+		0x06, 0x49, 0x49, 0x29, 0x1E, // 9
+		0x00, 0x36, 0x36, 0x00, 0x00, // :
+		0x00, 0x56, 0x36, 0x00, 0x00, // ;
+		0x08, 0x14, 0x22, 0x41, 0x00, // <
+		0x14, 0x14, 0x14, 0x14, 0x14, // =
+		0x00, 0x41, 0x22, 0x14, 0x08, // >
+		0x02, 0x01, 0x51, 0x09, 0x06, // ?
+		0x32, 0x49, 0x79, 0x41, 0x3E, // @
+		0x7E, 0x11, 0x11, 0x11, 0x7E, // A
+		0x7F, 0x49, 0x49, 0x49, 0x36, // B
+		0x3E, 0x41, 0x41, 0x41, 0x22, // C
+		0x7F, 0x41, 0x41, 0x22, 0x1C, // D
+		0x7F, 0x49, 0x49, 0x49, 0x41, // E
+		0x7F, 0x09, 0x09, 0x09, 0x01, // F
+		0x3E, 0x41, 0x49, 0x49, 0x7A, // G
+		0x7F, 0x08, 0x08, 0x08, 0x7F, // H
+		0x00, 0x41, 0x7F, 0x41, 0x00, // I
+		0x20, 0x40, 0x41, 0x3F, 0x01, // J
+		0x7F, 0x08, 0x14, 0x22, 0x41, // K
+		0x7F, 0x40, 0x40, 0x40, 0x40, // L
+		0x7F, 0x02, 0x0C, 0x02, 0x7F, // M
+		0x7F, 0x04, 0x08, 0x10, 0x7F, // N
+		0x3E, 0x41, 0x41, 0x41, 0x3E, // O
+		0x7F, 0x09, 0x09, 0x09, 0x06, // P
+		0x3E, 0x41, 0x51, 0x21, 0x5E, // Q
+		0x7F, 0x09, 0x19, 0x29, 0x46, // R
+		0x46, 0x49, 0x49, 0x49, 0x31, // S
+		0x01, 0x01, 0x7F, 0x01, 0x01, // T
+		0x3F, 0x40, 0x40, 0x40, 0x3F, // U
+		0x1F, 0x20, 0x40, 0x20, 0x1F, // V
+		0x3F, 0x40, 0x38, 0x40, 0x3F, // W
+		0x63, 0x14, 0x08, 0x14, 0x63, // X
+		0x07, 0x08, 0x70, 0x08, 0x07, // Y
+		0x61, 0x51, 0x49, 0x45, 0x43, // Z
+		0x00, 0x7F, 0x41, 0x41, 0x00, // [
+		0x02, 0x04, 0x08, 0x10, 0x20, // backslash
+		0x00, 0x41, 0x41, 0x7F, 0x00, // ]
+		0x04, 0x02, 0x01, 0x02, 0x04, // ^
+		0x40, 0x40, 0x40, 0x40, 0x40, // _
+		0x00, 0x01, 0x02, 0x04, 0x00, // `
+		0x20, 0x54, 0x54, 0x54, 0x78, // a
+		0x7F, 0x48, 0x44, 0x44, 0x38, // b
+		0x38, 0x44, 0x44, 0x44, 0x20, // c
+		0x38, 0x44, 0x44, 0x48, 0x7F, // d
+		0x38, 0x54, 0x54, 0x54, 0x18, // e
+		0x08, 0x7E, 0x09, 0x01, 0x02, // f
+		0x0C, 0x52, 0x52, 0x52, 0x3E, // g
+		0x7F, 0x08, 0x04, 0x04, 0x78, // h
+		0x00, 0x44, 0x7D, 0x40, 0x00, // i
+		0x20, 0x40, 0x44, 0x3D, 0x00, // j
+		0x7F, 0x10, 0x28, 0x44, 0x00, // k
+		0x00, 0x41, 0x7F, 0x40, 0x00, // l
+		0x7C, 0x04, 0x18, 0x04, 0x78, // m
+		0x7C, 0x08, 0x04, 0x04, 0x78, // n
+		0x38, 0x44, 0x44, 0x44, 0x38, // o
+		0x7C, 0x14, 0x14, 0x14, 0x08, // p
+		0x08, 0x14, 0x14, 0x18, 0x7C, // q
+		0x7C, 0x08, 0x04, 0x04, 0x08, // r
+		0x48, 0x54, 0x54, 0x54, 0x20, // s
+		0x04, 0x3F, 0x44, 0x40, 0x20, // t
+		0x3C, 0x40, 0x40, 0x20, 0x7C, // u
+		0x1C, 0x20, 0x40, 0x20, 0x1C, // v
+		0x3C, 0x40, 0x30, 0x40, 0x3C, // w
+		0x44, 0x28, 0x10, 0x28, 0x44, // x
+		0x0C, 0x50, 0x50, 0x50, 0x3C, // y
+		0x44, 0x64, 0x54, 0x4C, 0x44, // z
+		0x00, 0x08, 0x36, 0x41, 0x00, // {
+		0x00, 0x00, 0x7F, 0x00, 0x00, // |
+		0x00, 0x41, 0x36, 0x08, 0x00, // }
+		0x08, 0x04, 0x08, 0x10, 0x08, // ~
+};
+
+const uint8_t *Font::glyph(char c) {
+	if (c < FIRST_CHAR || c > LAST_CHAR)
+		c = '?';
+	return &Glyphs[(c - FIRST_CHAR) * GLYPH_WIDTH];
+}
+
+uint16_t Font::textWidth(const char *text) {
+	uint16_t n = 0;
+	while (text[n])
+		n++;
+	return n * ADVANCE;
+}
+
+void Font::drawText(LedMatrix *matrix, int16_t x, int16_t y, const char *text, const RGB &color) {
+	// skip the characters that are entirely left of the matrix
+	while (*text && x + GLYPH_WIDTH <= 0) {
+		text++;
+		x += ADVANCE;
+	}
+	for (uint8_t row = 0; row < GLYPH_HEIGHT; row++) {
+		if (y + row < 0 || y + row >= matrix->getHeight())
+			continue;
+		uint8_t mask = 1 << row;
+		int16_t runStart = -1;
+		int16_t cx = x;
+		for (const char *c = text; *c && cx < matrix->getWidth(); c++, cx += ADVANCE) {
+			const uint8_t *g = glyph(*c);
+			for (uint8_t col = 0; col < ADVANCE; col++) {
+				bool lit = col < GLYPH_WIDTH && (g[col] & mask);
+				if (lit && runStart < 0) {
+					runStart = cx + col;
+				} else if (!lit && runStart >= 0) {
+					matrix->fillRow(y + row, runStart, cx + col - 1, color);
+					runStart = -1;
+				}
+			}
+		}
+		// the advance column is always blank so runs never cross the end of the text
+	}
+}
+
+TextScroller::TextScroller(LedMatrix *matrix, const char *text, const RGB &color, const RGB &background,
+		uint16_t pixelsPerSecond) :
+		Effect("text"), Matrix(matrix), Text(text), TextWidth(Font::textWidth(text)), Color(color),
+				Background(background), PixelsPerSecond(pixelsPerSecond ? pixelsPerSecond : 1), Start(0) {
+
+}
+
+TextScroller::~TextScroller() {
+
+}
+
+void TextScroller::setText(const char *text) {
+	Text = text;
+	TextWidth = Font::textWidth(text);
+}
+
+void TextScroller::start(LedBuffer *leds, uint32_t now) {
+	(void) leds;
+	Start = now;
+}
+
+void TextScroller::render(LedBuffer *leds, uint32_t now) {
+	(void) leds;
+	// text enters at the right edge and is gone once it has moved its own width past the left edge
+	uint32_t travel = Matrix->getWidth() + TextWidth;
+	uint32_t offset = (((now - Start) % (travel * 1000u / PixelsPerSecond + 1)) * PixelsPerSecond) / 1000u;
+	int16_t top = (Matrix->getHeight() - Font::GLYPH_HEIGHT) / 2;
+	Matrix->fill(Background);
+	Font::drawText(Matrix, Matrix->getWidth() - offset, top, Text, Color);
+}
@@ -0,0 +1,53 @@
+#ifndef __FONT_H__
+#define __FONT_H__
+
+#include "ledmatrix.h"
+#include "effect.h"
+
+namespace cmdc0de {
+
+/*
+ * 5x7 bitmap font for printable ASCII (32-126), 475 bytes of flash.
+ * Glyphs are stored as 5 column bytes with bit 0 the top row, characters advance 6 pixels.
+ * Text is drawn row by row and every horizontal run of lit pixels becomes one LedMatrix::fillRow,
+ * so the layout mapping is done per run rather than per pixel.
+ */
+class Font {
+public:
+	static const uint8_t GLYPH_WIDTH = 5;
+	static const uint8_t GLYPH_HEIGHT = 7;
+	static const uint8_t ADVANCE = GLYPH_WIDTH + 1;
+public:
+	//5 column bytes of the glyph, characters outside 32-126 draw as '?'
+	static const uint8_t *glyph(char c);
+	static uint16_t textWidth(const char *text);
+	//x may be negative, only lit pixels are written
+	static void drawText(LedMatrix *matrix, int16_t x, int16_t y, const char *text, const RGB &color);
+};
+
+/*
+ * Ticker that scrolls text right to left across the matrix at PixelsPerSecond and starts over once the
+ * text has left the screen. The leds passed to render are ignored, the matrix knows its strands.
+ */
+class TextScroller : public Effect {
+public:
+	//pixelsPerSecond 0 is taken as 1
+	TextScroller(LedMatrix *matrix, const char *text, const RGB &color, const RGB &background,
+			uint16_t pixelsPerSecond);
+	virtual ~TextScroller();
+	void setText(const char *text);
+	virtual void start(LedBuffer *leds, uint32_t now);
+	virtual void render(LedBuffer *leds, uint32_t now);
+private:
+	LedMatrix *Matrix;
+	const char *Text;
+	uint16_t TextWidth;
+	RGB Color;
+	RGB Background;
+	uint16_t PixelsPerSecond;
+	uint32_t Start;
+};
+
+} //cmdc0de
+
+#endif
@@ -0,0 +1,179 @@
+#include "framecodec.h"
+#include <string.h>
+
+using cmdc0de::FrameDecoder;
+using cmdc0de::FrameEncoder;
+using cmdc0de::LedBuffer;
+
+FrameDecoder::FrameDecoder() :
+		Leds(0), Format(RAW), Pixels(0), Room(0), Pos(0), Op(), OpFill(0), Literal(0), Invalid(false) {
+
+}
+
+FrameDecoder::~FrameDecoder() {
+
+}
+
+void FrameDecoder::begin(LedBuffer *leds, FORMAT format, LedBuffer *base) {
+	Leds = leds;
+	Format = format;
+	Pixels = leds->getLeds();
+	Room = leds->getNumLeds() * 3;
+	Pos = 0;
+	OpFill = 0;
+	Literal = 0;
+	Invalid = false;
+	if (leds->getBitsPerLed() != 24 || (format == DELTA && base != 0 && base->getBitsPerLed() != 24)) {
+		// nothing fits 3 bytes per led in there, drop the payload
+		Room = 0;
+		Invalid = true;
+		return;
+	}
+	if (format == DELTA && base != 0 && base != leds) {
+		uint32_t n = base->getNumLeds() * 3;
+		memcpy(Pixels, base->getLeds(), n < Room ? n : Room);
+	}
+}
+
+void FrameDecoder::feed(const uint8_t *bytes, uint32_t len) {
+	uint32_t i = 0;
+	while (i < len) {
+		if (Format == RAW) {
+			uint32_t n = len - i;
+			if (Pos < Room)
+				memcpy(&Pixels[Pos], &bytes[i], (Room - Pos) < n ? Room - Pos : n);
+			Pos += n;
+			return;
+		}
+		if (Literal > 0) {
+			// DELTA pixels go in as one copy per piece
+			uint32_t n = len - i < Literal ? len - i : Literal;
+			if (Pos < Room)
+				memcpy(&Pixels[Pos], &bytes[i], (Room - Pos) < n ? Room - Pos : n);
+			Pos += n;
+			Literal -= n;
+			i += n;
+			continue;
+		}
+		Op[OpFill++] = bytes[i++];
+		if (Format == RLE && OpFill == 4) {
+			OpFill = 0;
+			if (Op[0] == 0) {
+				Invalid = true;
+				return;
+			}
+			for (uint8_t c = 0; c < Op[0]; c++, Pos += 3) {
+				if (Pos + 3 <= Room) {
+					Pixels[Pos] = Op[1];
+					Pixels[Pos + 1] = Op[2];
+					Pixels[Pos + 2] = Op[3];
+				}
+			}
+		} else if (Format == DELTA && OpFill == 2) {
+			OpFill = 0;
+			Pos += Op[0] * 3;
+			Literal = Op[1] * 3;
+		}
+	}
+}
+
+bool FrameDecoder::finish() {
+	if (Invalid || OpFill != 0 || Literal != 0)
+		return false;
+	if (Format != DELTA && Pos < Room)
+		memset(&Pixels[Pos], 0, Room - Pos);
+	return true;
+}
+
+uint32_t FrameEncoder::raw(const uint8_t *frame, uint16_t numLeds, uint8_t *out, uint32_t outSize) {
+	uint32_t n = numLeds * 3;
+	if (out) {
+		if (n > outSize)
+			return 0;
+		memcpy(out, frame, n);
+	}
+	return n;
+}
+
+uint32_t FrameEncoder::rle(const uint8_t *frame, uint16_t numLeds, uint8_t *out, uint32_t outSize) {
+	uint32_t size = 0;
+	uint16_t led = 0;
+	while (led < numLeds) {
+		const uint8_t *c = &frame[led * 3];
+		uint16_t count = 1;
+		while (led + count < numLeds && count < 255 && memcmp(&frame[(led + count) * 3], c, 3) == 0)
+			count++;
+		if (out) {
+			if (size + 4 > outSize)
+				return 0;
+			out[size] = count;
+			memcpy(&out[size + 1], c, 3);
+		}
+		size += 4;
+		led += count;
+	}
+	return size;
+}
+
+uint32_t FrameEncoder::delta(const uint8_t *prev, const uint8_t *frame, uint16_t numLeds, uint8_t *out,
+		uint32_t outSize) {
+	uint32_t size = 0;
+	uint16_t led = 0;
+	while (led < numLeds) {
+		uint16_t skip = 0;
+		while (led + skip < numLeds && memcmp(&prev[(led + skip) * 3], &frame[(led + skip) * 3], 3) == 0)
+			skip++;
+		// an op header is 2 bytes and a literal pixel 3, so any unchanged gap is worth a new op
+		while (skip > 255) {
+			if (out) {
+				if (size + 2 > outSize)
+					return 0;
+				out[size] = 255;
+				out[size + 1] = 0;
+			}
+			size += 2;
+			skip -= 255;
+			led += 255;
+		}
+		led += skip;
+		uint16_t count = 0;
+		while (led + count < numLeds && count < 255 && memcmp(&prev[(led + count) * 3], &frame[(led + count) * 3], 3) != 0)
+			count++;
+		if (out) {
+			if (size + 2 + count * 3 > outSize)
+				return 0;
+			out[size] = skip;
+			out[size + 1] = count;
+			memcpy(&out[size + 2], &frame[led * 3], count * 3);
+		}
+		size += 2 + count * 3;
+		led += count;
+	}
+	return size;
+}
+
+uint32_t FrameEncoder::smallest(const uint8_t *prev, const uint8_t *frame, uint16_t numLeds, uint8_t *out,
+		uint32_t outSize, uint8_t &format) {
+	uint32_t best = raw(frame, numLeds, 0, 0);
+	uint32_t n = rle(frame, numLeds, 0, 0);
+	format = FrameDecoder::RAW;
+	if (n < best) {
+		best = n;
+		format = FrameDecoder::RLE;
+	}
+	if (prev) {
+		n = delta(prev, frame, numLeds, 0, 0);
+		if (n < best) {
+			best = n;
+			format = FrameDecoder::DELTA;
+		}
+	}
+	switch (format) {
+	case FrameDecoder::RLE:
+		return rle(frame, numLeds, out, outSize);
+	case FrameDecoder::DELTA:
+		return delta(prev, frame, numLeds, out, outSize);
+	default:
+		return raw(frame, numLeds, out, outSize);
+	}
+}
@@ -0,0 +1,65 @@
+#ifndef __FRAMECODEC_H__
+#define __FRAMECODEC_H__
+
+#include "ledbuffer.h"
+
+namespace cmdc0de {
+
+/*
+ * Pixel frame encodings, the payload layouts are the ones AnimationPlayer plays (same format numbers):
+ * 	RAW:   R,G,B per led
+ * 	RLE:   runs of [count 1-255][R][G][B]
+ * 	DELTA: [skip 0-255][count 0-255][count * R,G,B] against the previous frame, skipped leds keep their color,
+ * 	       the ops run to the last led so a trailing unchanged stretch is still a [skip][0] op
+ *
+ * FrameDecoder takes a payload in whatever pieces a receiver gets it and writes straight into the raw pixels
+ * of an RGB LedBuffer, nothing is staged. Leds the payload does not reach are black for RAW/RLE, data past the
+ * end of the buffer is dropped (a shorter strand can share a longer stream). The caller only publishes the
+ * buffer if the packet passed its CRC and finish returns true. A packed buffer (getBitsPerLed not 24) is
+ * left alone and finish returns false.
+ *
+ * FrameEncoder builds the payloads on the host, passing out as 0 only counts the bytes.
+ */
+class FrameDecoder {
+public:
+	enum FORMAT {
+		RAW = 1,
+		RLE = 2,
+		DELTA = 3
+	};
+public:
+	FrameDecoder();
+	~FrameDecoder();
+	//for DELTA base (the frame the delta was made against) is copied into leds first, 0 uses what leds holds
+	void begin(LedBuffer *leds, FORMAT format, LedBuffer *base);
+	void feed(const uint8_t *bytes, uint32_t len);
+	//false if the payload stopped inside a run or held a zero length RLE run
+	bool finish();
+private:
+	LedBuffer *Leds;
+	FORMAT Format;
+	uint8_t *Pixels;
+	uint32_t Room;
+	uint32_t Pos;
+	//bytes of the current run header, RLE needs 4 and DELTA 2
+	uint8_t Op[4];
+	uint8_t OpFill;
+	//literal bytes still to come in the current DELTA run
+	uint32_t Literal;
+	bool Invalid;
+};
+
+class FrameEncoder {
+public:
+	//each returns the number of payload bytes or 0 if out is not big enough
+	static uint32_t raw(const uint8_t *frame, uint16_t numLeds, uint8_t *out, uint32_t outSize);
+	static uint32_t rle(const uint8_t *frame, uint16_t numLeds, uint8_t *out, uint32_t outSize);
+	static uint32_t delta(const uint8_t *prev, const uint8_t *frame, uint16_t numLeds, uint8_t *out, uint32_t outSize);
+	//writes whichever of the three is smallest (no delta when prev is 0) and returns its FrameDecoder::FORMAT in format
+	static uint32_t smallest(const uint8_t *prev, const uint8_t *frame, uint16_t numLeds, uint8_t *out,
+			uint32_t outSize, uint8_t &format);
+};
+
+} //cmdc0de
+
+#endif
@@ -0,0 +1,127 @@
+#include "framesync.h"
+#include "cyclecounter.h"
+
+using cmdc0de::FrameSync;
+using cmdc0de::WS2818;
+using cmdc0de::LedBuffer;
+using cmdc0de::CycleCounter;
+
+static const uint16_t SYNC_PIN = GPIO_Pin_0;
+static const uint16_t ACK_PIN = GPIO_Pin_1;
+//10us at 72MHz
+static const uint32_t DEFAULT_ACK_WINDOW = 720;
+
+// the pending bit is set by the edge whether or not the interrupt can run, stamp the first pass that sees it
+static inline void pollAck(bool &acked, uint32_t &ack) {
+	if (!acked && (EXTI->PR & EXTI_Line1)) {
+		ack = CycleCounter::now();
+		acked = true;
+	}
+}
+
+FrameSync::FrameSync(ROLE role, WS2818 *strand) :
+		Role(role), Strand(strand), FireDelay(0), AckWindow(DEFAULT_ACK_WINDOW), Syncs(0), Missed(0), LateAcks(0),
+				LastSkew(0), MaxSkew(0), Latency(0) {
+
+}
+
+FrameSync::~FrameSync() {
+
+}
+
+void FrameSync::init(uint8_t irqPriority) {
+	GPIO_InitTypeDef gpio;
+	EXTI_InitTypeDef exti;
+	NVIC_InitTypeDef nvic;
+	uint16_t in = Role == MASTER ? ACK_PIN : SYNC_PIN;
+
+	CycleCounter::init();
+	RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOB | RCC_APB2Periph_AFIO, ENABLE);
+	GPIO_ResetBits(GPIOB, SYNC_PIN | ACK_PIN);
+	gpio.GPIO_Pin = Role == MASTER ? SYNC_PIN : ACK_PIN;
+	gpio.GPIO_Mode = GPIO_Mode_Out_PP;
+	gpio.GPIO_Speed = GPIO_Speed_50MHz;
+	GPIO_Init(GPIOB, &gpio);
+	gpio.GPIO_Pin = in;
+	gpio.GPIO_Mode = GPIO_Mode_IPD;
+	GPIO_Init(GPIOB, &gpio);
+
+	GPIO_EXTILineConfig(GPIO_PortSourceGPIOB, Role == MASTER ? GPIO_PinSource1 : GPIO_PinSource0);
+	exti.EXTI_Line = Role == MASTER ? EXTI_Line1 : EXTI_Line0;
+	exti.EXTI_Mode = EXTI_Mode_Interrupt;
+	exti.EXTI_Trigger = EXTI_Trigger_Rising;
+	exti.EXTI_LineCmd = ENABLE;
+	EXTI_Init(&exti);
+
+	nvic.NVIC_IRQChannel = Role == MASTER ? EXTI1_IRQn : EXTI0_IRQn;
+	nvic.NVIC_IRQChannelPreemptionPriority = irqPriority;
+	nvic.NVIC_IRQChannelSubPriority = 0;
+	nvic.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_Init(&nvic);
+}
+
+void FrameSync::recordSkew(int32_t skew) {
+	LastSkew = skew;
+	uint32_t magnitude = skew < 0 ? -skew : skew;
+	if (magnitude > MaxSkew)
+		MaxSkew = magnitude;
+}
+
+bool FrameSync::arm(LedBuffer *colorLeds, uint32_t timeOut) {
+	bool ok;
+	if (Role == MASTER) {
+		// the edges are rising only, SYNC has to be low again before the next trigger
+		GPIOB->BRR = SYNC_PIN;
+		return Strand->prepareColors(colorLeds, timeOut);
+	}
+	GPIOB->BRR = ACK_PIN;
+	// the edge must not start the strand while the DMA buffer is half encoded
+	NVIC_DisableIRQ(EXTI0_IRQn);
+	ok = Strand->prepareColors(colorLeds, timeOut);
+	NVIC_EnableIRQ(EXTI0_IRQn);
+	return ok;
+}
+
+bool FrameSync::trigger() {
+	if (Role != MASTER || !Strand->isPrepared())
+		return false;
+	bool acked = false;
+	uint32_t ack = 0;
+	__disable_irq();
+	EXTI->PR = EXTI_Line1;
+	GPIOB->BSRR = SYNC_PIN;
+	uint32_t start = CycleCounter::now();
+	while (CycleCounter::since(start) < FireDelay)
+		pollAck(acked, ack);
+	Strand->fire();
+	uint32_t fired = CycleCounter::now();
+	while (!acked && CycleCounter::since(fired) < AckWindow)
+		pollAck(acked, ack);
+	if (acked)
+		EXTI->PR = EXTI_Line1;
+	__enable_irq();
+	if (acked)
+		recordSkew((int32_t) (ack - fired));
+	Syncs++;
+	return true;
+}
+
+void FrameSync::handleEXTIISR() {
+	uint32_t entry = CycleCounter::now();
+	if (EXTI->PR & EXTI_Line0) {
+		EXTI->PR = EXTI_Line0;
+		if (Strand->isPrepared()) {
+			Strand->fire();
+			GPIOB->BSRR = ACK_PIN;
+			Latency = CycleCounter::since(entry);
+			Syncs++;
+		} else {
+			Missed++;
+		}
+	}
+	if (EXTI->PR & EXTI_Line1) {
+		// trigger stopped waiting for it
+		EXTI->PR = EXTI_Line1;
+		LateAcks++;
+	}
+}
@@ -0,0 +1,77 @@
+#ifndef __FRAMESYNC_H__
+#define __FRAMESYNC_H__
+
+#include "ws2812.h"
+
+namespace cmdc0de {
+
+/*
+ * Starts the strands of several boards on the same edge so the seams of an installation do not tear.
+ *
+ * 	SYNC PB0: the master drives it, every slave has it on EXTI line 0 (rising edge)
+ * 	ACK  PB1: a slave raises it right after its strand started, the master has it on EXTI line 1
+ *
+ * Every board prepares its next frame ahead of time (WS2818::prepareColors, the first DMA half is encoded
+ * and the channel loaded) so starting it is a single timer enable. The master raises SYNC and starts its own
+ * strand FireDelay cycles later, slaves start theirs from the EXTI interrupt. With the interrupt at priority 0
+ * that is a fixed ~30 cycles (<0.5us at 72MHz) after the edge, FireDelay lets the master match it.
+ * A slave that is not armed when the edge comes counts a missed sync and sends nothing, it should render at
+ * least as often as the master triggers.
+ *
+ * Skew: wire one slave's ACK to the master's ACK input. trigger keeps interrupts off from the SYNC edge until
+ * AckWindow cycles after the master started and polls the EXTI pending bit of line 1 with the DWT cycle
+ * counter running, so an ACK that comes during FireDelay is seen as well. getLastSkew is ACK minus master
+ * start in core cycles, positive means the slave started later, negative earlier. It is good to one pass of
+ * the poll loop (a few cycles), the slave's ACK write adds ~3. An ACK after the window is only counted
+ * (getLateAcks, from the EXTI interrupt), keep the window well under one led time (30us) as the strand
+ * interrupts wait for it. Each slave reports its own interrupt entry to start time with getLatency (the entry
+ * itself is 12 more).
+ */
+class FrameSync {
+public:
+	enum ROLE {
+		MASTER,
+		SLAVE
+	};
+public:
+	FrameSync(ROLE role, WS2818 *strand);
+	~FrameSync();
+	//use priority 0, anything that can hold off the EXTI interrupt shows up as skew
+	void init(uint8_t irqPriority);
+	//prepares the strand with the frame, re-arming replaces a frame that was not started yet
+	bool arm(LedBuffer *colorLeds, uint32_t timeOut);
+	//master only, raises SYNC and starts the local strand, false if nothing was armed
+	bool trigger();
+	//handles EXTI lines 0 and 1
+	void handleEXTIISR();
+	bool isArmed() const {return Strand->isPrepared();}
+	//cycles the master waits between the SYNC edge and starting its own strand
+	void setFireDelay(uint32_t cycles) {FireDelay = cycles;}
+	//cycles after the master start trigger waits for the ACK, 0 stops measuring skew
+	void setAckWindow(uint32_t cycles) {AckWindow = cycles;}
+	uint32_t getSyncs() const {return Syncs;}
+	uint32_t getMissed() const {return Missed;}
+	int32_t getLastSkew() const {return LastSkew;}
+	//largest skew seen (either sign) since resetSkew
+	uint32_t getMaxSkew() const {return MaxSkew;}
+	void resetSkew() {MaxSkew = 0;}
+	uint32_t getLatency() const {return Latency;}
+	uint32_t getLateAcks() const {return LateAcks;}
+protected:
+	void recordSkew(int32_t skew);
+private:
+	ROLE Role;
+	WS2818 *Strand;
+	uint32_t FireDelay;
+	uint32_t AckWindow;
+	volatile uint32_t Syncs;
+	volatile uint32_t Missed;
+	volatile uint32_t LateAcks;
+	int32_t LastSkew;
+	uint32_t MaxSkew;
+	volatile uint32_t Latency;
+};
+
+} //cmdc0de
+
+#endif
@@ -0,0 +1,28 @@
+#include "hwcrc.h"
+
+using cmdc0de::HardwareCrc32;
+
+HardwareCrc32::HardwareCrc32() {
+
+}
+
+HardwareCrc32::~HardwareCrc32() {
+
+}
+
+void HardwareCrc32::init() {
+	RCC_AHBPeriphClockCmd(RCC_AHBPeriph_CRC, ENABLE);
+	CRC_ResetDR();
+}
+
+void HardwareCrc32::reset() {
+	CRC_ResetDR();
+}
+
+void HardwareCrc32::update(uint32_t word) {
+	CRC->DR = word;
+}
+
+uint32_t HardwareCrc32::get() {
+	return CRC_GetCRC();
+}
@@ -0,0 +1,25 @@
+#ifndef __HWCRC_H__
+#define __HWCRC_H__
+
+#include "stm32f10x_conf.h"
+#include "protocol.h"
+
+namespace cmdc0de {
+
+/*
+ * Crc32 on the STM32 CRC unit, one register write per word instead of 32 shift/xor steps.
+ * There is only one unit, so everything using it must run at the same interrupt priority.
+ */
+class HardwareCrc32 : public Crc32 {
+public:
+	HardwareCrc32();
+	virtual ~HardwareCrc32();
+	void init();
+	virtual void reset();
+	virtual void update(uint32_t word);
+	virtual uint32_t get();
+};
+
+} //cmdc0de
+
+#endif
@@ -0,0 +1,110 @@
+#include "ledbuffer.h"
+#include <string.h>
+#include <stdlib.h>
+
+using cmdc0de::RGB;
+using cmdc0de::LedBuffer;
+using cmdc0de::PaletteLedBuffer;
+using cmdc0de::RGB565LedBuffer;
+
+RGB RGB::WHITE(255, 255, 255);
+RGB RGB::BLACK(0, 0, 0);
+RGB RGB::RED(255, 0, 0);
+RGB RGB::GREEN(0, 255, 0);
+RGB RGB::BLUE(0, 0, 255);
+
+RGB::RGB() {
+	Clr[0] = 0;
+	Clr[1] = 0;
+	Clr[2] = 0;
+}
+
+RGB::RGB(uint8_t r, uint8_t g, uint8_t b) {
+	Clr[0] = r;
+	Clr[1] = g;
+	Clr[2] = b;
+}
+
+RGB::~RGB() {
+
+}
+
+const uint8_t *RGB::getArray() const {
+	return &Clr[0];
+}
+
+RGB RGB::createRandomColor() {
+	return RGB(rand() % 256, rand() % 256, rand() % 256);
+}
+
+void LedBuffer::fill(const RGB &color) {
+	for (uint16_t i = 0; i < NumLeds; i++) {
+		memcpy(&LedData[i * 3], color.getArray(), 3);
+	}
+	markAllDirty();
+	ChannelSum = (uint32_t) NumLeds * (color.getR() + color.getG() + color.getB());
+	ChannelSumValid = true;
+}
+
+void LedBuffer::markAllDirty() {
+	if (DirtyBits) {
+		memset(DirtyBits, 0xFF, dirtyMapSize(NumLeds) * sizeof(uint32_t));
+	}
+}
+
+void LedBuffer::recalculateChannelSum() {
+	uint8_t scratch[3];
+	uint32_t sum = 0;
+	for (uint16_t i = 0; i < NumLeds; i++) {
+		const uint8_t *c = getColor(i, scratch);
+		sum += c[0] + c[1] + c[2];
+	}
+	ChannelSum = sum;
+	ChannelSumValid = true;
+}
+
+PaletteLedBuffer::PaletteLedBuffer(uint8_t *indexBuffer, uint16_t numLeds, RGB *palette, uint8_t bitsPerIndex) :
+		LedBuffer(indexBuffer, numLeds), Palette(palette), Mask(bitsPerIndex == 4 ? 0xF : 0xFF), Offset(0) {
+
+}
+
+void PaletteLedBuffer::fill(uint8_t index) {
+	if (Mask == 0xF) {
+		index &= 0xF;
+		index |= (index << 4);
+	}
+	memset(LedData, index, bufferSize(NumLeds, getBitsPerIndex()));
+	invalidate();
+}
+
+uint8_t PaletteLedBuffer::nearestIndex(uint8_t r, uint8_t g, uint8_t b) const {
+	uint32_t best = 0xFFFFFFFF;
+	uint8_t bestEntry = 0;
+	for (uint16_t i = 0; i <= Mask; i++) {
+		int32_t dr = Palette[i].getR() - r;
+		int32_t dg = Palette[i].getG() - g;
+		int32_t db = Palette[i].getB() - b;
+		uint32_t d = dr * dr + dg * dg + db * db;
+		if (d < best) {
+			best = d;
+			bestEntry = i;
+		}
+	}
+	return (bestEntry - Offset) & Mask;
+}
+
+void PaletteLedBuffer::setPaletteEntry(uint8_t index, const RGB &color) {
+	Palette[index & Mask] = color;
+	invalidate();
+}
+
+void RGB565LedBuffer::fill(const RGB &color) {
+	uint16_t p = pack(color.getR(), color.getG(), color.getB());
+	uint16_t *pixels = getPixels();
+	for (uint16_t i = 0; i < NumLeds; i++) {
+		pixels[i] = p;
+	}
+	markAllDirty();
+	ChannelSum = (uint32_t) NumLeds * pixelSum(p);
+	ChannelSumValid = true;
+}
@@ -0,0 +1,355 @@
+#ifndef __LEDBUFFER_H__
+#define __LEDBUFFER_H__
+
+#include <stdint.h>
+
+namespace cmdc0de {
+
+class RGB {
+public:
+	static RGB WHITE;
+	static RGB BLACK;
+	static RGB RED;
+	static RGB GREEN;
+	static RGB BLUE;
+	public:
+	RGB();
+	RGB(uint8_t r, uint8_t g, uint8_t b);
+	~RGB();
+	const uint8_t *getArray() const;
+	uint8_t getR() const {
+		return Clr[0];
+	}
+	uint8_t getG() const {
+		return Clr[1];
+	}
+	uint8_t getB() const {
+		return Clr[2];
+	}
+public:
+	static RGB createRandomColor();
+	private:
+	uint8_t Clr[3];
+};
+
+/*
+ * Linear buffer of 3 byte (R,G,B) pixels.
+ *
+ * getColor is what the WS2818 ISR uses to fetch a pixel while refilling a DMA half, sub classes
+ * that store pixels in a packed form override it and expand into the scratch space passed in.
+ * getLeds/getLed hand out the raw storage and are only meaningful for the plain RGB layout, check
+ * getBitsPerLed before writing through them. setLed/fill are virtual so effects can draw into any layout.
+ *
+ * The buffer keeps a running sum of all channel values (used for power estimation) that the
+ * setLed/fill write APIs keep up to date as pixels are written.
+ * If a dirty map is attached (one bit per led) the write APIs also flag the leds they change, the WS2818
+ * encode cache uses that to skip re-encoding leds that did not change since the last frame.
+ * Code that writes through the raw pointers must call invalidate (or markDirty per led),
+ * the next getChannelSum will then do a full pass and every led is re-encoded.
+ */
+class LedBuffer {
+public:
+	LedBuffer(uint8_t *ledColorBuffer, uint32_t NUM_LEDS) :
+			LedData(ledColorBuffer), NumLeds(NUM_LEDS), ChannelSum(0), ChannelSumValid(false), DirtyBits(0) {
+	}
+	virtual ~LedBuffer() {
+	}
+	uint8_t *getLeds() {return LedData;}
+	uint8_t *getLed(uint16_t led) {return &LedData[led*3];}
+	uint16_t getNumLeds() {return NumLeds;}
+	//24 for the plain R,G,B layout, packed sub classes return less
+	virtual uint8_t getBitsPerLed() const {return 24;}
+	virtual void setLed(uint16_t led, uint8_t r, uint8_t g, uint8_t b) {
+		uint8_t *p = &LedData[led*3];
+		if(p[0]==r && p[1]==g && p[2]==b) {
+			return;
+		}
+		markDirty(led);
+		if(ChannelSumValid) {
+			ChannelSum += (r+g+b);
+			ChannelSum -= (p[0]+p[1]+p[2]);
+		}
+		p[0] = r;
+		p[1] = g;
+		p[2] = b;
+	}
+	void setLed(uint16_t led, const RGB &color) {
+		setLed(led,color.getR(),color.getG(),color.getB());
+	}
+	virtual void fill(const RGB &color);
+	uint32_t getChannelSum() {
+		if(!ChannelSumValid) {
+			recalculateChannelSum();
+		}
+		return ChannelSum;
+	}
+	void invalidate() {
+		ChannelSumValid = false;
+		markAllDirty();
+	}
+	static uint32_t dirtyMapSize(uint16_t numLeds) {
+		return (numLeds+31)/32;
+	}
+	//bits must hold dirtyMapSize words, pass 0 to stop tracking (every led is then always dirty)
+	void setDirtyMap(uint32_t *bits) {
+		DirtyBits = bits;
+		markAllDirty();
+	}
+	bool isDirty(uint16_t led) const {
+		return DirtyBits==0 || (DirtyBits[led>>5] & (1u<<(led&31)));
+	}
+	void markDirty(uint16_t led) {
+		if(DirtyBits) {
+			DirtyBits[led>>5] |= (1u<<(led&31));
+		}
+	}
+	void clearDirty(uint16_t led) {
+		if(DirtyBits) {
+			DirtyBits[led>>5] &= ~(1u<<(led&31));
+		}
+	}
+	void markAllDirty();
+	//returns a pointer to the R,G,B bytes of the led, scratch must be able to hold 3 bytes
+	virtual const uint8_t *getColor(uint16_t led, uint8_t *scratch) {
+		(void)scratch;
+		return &LedData[led*3];
+	}
+protected:
+	void recalculateChannelSum();
+protected:
+	uint8_t *LedData;
+	uint16_t NumLeds;
+	uint32_t ChannelSum;
+	bool ChannelSumValid;
+	uint32_t *DirtyBits;
+};
+
+/*
+ * Pixels are stored as 4 or 8 bit indexes into a palette of 16 or 256 RGB entries.
+ * With 4 bit indexes 2 leds share a byte, the even led is in the low nibble.
+ *
+ * Use bufferSize to figure out how big the index buffer needs to be.
+ * Rotating the palette only moves an offset that is applied when the ISR expands the pixel,
+ * so palette cycling effects cost nothing per pixel.
+ * setLed and fill with a color store the nearest palette entry, setIndex is the fast way in.
+ */
+class PaletteLedBuffer : public LedBuffer {
+public:
+	static uint32_t bufferSize(uint16_t numLeds, uint8_t bitsPerIndex) {
+		return bitsPerIndex==4 ? (numLeds+1)/2 : numLeds;
+	}
+public:
+	PaletteLedBuffer(uint8_t *indexBuffer, uint16_t numLeds, RGB *palette, uint8_t bitsPerIndex);
+	virtual ~PaletteLedBuffer() {
+	}
+	void setIndex(uint16_t led, uint8_t index) {
+		if(getIndex(led)==(index&Mask)) {
+			return;
+		}
+		markDirty(led);
+		if(ChannelSumValid) {
+			ChannelSum += paletteSum(index);
+			ChannelSum -= paletteSum(getIndex(led));
+		}
+		if(Mask==0xF) {
+			uint8_t &b = LedData[led>>1];
+			b = (led&1) ? ((b&0x0F)|(index<<4)) : ((b&0xF0)|(index&0x0F));
+		} else {
+			LedData[led] = index;
+		}
+	}
+	uint8_t getIndex(uint16_t led) const {
+		if(Mask==0xF) {
+			return (led&1) ? (LedData[led>>1]>>4) : (LedData[led>>1]&0x0F);
+		}
+		return LedData[led];
+	}
+	virtual uint8_t getBitsPerLed() const {return getBitsPerIndex();}
+	virtual void setLed(uint16_t led, uint8_t r, uint8_t g, uint8_t b) {
+		setIndex(led,nearestIndex(r,g,b));
+	}
+	void setLed(uint16_t led, const RGB &color) {
+		setLed(led,color.getR(),color.getG(),color.getB());
+	}
+	void fill(uint8_t index);
+	virtual void fill(const RGB &color) {
+		fill(nearestIndex(color.getR(),color.getG(),color.getB()));
+	}
+	//index (before the palette offset) of the entry closest to r,g,b
+	uint8_t nearestIndex(uint8_t r, uint8_t g, uint8_t b) const;
+	RGB *getPalette() {return Palette;}
+	void setPaletteEntry(uint8_t index, const RGB &color);
+	uint16_t getPaletteSize() const {return Mask+1;}
+	uint8_t getBitsPerIndex() const {return Mask==0xF ? 4 : 8;}
+	void rotatePalette(int8_t amount) {Offset += amount; invalidate();}
+	void setPaletteOffset(uint8_t offset) {Offset = offset; invalidate();}
+	uint8_t getPaletteOffset() const {return Offset;}
+	virtual const uint8_t *getColor(uint16_t led, uint8_t *scratch) {
+		(void)scratch;
+		return Palette[(getIndex(led)+Offset)&Mask].getArray();
+	}
+private:
+	uint16_t paletteSum(uint8_t index) const {
+		const RGB &c = Palette[(index+Offset)&Mask];
+		return c.getR()+c.getG()+c.getB();
+	}
+private:
+	RGB *Palette;
+	uint8_t Mask;
+	uint8_t Offset;
+};
+
+/*
+ * Pixels are packed as 16 bit RGB565, 2 bytes per led instead of 3.
+ * The ISR expands each pixel back to 24 bits while filling the DMA half, the low bits are
+ * filled by replicating the high bits so full scale 5/6 bit values still map to 255.
+ */
+class RGB565LedBuffer : public LedBuffer {
+public:
+	static uint32_t bufferSize(uint16_t numLeds) {
+		return numLeds*2;
+	}
+	static uint16_t pack(uint8_t r, uint8_t g, uint8_t b) {
+		return ((r&0xF8)<<8) | ((g&0xFC)<<3) | (b>>3);
+	}
+public:
+	//buffer must be 2 byte aligned
+	RGB565LedBuffer(uint8_t *pixelBuffer, uint16_t numLeds) :
+			LedBuffer(pixelBuffer, numLeds) {
+	}
+	virtual ~RGB565LedBuffer() {
+	}
+	uint16_t *getPixels() {return reinterpret_cast<uint16_t*>(LedData);}
+	virtual uint8_t getBitsPerLed() const {return 16;}
+	virtual void setLed(uint16_t led, uint8_t r, uint8_t g, uint8_t b) {
+		uint16_t p = pack(r,g,b);
+		if(getPixels()[led]==p) {
+			return;
+		}
+		markDirty(led);
+		if(ChannelSumValid) {
+			ChannelSum += pixelSum(p);
+			ChannelSum -= pixelSum(getPixels()[led]);
+		}
+		getPixels()[led] = p;
+	}
+	void setLed(uint16_t led, const RGB &color) {
+		setLed(led,color.getR(),color.getG(),color.getB());
+	}
+	virtual void fill(const RGB &color);
+	virtual const uint8_t *getColor(uint16_t led, uint8_t *scratch) {
+		uint16_t p = getPixels()[led];
+		uint8_t r = p>>11;
+		uint8_t g = (p>>5)&0x3F;
+		uint8_t b = p&0x1F;
+		scratch[0] = (r<<3) | (r>>2);
+		scratch[1] = (g<<2) | (g>>4);
+		scratch[2] = (b<<3) | (b>>2);
+		return scratch;
+	}
+private:
+	//close enough for power estimation, skips the low bit replication
+	static uint16_t pixelSum(uint16_t p) {
+		return ((p>>8)&0xF8) + ((p>>3)&0xFC) + ((p<<3)&0xF8);
+	}
+};
+
+/*
+ * Hands frames from a receiver (usually an ISR writing into the back buffer with DMA) to the main loop
+ * that sends the front buffer, without either side waiting on or copying for the other.
+ *
+ * With only 2 buffers a finished back buffer can not be swapped while the strand is still clocking out
+ * the front one, so there is a third spare: publish exchanges back and spare, acquire exchanges front and
+ * spare if a new frame was published since. The spare slot index (plus the new frame flag) lives in one
+ * byte that both sides only touch with an atomic exchange, which is a LDREXB/STREXB loop on the M3.
+ * Only call acquire when nothing is reading the front buffer any more (WS2818::isBusy is false).
+ * All 3 buffers must have the same number of leds.
+ */
+class TripleBuffer {
+public:
+	TripleBuffer(LedBuffer *a, LedBuffer *b, LedBuffer *c) :
+			Buffers(), Front(0), Back(1), Spare(2), Latest(NONE), Published(0), Dropped(0) {
+		Buffers[0] = a;
+		Buffers[1] = b;
+		Buffers[2] = c;
+	}
+	~TripleBuffer() {
+	}
+	//writer side
+	LedBuffer *getBack() {return Buffers[Back];}
+	//the back buffer holds a complete frame, it becomes the newest frame and writing moves on to the spare
+	void publish() {
+		// raw writes (DMA) bypassed the dirty map and power sum
+		Buffers[Back]->invalidate();
+		uint8_t old = __atomic_exchange_n(&Spare, Back | NEW_FRAME, __ATOMIC_ACQ_REL);
+		if(old & NEW_FRAME) {
+			// the main loop never picked up the previous one
+			Dropped++;
+		}
+		Latest = Back;
+		Back = old & INDEX_MASK;
+		Published++;
+	}
+	//writer side, the last frame published (0 before the first), the reader only sends it so it is safe to read
+	//from while building the next one on top of it
+	LedBuffer *getLatest() {return Latest==NONE ? 0 : Buffers[Latest];}
+	//reader side, returns true if getFront now holds a frame that was not acquired before
+	bool acquire() {
+		if(!(__atomic_load_n(&Spare, __ATOMIC_ACQUIRE) & NEW_FRAME)) {
+			return false;
+		}
+		Front = __atomic_exchange_n(&Spare, Front, __ATOMIC_ACQ_REL) & INDEX_MASK;
+		return true;
+	}
+	LedBuffer *getFront() {return Buffers[Front];}
+	uint32_t getPublished() const {return Published;}
+	//frames overwritten by a newer one before acquire got to them
+	uint32_t getDropped() const {return Dropped;}
+private:
+	static const uint8_t NEW_FRAME = 0x80;
+	static const uint8_t INDEX_MASK = 0x03;
+	static const uint8_t NONE = 0xFF;
+	LedBuffer *Buffers[3];
+	uint8_t Front;
+	uint8_t Back;
+	uint8_t Spare;
+	uint8_t Latest;
+	volatile uint32_t Published;
+	volatile uint32_t Dropped;
+};
+
+/*
+ * Fixed capacity LIFO, D is at most 255.
+ */
+template<typename T, uint8_t D>
+class Stack {
+public:
+	Stack() : StackMem(), InsertionPos(0) {}
+	~Stack() {}
+	bool push(const T &v) {
+		if(InsertionPos==(D)) {
+			return false;
+		}
+		StackMem[InsertionPos]=v;
+		InsertionPos++;
+		return true;
+	}
+	//returns false if the stack is empty, v is left untouched then
+	bool pop(T &v) {
+		if(InsertionPos==0) {
+			return false;
+		}
+		v = StackMem[--InsertionPos];
+		return true;
+	}
+	uint8_t size() const {return InsertionPos;}
+	bool isEmpty() const {return InsertionPos==0;}
+	void clear() {InsertionPos = 0;}
+protected:
+	T StackMem[D];
+	uint8_t InsertionPos;
+};
+
+} //cmdc0de
+
+#endif
@@ -0,0 +1,179 @@
+#include "ledmatrix.h"
+
+using cmdc0de::LedMatrix;
+using cmdc0de::LedBuffer;
+using cmdc0de::RGB;
+
+LedMatrix::LedMatrix(uint16_t width, uint16_t height, LAYOUT layout, const uint16_t *customLUT) :
+		Width(width), Height(height), Layout(layout), LUT(customLUT), Strands(), StrandStart(), StrandCount(0),
+				TotalLeds(0) {
+	if (Layout == CUSTOM && LUT == 0)
+		Layout = PROGRESSIVE;
+}
+
+LedMatrix::~LedMatrix() {
+
+}
+
+bool LedMatrix::addStrand(LedBuffer *leds) {
+	if (StrandCount == MAX_STRANDS) {
+		return false;
+	}
+	Strands[StrandCount] = leds;
+	StrandStart[StrandCount] = TotalLeds;
+	TotalLeds += leds->getNumLeds();
+	StrandCount++;
+	return true;
+}
+
+LedBuffer *LedMatrix::locate(uint16_t idx, uint16_t &local) const {
+	if (idx >= TotalLeds)
+		return 0;
+	uint8_t s = StrandCount - 1;
+	while (StrandStart[s] > idx)
+		s--;
+	local = idx - StrandStart[s];
+	return Strands[s];
+}
+
+void LedMatrix::setPixel(int16_t x, int16_t y, const uint8_t *rgb) {
+	if (x < 0 || y < 0 || x >= Width || y >= Height)
+		return;
+	uint16_t local;
+	LedBuffer *strand = locate(toIndex(x, y), local);
+	if (strand)
+		strand->setLed(local, rgb[0], rgb[1], rgb[2]);
+}
+
+void LedMatrix::setPixel(int16_t x, int16_t y, const RGB &color) {
+	setPixel(x, y, color.getArray());
+}
+
+const uint8_t *LedMatrix::getPixel(int16_t x, int16_t y, uint8_t *scratch) {
+	if (x < 0 || y < 0 || x >= Width || y >= Height)
+		return 0;
+	uint16_t local;
+	LedBuffer *strand = locate(toIndex(x, y), local);
+	return strand ? strand->getColor(local, scratch) : 0;
+}
+
+void LedMatrix::writeRow(uint16_t y, uint16_t x, uint16_t count, const uint8_t *src, uint8_t srcStep) {
+	if (Layout == CUSTOM) {
+		for (uint16_t i = 0; i < count; i++, src += srcStep) {
+			uint16_t local;
+			LedBuffer *strand = locate(LUT[y * Width + x + i], local);
+			if (strand)
+				strand->setLed(local, src[0], src[1], src[2]);
+		}
+		return;
+	}
+	// rows are contiguous in matrix index, only direction changes for odd serpentine rows
+	int8_t dir = (Layout == SERPENTINE && (y & 1)) ? -1 : 1;
+	uint16_t idx = toIndex(x, y);
+	while (count > 0) {
+		uint16_t local;
+		LedBuffer *strand = locate(idx, local);
+		if (strand == 0)
+			return;
+		// how many pixels fit before running off this strand
+		uint16_t run = dir > 0 ? strand->getNumLeds() - local : local + 1;
+		if (run > count)
+			run = count;
+		for (uint16_t i = 0; i < run; i++, local += dir, src += srcStep) {
+			strand->setLed(local, src[0], src[1], src[2]);
+		}
+		count -= run;
+		idx += dir * run;
+	}
+}
+
+void LedMatrix::writeColumn(uint16_t x, uint16_t y, uint16_t count, const uint8_t *rgb) {
+	uint16_t idx = toIndex(x, y);
+	for (uint16_t row = y; row < y + count; row++) {
+		if (Layout == CUSTOM) {
+			idx = LUT[row * Width + x];
+		}
+		uint16_t local;
+		LedBuffer *strand = locate(idx, local);
+		if (strand)
+			strand->setLed(local, rgb[0], rgb[1], rgb[2]);
+		if (Layout == SERPENTINE) {
+			// distance to the end of this row plus distance back to x on the next one
+			idx += (row & 1) ? (2 * x + 1) : (2 * (Width - 1 - x) + 1);
+		} else {
+			idx += Width;
+		}
+	}
+}
+
+void LedMatrix::fill(const RGB &color) {
+	fillRect(0, 0, Width, Height, color);
+}
+
+void LedMatrix::fillRow(int16_t y, int16_t x0, int16_t x1, const RGB &color) {
+	if (x0 > x1) {
+		int16_t t = x0;
+		x0 = x1;
+		x1 = t;
+	}
+	fillRect(x0, y, x1 - x0 + 1, 1, color);
+}
+
+void LedMatrix::fillColumn(int16_t x, int16_t y0, int16_t y1, const RGB &color) {
+	if (y0 > y1) {
+		int16_t t = y0;
+		y0 = y1;
+		y1 = t;
+	}
+	if (x < 0 || x >= Width)
+		return;
+	if (y0 < 0)
+		y0 = 0;
+	if (y1 >= Height)
+		y1 = Height - 1;
+	if (y0 <= y1)
+		writeColumn(x, y0, y1 - y0 + 1, color.getArray());
+}
+
+void LedMatrix::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, const RGB &color) {
+	if (x < 0) {
+		w += x;
+		x = 0;
+	}
+	if (y < 0) {
+		h += y;
+		y = 0;
+	}
+	if (x + w > Width)
+		w = Width - x;
+	if (y + h > Height)
+		h = Height - y;
+	if (w <= 0 || h <= 0)
+		return;
+	for (int16_t row = y; row < y + h; row++) {
+		writeRow(row, x, w, color.getArray(), 0);
+	}
+}
+
+void LedMatrix::blit(int16_t x, int16_t y, int16_t w, int16_t h, const uint8_t *rgb, uint16_t stride) {
+	// clip, moving the source start along with the destination
+	if (x < 0) {
+		rgb += -x * 3;
+		w += x;
+		x = 0;
+	}
+	if (y < 0) {
+		rgb += -y * stride;
+		h += y;
+		y = 0;
+	}
+	if (x + w > Width)
+		w = Width - x;
+	if (y + h > Height)
+		h = Height - y;
+	if (w <= 0 || h <= 0)
+		return;
+	for (int16_t row = y; row < y + h; row++, rgb += stride) {
+		writeRow(row, x, w, rgb, 3);
+	}
+}
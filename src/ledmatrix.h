@@ -0,0 +1,80 @@
+#ifndef __LEDMATRIX_H__
+#define __LEDMATRIX_H__
+
+#include "ledbuffer.h"
+
+namespace cmdc0de {
+
+/*
+ * 2D view over one or more LedBuffers.
+ *
+ * (x, y) with 0,0 top left is mapped to a matrix index by the layout, then to a strand:
+ * 	PROGRESSIVE: every row runs left to right
+ * 	SERPENTINE:  even rows run left to right, odd rows right to left (zig zag wiring)
+ * 	CUSTOM:      width * height uint16 table (keep it const so it stays in flash) holding the index of every (x, y)
+ * Strands are added in wiring order and each takes as many consecutive indexes as its buffer has leds,
+ * so a panel can be split across several WS2818 outputs.
+ *
+ * Row spans, rectangles and blits walk strand memory directly for the progressive and serpentine
+ * layouts, the mapping is only worked out once per row (or strand boundary), not per pixel.
+ * Columns step the index by the row length (with the zig zag correction for serpentine).
+ * Writes go through LedBuffer::setLed so power and dirty tracking keep working, strands must be plain RGB buffers.
+ */
+class LedMatrix {
+public:
+	enum LAYOUT {
+		PROGRESSIVE = 0,
+		SERPENTINE,
+		CUSTOM
+	};
+	static const uint8_t MAX_STRANDS = 4;
+public:
+	LedMatrix(uint16_t width, uint16_t height, LAYOUT layout, const uint16_t *customLUT);
+	~LedMatrix();
+	bool addStrand(LedBuffer *leds);
+	uint16_t getWidth() const {return Width;}
+	uint16_t getHeight() const {return Height;}
+	//matrix index of (x, y), no bounds checks
+	uint16_t toIndex(uint16_t x, uint16_t y) const {
+		switch(Layout) {
+		case SERPENTINE:
+			return y*Width + ((y&1) ? (Width-1-x) : x);
+		case CUSTOM:
+			return LUT[y*Width + x];
+		case PROGRESSIVE:
+		default:
+			return y*Width + x;
+		}
+	}
+	void setPixel(int16_t x, int16_t y, const RGB &color);
+	void setPixel(int16_t x, int16_t y, const uint8_t *rgb);
+	//R,G,B of the pixel or 0 if it is outside the matrix or not backed by a strand, scratch holds 3 bytes
+	const uint8_t *getPixel(int16_t x, int16_t y, uint8_t *scratch);
+	void fill(const RGB &color);
+	//x0..x1 inclusive
+	void fillRow(int16_t y, int16_t x0, int16_t x1, const RGB &color);
+	//y0..y1 inclusive
+	void fillColumn(int16_t x, int16_t y0, int16_t y1, const RGB &color);
+	void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, const RGB &color);
+	//copies a w*h block of R,G,B pixels, stride is the number of bytes between source rows
+	void blit(int16_t x, int16_t y, int16_t w, int16_t h, const uint8_t *rgb, uint16_t stride);
+protected:
+	//finds the strand holding matrix index idx, returns 0 if there is none
+	LedBuffer *locate(uint16_t idx, uint16_t &local) const;
+	//writes count pixels of row y starting at x, src advances by srcStep bytes per pixel (0 = same color)
+	void writeRow(uint16_t y, uint16_t x, uint16_t count, const uint8_t *src, uint8_t srcStep);
+	void writeColumn(uint16_t x, uint16_t y, uint16_t count, const uint8_t *rgb);
+private:
+	uint16_t Width;
+	uint16_t Height;
+	LAYOUT Layout;
+	const uint16_t *LUT;
+	LedBuffer *Strands[MAX_STRANDS];
+	uint16_t StrandStart[MAX_STRANDS];
+	uint8_t StrandCount;
+	uint16_t TotalLeds;
+};
+
+} //cmdc0de
+
+#endif
@@ -0,0 +1,174 @@
+#include "lightnet.h"
+#include <string.h>
+
+using cmdc0de::LightingPacketParser;
+using cmdc0de::UniverseMapper;
+using cmdc0de::LedBuffer;
+
+namespace {
+
+const uint8_t AcnIdentifier[12] = { 'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0 };
+const uint8_t ArtNetIdentifier[8] = { 'A', 'r', 't', '-', 'N', 'e', 't', 0 };
+
+// E1.31 root layer
+const uint16_t E131_IDENTIFIER = 4;
+const uint16_t E131_ROOT_VECTOR = 18;
+const uint32_t VECTOR_ROOT_DATA = 0x00000004;
+const uint32_t VECTOR_ROOT_EXTENDED = 0x00000008;
+// framing layer
+const uint16_t E131_FRAMING_VECTOR = 40;
+const uint32_t VECTOR_FRAMING_DATA = 0x00000002;
+const uint32_t VECTOR_FRAMING_SYNC = 0x00000001;
+const uint16_t E131_SYNC_ADDRESS = 109;
+const uint16_t E131_SEQUENCE = 111;
+const uint16_t E131_OPTIONS = 112;
+const uint8_t OPTION_PREVIEW = 0x80;
+const uint8_t OPTION_TERMINATED = 0x40;
+const uint16_t E131_UNIVERSE = 113;
+// DMP layer
+const uint16_t E131_DMP_VECTOR = 117;
+const uint16_t E131_PROPERTY_COUNT = 123;
+const uint16_t E131_START_CODE = 125;
+const uint16_t E131_DATA_HEADER = 126;
+const uint16_t E131_SYNC_SIZE = 49;
+
+// Art-Net, op codes are little endian, everything else big endian
+const uint16_t ARTNET_OPCODE = 8;
+const uint16_t OP_DMX = 0x5000;
+const uint16_t OP_SYNC = 0x5200;
+const uint16_t ARTNET_SEQUENCE = 12;
+const uint16_t ARTNET_SUBUNI = 14;
+const uint16_t ARTNET_NET = 15;
+const uint16_t ARTNET_LENGTH = 16;
+const uint16_t ARTNET_DATA_HEADER = 18;
+const uint16_t ARTNET_SYNC_SIZE = 14;
+
+inline uint16_t get16(const uint8_t *p) {
+	return (p[0] << 8) | p[1];
+}
+
+inline uint32_t get32(const uint8_t *p) {
+	return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+}
+
+LightingPacketParser::LightingPacketParser(UniverseMapper *mapper) :
+		Mapper(mapper), Sequence(), SequenceValid(0), Synced(false), LastSync(0), Pending(false), Packets(0),
+				OutOfOrder(0), Frames(0) {
+
+}
+
+LightingPacketParser::~LightingPacketParser() {
+
+}
+
+LightingPacketParser::RESULT LightingPacketParser::parse(const uint8_t *packet, uint16_t len, LedBuffer *leds,
+		uint32_t now) {
+	if (Synced && now - LastSync >= SYNC_TIMEOUT_MS) {
+		// the sender stopped syncing, fall back to completing frames by universe
+		Synced = false;
+	}
+	if (len >= E131_SYNC_SIZE && memcmp(&packet[E131_IDENTIFIER], AcnIdentifier, sizeof(AcnIdentifier)) == 0)
+		return parseE131(packet, len, leds, now);
+	if (len >= ARTNET_SYNC_SIZE && memcmp(packet, ArtNetIdentifier, sizeof(ArtNetIdentifier)) == 0)
+		return parseArtNet(packet, len, leds, now);
+	return IGNORED;
+}
+
+LightingPacketParser::RESULT LightingPacketParser::parseE131(const uint8_t *packet, uint16_t len, LedBuffer *leds,
+		uint32_t now) {
+	uint32_t root = get32(&packet[E131_ROOT_VECTOR]);
+	uint32_t framing = get32(&packet[E131_FRAMING_VECTOR]);
+	if (root == VECTOR_ROOT_EXTENDED && framing == VECTOR_FRAMING_SYNC) {
+		Packets++;
+		return sync(now);
+	}
+	if (root != VECTOR_ROOT_DATA || framing != VECTOR_FRAMING_DATA || len < E131_DATA_HEADER
+			|| packet[E131_DMP_VECTOR] != 0x02)
+		return IGNORED;
+	Packets++;
+	if ((packet[E131_OPTIONS] & (OPTION_PREVIEW | OPTION_TERMINATED)) || packet[E131_START_CODE] != 0)
+		return IGNORED;
+	// the property count includes the start code
+	uint16_t count = get16(&packet[E131_PROPERTY_COUNT]) - 1;
+	if (count > len - E131_DATA_HEADER)
+		count = len - E131_DATA_HEADER;
+	return universeData(get16(&packet[E131_UNIVERSE]), packet[E131_SEQUENCE], true, &packet[E131_DATA_HEADER],
+			count, leds, get16(&packet[E131_SYNC_ADDRESS]) != 0, now);
+}
+
+LightingPacketParser::RESULT LightingPacketParser::parseArtNet(const uint8_t *packet, uint16_t len, LedBuffer *leds,
+		uint32_t now) {
+	uint16_t op = packet[ARTNET_OPCODE] | (packet[ARTNET_OPCODE + 1] << 8);
+	if (op == OP_SYNC) {
+		Packets++;
+		return sync(now);
+	}
+	if (op != OP_DMX || len < ARTNET_DATA_HEADER)
+		return IGNORED;
+	Packets++;
+	uint16_t count = get16(&packet[ARTNET_LENGTH]);
+	if (count > len - ARTNET_DATA_HEADER)
+		count = len - ARTNET_DATA_HEADER;
+	uint16_t universe = ((packet[ARTNET_NET] & 0x7F) << 8) | packet[ARTNET_SUBUNI];
+	uint8_t sequence = packet[ARTNET_SEQUENCE];
+	return universeData(universe, sequence, sequence != 0, &packet[ARTNET_DATA_HEADER], count, leds, false, now);
+}
+
+bool LightingPacketParser::inOrder(int8_t index, uint8_t sequence) const {
+	if (SequenceValid & (1u << index)) {
+		int8_t diff = (int8_t) (sequence - Sequence[index]);
+		if (diff <= 0 && diff > -20) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void LightingPacketParser::setSequence(int8_t index, uint8_t sequence) {
+	SequenceValid |= 1u << index;
+	Sequence[index] = sequence;
+}
+
+LightingPacketParser::RESULT LightingPacketParser::universeData(uint16_t universe, uint8_t sequence, bool numbered,
+		const uint8_t *slots, uint16_t count, LedBuffer *leds, bool waitSync, uint32_t now) {
+	int8_t index = Mapper->indexOf(universe);
+	if (index < 0)
+		return IGNORED;
+	if (numbered && !inOrder(index, sequence)) {
+		OutOfOrder++;
+		return OUT_OF_ORDER;
+	}
+	if (waitSync && !Synced) {
+		Synced = true;
+		LastSync = now;
+	}
+	if (!Synced && Mapper->hasArrived(universe)) {
+		// came round again before the rest of the frame, send what there is and take this packet again
+		// (its sequence number is not recorded yet and it is counted when it comes back)
+		Packets--;
+		frame();
+		return FRAME_BEFORE;
+	}
+	if (numbered)
+		setSequence(index, sequence);
+	Mapper->write(universe, slots, count, leds);
+	Pending = true;
+	if (!Synced && Mapper->arrived(universe))
+		return frame();
+	return UNIVERSE;
+}
+
+LightingPacketParser::RESULT LightingPacketParser::sync(uint32_t now) {
+	Synced = true;
+	LastSync = now;
+	return Pending ? frame() : IGNORED;
+}
+
+LightingPacketParser::RESULT LightingPacketParser::frame() {
+	Mapper->clearArrived();
+	Pending = false;
+	Frames++;
+	return FRAME;
+}
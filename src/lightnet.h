@@ -0,0 +1,78 @@
+#ifndef __LIGHTNET_H__
+#define __LIGHTNET_H__
+
+#include "universe.h"
+
+namespace cmdc0de {
+
+/*
+ * Parser for the two ways lighting software sends DMX universes over UDP:
+ * 	E1.31 (sACN):  port 5568, universes 1-63999, multicast 239.255.hi.lo or unicast
+ * 	Art-Net:       port 6454, 15 bit port address Net:SubNet:Universe used as the universe number
+ * Both are handed whole datagrams. Nothing is copied, the DMX slots are read where they sit in the receive
+ * buffer and go through the UniverseMapper straight into the leds.
+ *
+ * Sequence numbers are tracked per mapped universe with the E1.31 rule (a packet 1 to 19 behind the last one
+ * is late and dropped, anything further off is taken as the source restarting), Art-Net sequence 0 means the
+ * sender does not number its packets. E1.31 preview and stream terminated packets are ignored.
+ *
+ * Frames: without sync a frame is complete when every mapped universe arrived. If one repeats before the
+ * rest the frame is complete without it: parse returns FRAME_BEFORE and leaves the leds alone, the caller
+ * publishes and hands the same packet to parse again for the next frame. Once a sender uses sync (an E1.31
+ * data packet with a synchronization address, or an ArtSync) data is only written and the frame is complete
+ * when the sync packet arrives, until no sync was seen for SYNC_TIMEOUT_MS. parse returns FRAME when the
+ * caller should publish the leds.
+ */
+class LightingPacketParser {
+public:
+	static const uint16_t E131_PORT = 5568;
+	static const uint16_t ARTNET_PORT = 6454;
+	static const uint16_t SYNC_TIMEOUT_MS = 4000;
+	enum RESULT {
+		//not E1.31 / Art-Net, or nothing in it for us
+		IGNORED,
+		//late sequence number
+		OUT_OF_ORDER,
+		//written to the leds, frame not complete yet
+		UNIVERSE,
+		//frame complete, publish the leds
+		FRAME,
+		//frame complete without this packet, publish the leds then parse the packet again
+		FRAME_BEFORE
+	};
+public:
+	LightingPacketParser(UniverseMapper *mapper);
+	~LightingPacketParser();
+	//now in ms, only used for the sync timeout
+	RESULT parse(const uint8_t *packet, uint16_t len, LedBuffer *leds, uint32_t now);
+	uint32_t getPackets() const {return Packets;}
+	uint32_t getOutOfOrder() const {return OutOfOrder;}
+	uint32_t getFrames() const {return Frames;}
+	bool isSynced() const {return Synced;}
+protected:
+	RESULT parseE131(const uint8_t *packet, uint16_t len, LedBuffer *leds, uint32_t now);
+	RESULT parseArtNet(const uint8_t *packet, uint16_t len, LedBuffer *leds, uint32_t now);
+	bool inOrder(int8_t index, uint8_t sequence) const;
+	void setSequence(int8_t index, uint8_t sequence);
+	//numbered false skips the sequence check (Art-Net sequence 0)
+	RESULT universeData(uint16_t universe, uint8_t sequence, bool numbered, const uint8_t *slots, uint16_t count,
+			LedBuffer *leds, bool waitSync, uint32_t now);
+	RESULT sync(uint32_t now);
+	RESULT frame();
+private:
+	UniverseMapper *Mapper;
+	uint8_t Sequence[UniverseMapper::MAX_MAPPINGS];
+	//bit per mapping index, set once a sequence number was seen
+	uint32_t SequenceValid;
+	bool Synced;
+	uint32_t LastSync;
+	//universes written since the last frame, the sync only publishes if there is something new
+	bool Pending;
+	uint32_t Packets;
+	uint32_t OutOfOrder;
+	uint32_t Frames;
+};
+
+} //cmdc0de
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef __LUT_H__
+#define __LUT_H__
+
+#include <stdint.h>
+
+namespace cmdc0de {
+
+/*
+ * Lookup tables generated by the compiler (constexpr) and placed in flash as const data,
+ * no floating point survives to run time.
+ *
+ * 	sin8/cos8:	one full period over 0-255, result 1-255 centered on 128
+ * 	heatColor:	black -> red -> yellow -> white black body style ramp used by fire
+ */
+namespace lut {
+
+template<uint16_t... I>
+struct Seq {
+};
+
+template<uint16_t N, uint16_t... I>
+struct MakeSeq : MakeSeq<N - 1, N - 1, I...> {
+};
+
+template<uint16_t... I>
+struct MakeSeq<0, I...> {
+	typedef Seq<I...> type;
+};
+
+constexpr double PI = 3.14159265358979323846;
+
+// Taylor series, x must already be in [-PI, PI]
+constexpr double sinTerm(double x2, double term, int n) {
+	return n > 25 ? term : term + sinTerm(x2, -term * x2 / ((n + 1) * (n + 2)), n + 2);
+}
+
+constexpr double sinReduced(double x) {
+	return sinTerm(x * x, x, 1);
+}
+
+constexpr uint8_t sineEntry(uint16_t i) {
+	return static_cast<uint8_t>(128.5 + 127.0 * sinReduced(i < 128 ? (PI * i) / 128.0 : (PI * i) / 128.0 - 2.0 * PI));
+}
+
+constexpr uint8_t heatRamp(uint8_t t) {
+	return (t & 0x3F) << 2;
+}
+
+// heat scaled to 0-191 is 3 ramps of 64 steps: red comes up, then green, then blue
+constexpr uint8_t heatChannel(uint8_t t, uint8_t channel) {
+	return (t & 0x80) ? (channel == 2 ? heatRamp(t) : 255) :
+			(t & 0x40) ? (channel == 0 ? 255 : (channel == 1 ? heatRamp(t) : 0)) :
+					(channel == 0 ? heatRamp(t) : 0);
+}
+
+constexpr uint8_t heatEntry(uint16_t i) {
+	return heatChannel(((i / 3) * 191) / 255, i % 3);
+}
+
+template<typename S>
+struct SineTable;
+
+template<uint16_t... I>
+struct SineTable<Seq<I...> > {
+	static constexpr uint8_t Values[sizeof...(I)] = { sineEntry(I)... };
+};
+
+template<uint16_t... I>
+constexpr uint8_t SineTable<Seq<I...> >::Values[sizeof...(I)];
+
+template<typename S>
+struct HeatTable;
+
+template<uint16_t... I>
+struct HeatTable<Seq<I...> > {
+	static constexpr uint8_t Values[sizeof...(I)] = { heatEntry(I)... };
+};
+
+template<uint16_t... I>
+constexpr uint8_t HeatTable<Seq<I...> >::Values[sizeof...(I)];
+
+typedef SineTable<MakeSeq<256>::type> Sine;
+typedef HeatTable<MakeSeq<256 * 3>::type> Heat;
+
+} //lut
+
+inline uint8_t sin8(uint8_t theta) {
+	return lut::Sine::Values[theta];
+}
+
+inline uint8_t cos8(uint8_t theta) {
+	return lut::Sine::Values[(uint8_t) (theta + 64)];
+}
+
+//pointer to the R,G,B bytes for the heat value
+inline const uint8_t *heatColor(uint8_t heat) {
+	return &lut::Heat::Values[heat * 3];
+}
+
+//a * b / 256 with 255 treated as 1.0
+inline uint8_t scale8(uint8_t a, uint8_t b) {
+	return (a * (b + 1)) >> 8;
+}
+
+} //cmdc0de
+
+#endif
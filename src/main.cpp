@@ -13,6 +13,34 @@
 #include "BlinkLed.h"
 #define LED_PER_DMA_BUFFER 32
 #include "ws2812.h"
+#include "power.h"
+#include "benchmark.h"
+#include "cyclecounter.h"
+#include "effects.h"
+#include "compositor.h"
+#ifdef WS2812_ADALIGHT
+#include "adalight.h"
+#endif
+#ifdef WS2812_SPI_SLAVE
+#include "spislave.h"
+#endif
+#ifdef WS2812_PROTOCOL
+#include "hwcrc.h"
+#include "commands.h"
+#endif
+#ifdef WS2812_DMX
+#include "dmx.h"
+#endif
+#if defined(WS2812_SYNC_MASTER) || defined(WS2812_SYNC_SLAVE)
+#include "framesync.h"
+#endif
+#if defined(WS2812_CAN_MASTER) || defined(WS2812_CAN_NODE) || defined(WS2812_CAN_LOOPBACK)
+#include "canframes.h"
+#endif
+#if defined(WS2812_RS485_MASTER) || defined(WS2812_RS485_NODE)
+#include "hwcrc.h"
+#include "rs485bus.h"
+#endif
 
 // Definitions visible only within this translation unit.
 namespace
@@ -21,7 +49,11 @@ namespace
 
 // Keep the LED on for 2/3 of a second.
 constexpr Timer::ticks_t BLINK_ON_TICKS = 75; //Timer::FREQUENCY_HZ * 3 / 4;
-constexpr Timer::ticks_t BLINK_OFF_TICKS = 100; //Timer::FREQUENCY_HZ- BLINK_ON_TICKS;
+
+// ~50 frames per second
+constexpr Timer::ticks_t FRAME_TICKS = 20;
+// move to the next effect every 10 seconds
+constexpr Timer::ticks_t EFFECT_TICKS = 10 * Timer::FREQUENCY_HZ;
 }
 
 // ----- main() ---------------------------------------------------------------
@@ -37,12 +69,200 @@ constexpr Timer::ticks_t BLINK_OFF_TICKS = 100; //Timer::FREQUENCY_HZ- BLINK_ON_
 uint8_t One[NUMLEDS*3];
 cmdc0de::WS2818 Leds1(GPIO_Pin_7, GPIOA, TIM1, DMA1_Channel2, DMA1_Channel2_IRQn);
 cmdc0de::LedBuffer LBuffer(&One[0], NUMLEDS);
+// lets the ISR skip encoding leds that did not change since the last frame
+uint32_t OneDirty[(NUMLEDS + 31) / 32];
+uint32_t OneEncoded[NUMLEDS * 24 / sizeof(uint32_t)];
+// 20mA per channel, 1mA quiescent per led, 1A supply
+cmdc0de::PowerManager Power(20, 1, 1000);
+
+cmdc0de::RandomEffect Random(175);
+cmdc0de::SolidEffect Solid(cmdc0de::RGB(64, 32, 0));
+cmdc0de::NoiseEffect Clouds(48, 96);
+uint8_t FireHeat[NUMLEDS];
+cmdc0de::FireEffect Fire(&FireHeat[0], NUMLEDS, 55, 120);
+cmdc0de::PlasmaEffect Plasma(12, 3);
+cmdc0de::SineWaveEffect Wave(cmdc0de::RGB(0, 96, 255), 16, 5);
+cmdc0de::ColorWipeEffect Wipe(cmdc0de::RGB(255, 0, 64), 30);
+
+// blue wave screened over the noise clouds, the base layer crossfades to plasma and back
+uint8_t BaseLayer[NUMLEDS*3];
+uint8_t TopLayer[NUMLEDS*3];
+uint8_t Transition[NUMLEDS*3];
+cmdc0de::LedBuffer BaseBuffer(&BaseLayer[0], NUMLEDS);
+cmdc0de::LedBuffer TopBuffer(&TopLayer[0], NUMLEDS);
+cmdc0de::LedBuffer TransitionBuffer(&Transition[0], NUMLEDS);
+cmdc0de::Compositor Layers("layers", &TransitionBuffer);
+
+#ifdef WS2812_STATIC_FRAME
+// one frame sent again by DMA on every TIM3 update
+uint8_t StaticFrame[cmdc0de::WS2818::staticFrameSize(NUMLEDS)];
+#endif
+#if defined(WS2812_ADALIGHT) || defined(WS2812_SPI_SLAVE) || defined(WS2812_PROTOCOL) || defined(WS2812_DMX) \
+		|| defined(WS2812_CAN_NODE) || defined(WS2812_CAN_LOOPBACK) || defined(WS2812_RS485_NODE)
+// streamed frames go straight from the DMA into whichever buffer is free
+uint8_t Stream0[NUMLEDS*3];
+uint8_t Stream1[NUMLEDS*3];
+uint8_t Stream2[NUMLEDS*3];
+cmdc0de::LedBuffer StreamBuffer0(&Stream0[0], NUMLEDS);
+cmdc0de::LedBuffer StreamBuffer1(&Stream1[0], NUMLEDS);
+cmdc0de::LedBuffer StreamBuffer2(&Stream2[0], NUMLEDS);
+cmdc0de::TripleBuffer StreamFrames(&StreamBuffer0, &StreamBuffer1, &StreamBuffer2);
+#endif
+#ifdef WS2812_ADALIGHT
+// PC ambient lighting on USART1 (RX PA10)
+cmdc0de::SerialPort Serial1(USART1);
+cmdc0de::AdalightReceiver Adalight(&Serial1, &StreamFrames);
+#endif
+#ifdef WS2812_SPI_SLAVE
+// frames from an SPI master on SPI2, sent as soon as NSS goes high
+cmdc0de::SpiSlaveReceiver SpiSlave(&StreamFrames, &Leds1, &Power);
+#endif
+#ifdef WS2812_DMX
+// DMX512 on USART1 (RX PA10 from the RS-485 receiver), channels 1-192 of the line are the strand
+const cmdc0de::UniverseMapper::Mapping DmxMap[] = { { 1, 1, 0, NUMLEDS, cmdc0de::UniverseMapper::RGB_ORDER } };
+cmdc0de::UniverseMapper Universes(&DmxMap[0], sizeof(DmxMap) / sizeof(DmxMap[0]));
+cmdc0de::SerialPort Serial1(USART1);
+cmdc0de::DmxReceiver Dmx(&Serial1, 1, &Universes, &StreamFrames);
+#endif
+#ifdef WS2812_SYNC_MASTER
+// drives SYNC (PB0) for the slaves, ACK of one slave on PB1 measures the skew
+cmdc0de::FrameSync Sync(cmdc0de::FrameSync::MASTER, &Leds1);
+#endif
+#ifdef WS2812_SYNC_SLAVE
+// starts each frame on the master's SYNC edge (PB0), answers on ACK (PB1)
+cmdc0de::FrameSync Sync(cmdc0de::FrameSync::SLAVE, &Leds1);
+#endif
+#if defined(WS2812_CAN_MASTER) || defined(WS2812_CAN_NODE) || defined(WS2812_CAN_LOOPBACK)
+#ifndef CAN_NODE_ID
+#define CAN_NODE_ID 1
+#endif
+cmdc0de::CanBus Can;
+#endif
+#if defined(WS2812_CAN_MASTER) || defined(WS2812_CAN_LOOPBACK)
+// the master shows the effects itself and sends the same frame to nodes 1 and 2
+const cmdc0de::CanSegmenter::Slice CanSlices[] = { { 1, 0, NUMLEDS }, { 2, 0, NUMLEDS } };
+cmdc0de::CanSegmenter CanSegments(&CanSlices[0], sizeof(CanSlices) / sizeof(CanSlices[0]));
+cmdc0de::CanFrameSender CanSender(&Can, &CanSegments);
+#endif
+#if defined(WS2812_CAN_NODE) || defined(WS2812_CAN_LOOPBACK)
+// loopback: the strand shows what came back through the filters and reassembly as node 1
+cmdc0de::CanFrameReceiver CanReceiver(&Can, CAN_NODE_ID, &StreamFrames);
+#endif
+#if defined(WS2812_RS485_MASTER) || defined(WS2812_RS485_NODE)
+// RS-485 transceiver on USART2 (TX PA2, RX PA3), DE and /RE on PA1 for the master, tied low on the nodes
+cmdc0de::SerialPort Serial2(USART2);
+cmdc0de::HardwareCrc32 Crc;
+#endif
+#ifdef WS2812_RS485_MASTER
+// nodes 1 and 2 show the same leds as the master
+const cmdc0de::RS485Master::Slice BusSlices[] = { { 1, 0, NUMLEDS }, { 2, 0, NUMLEDS } };
+cmdc0de::RS485Master Bus(&Serial2, GPIOA, GPIO_Pin_1, &Crc, &BusSlices[0], sizeof(BusSlices) / sizeof(BusSlices[0]));
+#endif
+#ifdef WS2812_RS485_NODE
+#ifndef RS485_NODE_ID
+#define RS485_NODE_ID 1
+#endif
+cmdc0de::RS485Node Bus(&Serial2, RS485_NODE_ID, &Crc, &StreamFrames);
+#endif
+cmdc0de::EffectRegistry Effects;
+cmdc0de::EffectRunner Runner(&Effects, &LBuffer, FRAME_TICKS);
+#ifdef WS2812_PROTOCOL
+// binary protocol on USART1, effects run until the first FRAME packet
+cmdc0de::SerialPort Serial1(USART1);
+cmdc0de::HardwareCrc32 Crc;
+// stream, handler and parser point at each other
+extern cmdc0de::PacketParser Parser;
+cmdc0de::UartStream Stream(&Serial1, &Parser, &Crc);
+cmdc0de::CommandHandler Commands(&StreamFrames, &Power, &Runner, &Stream);
+cmdc0de::PacketParser Parser(&Crc, &Commands);
+#endif
 
 extern "C" {
 void DMA1_Channel2_IRQHandler() {
 	Leds1.handleISR();
 }
+#ifdef WS2812_STATIC_FRAME
+void TIM3_IRQHandler() {
+	Leds1.handleRefreshISR();
+}
+#endif
+#ifdef WS2812_ADALIGHT
+void USART1_IRQHandler() {
+	Adalight.handleUSARTISR();
+}
+void DMA1_Channel5_IRQHandler() {
+	Adalight.handleDMAISR();
+}
+#endif
+#ifdef WS2812_PROTOCOL
+void USART1_IRQHandler() {
+	Stream.handleUSARTISR();
+}
+void DMA1_Channel5_IRQHandler() {
+	Stream.handleDMAISR();
+}
+#endif
+#ifdef WS2812_DMX
+void USART1_IRQHandler() {
+	Dmx.handleUSARTISR();
+}
+void DMA1_Channel5_IRQHandler() {
+	Dmx.handleDMAISR();
+}
+#endif
+#ifdef WS2812_SYNC_MASTER
+void EXTI1_IRQHandler() {
+	Sync.handleEXTIISR();
+}
+#endif
+#ifdef WS2812_SYNC_SLAVE
+void EXTI0_IRQHandler() {
+	Sync.handleEXTIISR();
+}
+#endif
+#if defined(WS2812_CAN_MASTER) || defined(WS2812_CAN_LOOPBACK)
+void USB_HP_CAN1_TX_IRQHandler() {
+	CanSender.handleTxISR();
+}
+#endif
+#if defined(WS2812_CAN_NODE) || defined(WS2812_CAN_LOOPBACK)
+void USB_LP_CAN1_RX0_IRQHandler() {
+	CanReceiver.handleRxISR();
+}
+#endif
+#ifdef WS2812_RS485_MASTER
+void USART2_IRQHandler() {
+	Bus.handleUSARTISR();
+}
+void DMA1_Channel7_IRQHandler() {
+	Bus.handleDMAISR();
+}
+#endif
+#ifdef WS2812_RS485_NODE
+void USART2_IRQHandler() {
+	Bus.handleUSARTISR();
+}
+void DMA1_Channel6_IRQHandler() {
+	Bus.handleDMAISR();
+}
+#endif
+#ifdef WS2812_SPI_SLAVE
+void EXTI15_10_IRQHandler() {
+	SpiSlave.handleEXTIISR();
+}
+#endif
+}
+
+#if defined(WS2812_ADALIGHT) || defined(WS2812_PROTOCOL) || defined(WS2812_DMX) || defined(WS2812_CAN_NODE) \
+		|| defined(WS2812_CAN_LOOPBACK) || defined(WS2812_RS485_NODE)
+// sends the newest received frame once the strand is free
+static void showStreamedFrame() {
+	if (!Leds1.isBusy() && StreamFrames.acquire()) {
+		Power.apply(&Leds1, StreamFrames.getFront());
+		Leds1.sendColors(StreamFrames.getFront(), 50);
+	}
 }
+#endif
 
 int
 main(int argc, char* argv[]) {
@@ -50,6 +270,13 @@ main(int argc, char* argv[]) {
 	trace_puts("Hello ARM World!");
 
 	Leds1.init();
+	LBuffer.setDirtyMap(&OneDirty[0]);
+	Leds1.setEncodeCache(reinterpret_cast<uint8_t *>(&OneEncoded[0]), NUMLEDS);
+	cmdc0de::CycleCounter::init();
+
+#ifdef WS2812_BENCHMARK
+	cmdc0de::Benchmark::runAll();
+#endif
 
 	// At this stage the system clock should have already been configured
 	// at high speed.
@@ -61,36 +288,183 @@ main(int argc, char* argv[]) {
 	BlinkLed blinkLed;
 	blinkLed.powerUp();
 
+	Effects.add(&Random);
+	Effects.add(&Solid);
+	Effects.add(&Clouds);
+	Effects.add(&Fire);
+	Effects.add(&Plasma);
+	Effects.add(&Wave);
+	Effects.add(&Wipe);
+	Layers.addLayer(&Clouds, &BaseBuffer, cmdc0de::Compositor::NORMAL, 255);
+	Layers.addLayer(&Wave, &TopBuffer, cmdc0de::Compositor::SCREEN, 160);
+	Effects.add(&Layers);
+	Runner.selectEffect(0);
+
+#ifdef WS2812_STATIC_FRAME
+	Solid.render(&LBuffer, 0);
+	Power.apply(&Leds1, &LBuffer);
+	Leds1.setRefreshTimer(TIM3, TIM3_IRQn);
+	Leds1.startStaticFrame(&LBuffer, &StaticFrame[0], sizeof(StaticFrame), 100, 50);
+	while (1) {
+		// SysTick and the refresh timer wake us, the DMA does the sending
+		__WFI();
+	}
+#endif
+
+#ifdef WS2812_ADALIGHT
+	Adalight.init(1000000, 5);
+	while (1) {
+		Adalight.poll(Timer::getTicks());
+		showStreamedFrame();
+	}
+#endif
+
+#ifdef WS2812_DMX
+	Dmx.init(5);
+	while (1) {
+		showStreamedFrame();
+	}
+#endif
+
+#ifdef WS2812_CAN_NODE
+	Can.init(1000000, false, 5);
+	CanReceiver.init();
+	while (1) {
+		showStreamedFrame();
+	}
+#endif
+#ifdef WS2812_CAN_MASTER
+	Can.init(1000000, false, 5);
+#endif
+#ifdef WS2812_CAN_LOOPBACK
+	Can.init(1000000, true, 5);
+	CanReceiver.init();
+#endif
+
+#ifdef WS2812_RS485_NODE
+	Crc.init();
+	Bus.init(1000000, 5);
+	while (1) {
+		showStreamedFrame();
+	}
+#endif
+#ifdef WS2812_RS485_MASTER
+	Crc.init();
+	// a gap of a byte between two DMA transfers ends the frame on the nodes, nothing may hold this one up
+	Bus.init(1000000, 0);
+#endif
+
+#ifdef WS2812_SPI_SLAVE
+	// same priority as the strand DMA (9)
+	SpiSlave.init(9);
+	while (1) {
+		SpiSlave.poll();
+	}
+#endif
+
+#ifdef WS2812_PROTOCOL
+	Crc.init();
+	Stream.init(1000000, 5);
+#endif
+#if defined(WS2812_SYNC_MASTER) || defined(WS2812_SYNC_SLAVE)
+	Sync.init(0);
+#endif
+#ifdef WS2812_SYNC_SLAVE
+	// render a little faster than the master triggers so a frame is always armed for the edge
+	Runner.setFrameInterval(FRAME_TICKS - 2);
+#endif
+
 	uint32_t seconds = 0;
+	Timer::ticks_t nextSecond = Timer::getTicks();
+	Timer::ticks_t nextEffect = Timer::getTicks() + EFFECT_TICKS;
 
 	// Infinite loop
 	while (1)
 	{
+		Timer::ticks_t now = Timer::getTicks();
 
-		for (int i = 0; i < LBuffer.getNumLeds(); i++) {
-			One[i * 3] = rand() % 256;
-			One[i * 3 + 1] = rand() % 256;
-			One[i * 3 + 2] = rand() % 256;
+#ifdef WS2812_PROTOCOL
+		if (Commands.isStreaming()) {
+			showStreamedFrame();
+		} else
+#endif
+#if defined(WS2812_SYNC_MASTER)
+		if (Runner.update(now)) {
+			Power.apply(&Leds1, &LBuffer);
+			if (Sync.arm(&LBuffer, 50))
+				Sync.trigger();
 		}
-		Leds1.sendColors(&LBuffer, 50);
-
-		blinkLed.turnOn();
-		timer.sleep(seconds == 0 ? Timer::FREQUENCY_HZ : BLINK_ON_TICKS);
+#elif defined(WS2812_SYNC_SLAVE)
+		// the armed frame is read by the strand once the edge comes, leave the buffer alone until then
+		if (!Leds1.isBusy() && Runner.update(now)) {
+			Power.apply(&Leds1, &LBuffer);
+			Sync.arm(&LBuffer, 50);
+		}
+#elif defined(WS2812_CAN_MASTER)
+		// the sender reads the buffer until the last message is queued
+		if (!CanSender.isBusy() && Runner.update(now)) {
+			CanSender.send(&LBuffer);
+			Power.apply(&Leds1, &LBuffer);
+			Leds1.sendColors(&LBuffer, 50);
+		}
+#elif defined(WS2812_RS485_MASTER)
+		// the bus reads the buffer until the latch is out
+		if (!Bus.isBusy() && Runner.update(now)) {
+			Bus.send(&LBuffer);
+			Power.apply(&Leds1, &LBuffer);
+			Leds1.sendColors(&LBuffer, 50);
+		}
+#elif defined(WS2812_CAN_LOOPBACK)
+		if (!CanSender.isBusy() && Runner.update(now))
+			CanSender.send(&LBuffer);
+		showStreamedFrame();
+#else
+		if (Runner.update(now)) {
+			Power.apply(&Leds1, &LBuffer);
+			Leds1.sendColors(&LBuffer, 50);
+		}
+#endif
 
-		for (int i = 0; i < LBuffer.getNumLeds(); i++) {
-			One[i * 3] = rand() % 256;
-			One[i * 3 + 1] = rand() % 256;
-			One[i * 3 + 2] = rand() % 256;
+		if ((int32_t) (now - nextEffect) >= 0) {
+			nextEffect += EFFECT_TICKS;
+			Runner.nextEffect();
 		}
-		Leds1.sendColors(&LBuffer, 12);
 
-		blinkLed.turnOff();
-		timer.sleep(BLINK_OFF_TICKS);
+		if ((int32_t) (now - nextSecond) >= 0) {
+			nextSecond += Timer::FREQUENCY_HZ;
+			++seconds;
+			blinkLed.turnOn();
 
-		++seconds;
+			if (Effects.get(Runner.getCurrentEffect()) == &Layers && (seconds % 4) == 0) {
+				Layers.crossfade(0, Layers.getLayerEffect(0) == &Clouds ? (cmdc0de::Effect *) &Plasma : &Clouds,
+						1500, now);
+			}
 
-		// Count seconds on the trace device.
-		trace_printf("Second %u\n", seconds);
+			// Count seconds and report render time on the trace device.
+			int16_t current = Runner.getCurrentEffect();
+			cmdc0de::EffectRegistry::Stats *stats = Effects.getStats(current);
+			trace_printf("Second %u %s last %u max %u cycles late %u\n", seconds,
+					Effects.get(current)->getName(), stats->LastCycles, stats->MaxCycles,
+					Runner.getLateFrames());
+#if defined(WS2812_SYNC_MASTER) || defined(WS2812_SYNC_SLAVE)
+			trace_printf("Sync %u missed %u skew %d max %u latency %u cycles, %u late acks\n", Sync.getSyncs(),
+					Sync.getMissed(), Sync.getLastSkew(), Sync.getMaxSkew(), Sync.getLatency(), Sync.getLateAcks());
+			Sync.resetSkew();
+#endif
+#if defined(WS2812_CAN_NODE) || defined(WS2812_CAN_LOOPBACK)
+			trace_printf("CAN frames %u incomplete %u rx errors %u\n", CanReceiver.getReassembler()->getFrames(),
+					CanReceiver.getReassembler()->getIncomplete(), Can.getErrorCount());
+#endif
+#ifdef WS2812_RS485_MASTER
+			trace_printf("RS-485 frames %u, %u bytes each\n", Bus.getFrames(), Bus.getFrameBytes());
+#endif
+#ifdef WS2812_RS485_NODE
+			trace_printf("RS-485 frames %u missed %u crc %u header %u size %u truncated %u\n", Bus.getFrames(),
+					Bus.getMissed(), Bus.getCRCErrors(), Bus.getHeaderErrors(), Bus.getSizeErrors(), Bus.getTruncated());
+#endif
+		} else if ((now - (nextSecond - Timer::FREQUENCY_HZ)) >= BLINK_ON_TICKS) {
+			blinkLed.turnOff();
+		}
 	}
 	// Infinite loop, never return.
 }
@@ -0,0 +1,112 @@
+#include "noise.h"
+
+using cmdc0de::Noise;
+
+// Ken Perlin's reference permutation
+static const uint8_t Permutation[256] = {
+		151, 160, 137, 91, 90, 15, 131, 13, 201, 95, 96, 53, 194, 233, 7, 225,
+		140, 36, 103, 30, 69, 142, 8, 99, 37, 240, 21, 10, 23, 190, 6, 148,
+		247, 120, 234, 75, 0, 26, 197, 62, 94, 252, 219, 203, 117, 35, 11, 32,
+		57, 177, 33, 88, 237, 149, 56, 87, 174, 20, 125, 136, 171, 168, 68, 175,
+		74, 165, 71, 134, 139, 48, 27, 166, 77, 146, 158, 231, 83, 111, 229, 122,
+		60, 211, 133, 230, 220, 105, 92, 41, 55, 46, 245, 40, 244, 102, 143, 54,
+		65, 25, 63, 161, 1, 216, 80, 73, 209, 76, 132, 187, 208, 89, 18, 169,
+		200, 196, 135, 130, 116, 188, 159, 86, 164, 100, 109, 198, 173, 186, 3, 64,
+		52, 217, 226, 250, 124, 123, 5, 202, 38, 147, 118, 126, 255, 82, 85, 212,
+		207, 206, 59, 227, 47, 16, 58, 17, 182, 189, 28, 42, 223, 183, 170, 213,
+		119, 248, 152, 2, 44, 154, 163, 70, 221, 153, 101, 155, 167, 43, 172, 9,
+		129, 22, 39, 253, 19, 98, 108, 110, 79, 113, 224, 232, 178, 185, 112, 104,
+		218, 246, 97, 228, 251, 34, 242, 193, 238, 210, 144, 12, 191, 179, 162, 241,
+		81, 51, 145, 235, 249, 14, 239, 107, 49, 192, 214, 31, 181, 199, 106, 157,
+		184, 84, 204, 176, 115, 121, 50, 45, 127, 4, 150, 254, 138, 236, 205, 93,
+		222, 114, 67, 29, 24, 72, 243, 141, 128, 195, 78, 66, 215, 61, 156, 180,
+};
+
+// output scaling per dimension, picked from the measured range of raw values so that
+// 128 +/- (raw * scale >> 8) only rarely clips
+static const int32_t NOISE1_SCALE = 44;
+static const int32_t NOISE2_SCALE = 120;
+static const int32_t NOISE3_SCALE = 224;
+
+static inline uint8_t P(uint32_t i) {
+	return Permutation[i & 0xFF];
+}
+
+// smoothstep 3t^2 - 2t^3 on a Q8 fraction
+static inline int32_t fade(int32_t t) {
+	int32_t t2 = (t * t) >> 8;
+	return (t2 * (768 - 2 * t)) >> 8;
+}
+
+static inline int32_t lerp(int32_t a, int32_t b, int32_t f) {
+	return a + (((b - a) * f) >> 8);
+}
+
+// 12 cube edge directions of improved Perlin noise, x y z are Q8 offsets from the corner
+static inline int32_t grad(uint8_t hash, int32_t x, int32_t y, int32_t z) {
+	uint8_t h = hash & 15;
+	int32_t u = h < 8 ? x : y;
+	int32_t v = h < 4 ? y : (h == 12 || h == 14 ? x : z);
+	return ((h & 1) ? -u : u) + ((h & 2) ? -v : v);
+}
+
+static inline int32_t grad(uint8_t hash, int32_t x, int32_t y) {
+	uint8_t h = hash & 7;
+	int32_t u = h < 4 ? x : y;
+	int32_t v = h < 4 ? y : x;
+	return ((h & 1) ? -u : u) + ((h & 2) ? -2 * v : 2 * v);
+}
+
+static inline int32_t grad(uint8_t hash, int32_t x) {
+	int32_t g = (hash & 7) + 1;
+	return (hash & 8) ? -g * x : g * x;
+}
+
+static inline uint8_t clamp8(int32_t v) {
+	return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+int32_t Noise::raw(uint16_t x, uint16_t y, uint16_t z) {
+	uint8_t X = x >> 8, Y = y >> 8, Z = z >> 8;
+	int32_t fx = x & 0xFF, fy = y & 0xFF, fz = z & 0xFF;
+	int32_t u = fade(fx), v = fade(fy), w = fade(fz);
+
+	uint8_t A = P(X) + Y;
+	uint8_t AA = P(A) + Z;
+	uint8_t AB = P(A + 1) + Z;
+	uint8_t B = P(X + 1) + Y;
+	uint8_t BA = P(B) + Z;
+	uint8_t BB = P(B + 1) + Z;
+
+	int32_t x1 = lerp(grad(P(AA), fx, fy, fz), grad(P(BA), fx - 256, fy, fz), u);
+	int32_t x2 = lerp(grad(P(AB), fx, fy - 256, fz), grad(P(BB), fx - 256, fy - 256, fz), u);
+	int32_t y1 = lerp(x1, x2, v);
+	x1 = lerp(grad(P(AA + 1), fx, fy, fz - 256), grad(P(BA + 1), fx - 256, fy, fz - 256), u);
+	x2 = lerp(grad(P(AB + 1), fx, fy - 256, fz - 256), grad(P(BB + 1), fx - 256, fy - 256, fz - 256), u);
+	int32_t y2 = lerp(x1, x2, v);
+	return lerp(y1, y2, w);
+}
+
+uint8_t Noise::noise8(uint16_t x, uint16_t y, uint16_t z) {
+	return clamp8(128 + ((raw(x, y, z) * NOISE3_SCALE) >> 8));
+}
+
+uint8_t Noise::noise8(uint16_t x, uint16_t y) {
+	uint8_t X = x >> 8, Y = y >> 8;
+	int32_t fx = x & 0xFF, fy = y & 0xFF;
+	int32_t u = fade(fx), v = fade(fy);
+
+	uint8_t A = P(X) + Y;
+	uint8_t B = P(X + 1) + Y;
+
+	int32_t x1 = lerp(grad(P(A), fx, fy), grad(P(B), fx - 256, fy), u);
+	int32_t x2 = lerp(grad(P(A + 1), fx, fy - 256), grad(P(B + 1), fx - 256, fy - 256), u);
+	return clamp8(128 + ((lerp(x1, x2, v) * NOISE2_SCALE) >> 8));
+}
+
+uint8_t Noise::noise8(uint16_t x) {
+	uint8_t X = x >> 8;
+	int32_t fx = x & 0xFF;
+	int32_t n = lerp(grad(P(X), fx), grad(P(X + 1), fx - 256), fade(fx));
+	return clamp8(128 + ((n * NOISE1_SCALE) >> 8));
+}
@@ -0,0 +1,27 @@
+#ifndef __NOISE_H__
+#define __NOISE_H__
+
+#include <stdint.h>
+
+namespace cmdc0de {
+
+/*
+ * Integer only gradient (Perlin) noise.
+ *
+ * Coordinates are Q8.8: the high byte picks the lattice cell and the low byte is the position inside it,
+ * so stepping a coordinate by 256 moves one full cell and the pattern repeats every 256 cells.
+ * Results are 0-255 centered on 128, scaled so a typical field covers most of the range.
+ * The permutation table is const and lives in flash, nothing is kept in RAM.
+ */
+class Noise {
+public:
+	static uint8_t noise8(uint16_t x);
+	static uint8_t noise8(uint16_t x, uint16_t y);
+	static uint8_t noise8(uint16_t x, uint16_t y, uint16_t z);
+	//signed raw value in Q8 (roughly -256..256) before scaling
+	static int32_t raw(uint16_t x, uint16_t y, uint16_t z);
+};
+
+} //cmdc0de
+
+#endif
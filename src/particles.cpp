@@ -0,0 +1,187 @@
+#include "particles.h"
+#include "pixelmath.h"
+#include <stdlib.h>
+
+using cmdc0de::ParticleSystemBase;
+using cmdc0de::Particle;
+using cmdc0de::FireworksEffect;
+using cmdc0de::LedBuffer;
+using cmdc0de::LedMatrix;
+using cmdc0de::PixelMath;
+using cmdc0de::RGB;
+
+// dt is clamped so a stalled frame cannot fling particles through everything
+static const uint32_t MAX_STEP_MS = 100;
+
+static uint8_t addChannel(uint8_t a, uint32_t b) {
+	uint32_t s = a + b;
+	return s > 255 ? 255 : s;
+}
+
+// adds color * scale / 65536 to the led
+static void addLed(LedBuffer *leds, uint16_t led, const RGB &color, uint32_t scale) {
+	uint8_t scratch[3];
+	const uint8_t *c = leds->getColor(led, scratch);
+	leds->setLed(led, addChannel(c[0], (color.getR() * scale) >> 16), addChannel(c[1], (color.getG() * scale) >> 16),
+			addChannel(c[2], (color.getB() * scale) >> 16));
+}
+
+ParticleSystemBase::ParticleSystemBase(Particle *pool, uint8_t *active, uint16_t capacity) :
+		Pool(pool), Active(active), Capacity(capacity), ActiveCount(0), AX(0), AY(0), Width(0), Height(0), Dropped(0) {
+
+}
+
+ParticleSystemBase::~ParticleSystemBase() {
+
+}
+
+Particle *ParticleSystemBase::spawn(int32_t x, int32_t y, int32_t vx, int32_t vy, const RGB &color, uint16_t lifeMS) {
+	int16_t idx = allocate();
+	if (idx < 0) {
+		Dropped++;
+		return 0;
+	}
+	Particle &p = Pool[idx];
+	p.X = x;
+	p.Y = y;
+	p.VX = vx;
+	p.VY = vy;
+	p.Life = lifeMS ? lifeMS : 1;
+	p.Age = 0;
+	p.Color = color;
+	Active[ActiveCount++] = idx;
+	return &p;
+}
+
+void ParticleSystemBase::clear() {
+	while (ActiveCount > 0) {
+		release(Active[--ActiveCount]);
+	}
+}
+
+void ParticleSystemBase::update(uint32_t elapsedMS) {
+	if (elapsedMS > MAX_STEP_MS)
+		elapsedMS = MAX_STEP_MS;
+	// elapsed time as Q16 seconds, one divide per frame instead of per particle
+	int32_t dt = (elapsedMS << 16) / 1000;
+	int32_t dvx = (static_cast<int64_t>(AX) * dt) >> 16;
+	int32_t dvy = (static_cast<int64_t>(AY) * dt) >> 16;
+	int32_t maxX = static_cast<int32_t>(Width) << 16;
+	int32_t maxY = static_cast<int32_t>(Height) << 16;
+	uint16_t i = 0;
+	while (i < ActiveCount) {
+		Particle &p = Pool[Active[i]];
+		p.VX += dvx;
+		p.VY += dvy;
+		p.X += (static_cast<int64_t>(p.VX) * dt) >> 16;
+		p.Y += (static_cast<int64_t>(p.VY) * dt) >> 16;
+		uint32_t age = p.Age + elapsedMS;
+		bool dead = age >= p.Life || (Width && (p.X < 0 || p.X >= maxX)) || (Height && (p.Y < 0 || p.Y >= maxY));
+		if (dead) {
+			// swap the last live particle into this slot and look at it next
+			release(Active[i]);
+			Active[i] = Active[--ActiveCount];
+		} else {
+			p.Age = age;
+			i++;
+		}
+	}
+}
+
+void ParticleSystemBase::render(LedBuffer *leds) {
+	int32_t numLeds = leds->getNumLeds();
+	for (uint16_t i = 0; i < ActiveCount; i++) {
+		const Particle &p = Pool[Active[i]];
+		int32_t led = p.X >> 16;
+		// split the particle between the 2 leds it sits between
+		uint32_t frac = (p.X >> 8) & 0xFF;
+		uint32_t bright = fade(p) + 1;
+		if (led >= 0 && led < numLeds)
+			addLed(leds, led, p.Color, bright * (256 - frac));
+		if (led + 1 >= 0 && led + 1 < numLeds)
+			addLed(leds, led + 1, p.Color, bright * frac);
+	}
+}
+
+void ParticleSystemBase::render(LedMatrix *matrix) {
+	for (uint16_t i = 0; i < ActiveCount; i++) {
+		const Particle &p = Pool[Active[i]];
+		int16_t x = (p.X + 0x8000) >> 16;
+		int16_t y = (p.Y + 0x8000) >> 16;
+		uint8_t scratch[3];
+		const uint8_t *c = matrix->getPixel(x, y, scratch);
+		if (c == 0)
+			continue;
+		uint32_t scale = (fade(p) + 1) << 8;
+		uint8_t out[3];
+		out[0] = addChannel(c[0], (p.Color.getR() * scale) >> 16);
+		out[1] = addChannel(c[1], (p.Color.getG() * scale) >> 16);
+		out[2] = addChannel(c[2], (p.Color.getB() * scale) >> 16);
+		matrix->setPixel(x, y, out);
+	}
+}
+
+static const uint8_t SPARKS_PER_BURST = 16;
+static const uint8_t TRAIL_FADE = 160;
+
+static RGB randomHue() {
+	switch (rand() % 6) {
+	case 0:
+		return RGB(255, 32, 0);
+	case 1:
+		return RGB(255, 160, 0);
+	case 2:
+		return RGB(32, 255, 32);
+	case 3:
+		return RGB(32, 64, 255);
+	case 4:
+		return RGB(200, 0, 255);
+	default:
+		return RGB(255, 255, 255);
+	}
+}
+
+FireworksEffect::FireworksEffect(ParticleSystemBase *particles, uint16_t launchMS) :
+		Effect("fireworks"), Particles(particles), LaunchMS(launchMS), NextLaunch(0), LastFrame(0), Rocket(0) {
+
+}
+
+FireworksEffect::~FireworksEffect() {
+
+}
+
+void FireworksEffect::start(LedBuffer *leds, uint32_t now) {
+	Particles->clear();
+	// strong enough that a 1 second climb tops out at 90% of the strand
+	Particles->setGravity(-ParticleSystemBase::toFixed(leds->getNumLeds()) * 18 / 10, 0);
+	Particles->setBounds(leds->getNumLeds(), 0);
+	NextLaunch = now;
+	LastFrame = now;
+	Rocket = 0;
+	leds->fill(RGB::BLACK);
+}
+
+void FireworksEffect::render(LedBuffer *leds, uint32_t now) {
+	uint32_t elapsed = now - LastFrame;
+	LastFrame = now;
+	int32_t gravity = ParticleSystemBase::toFixed(leds->getNumLeds()) * 18 / 10;
+
+	if (Rocket == 0 && (int32_t) (now - NextLaunch) >= 0) {
+		// climb for 600-1000ms, v = g * t
+		uint16_t climb = 600 + rand() % 400;
+		Rocket = Particles->spawn(0, 0, (gravity / 1000) * climb, 0, RGB(64, 48, 16), climb);
+		NextLaunch = now + LaunchMS;
+	}
+	// the rocket is still alive here, burst it on the frame it would expire
+	if (Rocket && Rocket->Age + elapsed >= Rocket->Life) {
+		RGB color = randomHue();
+		for (uint8_t i = 0; i < SPARKS_PER_BURST; i++) {
+			int32_t speed = (gravity / 512) * ((rand() % 512) - 256) / 2;
+			Particles->spawn(Rocket->X, 0, speed, 0, color, 600 + rand() % 600);
+		}
+		Rocket = 0;
+	}
+	Particles->update(elapsed);
+	PixelMath::scale(leds, TRAIL_FADE);
+	Particles->render(leds);
+}
@@ -0,0 +1,120 @@
+#ifndef __PARTICLES_H__
+#define __PARTICLES_H__
+
+#include "ledmatrix.h"
+#include "effect.h"
+
+namespace cmdc0de {
+
+/*
+ * Position is Q16.16 in leds (X along a strand or matrix column, Y matrix row),
+ * velocity Q16.16 leds per second. Life and Age are milliseconds, brightness fades out linearly with age.
+ */
+struct Particle {
+	int32_t X;
+	int32_t Y;
+	int32_t VX;
+	int32_t VY;
+	uint16_t Life;
+	uint16_t Age;
+	RGB Color;
+};
+
+/*
+ * Physics and rendering for a pool of particles, the storage comes from ParticleSystem<N> below.
+ *
+ * Live particles are kept as a dense list of pool indexes, a dead particle is swapped with the last
+ * entry so spawning, freeing and iterating never search the pool.
+ * Particles that leave the bounds (if set) or outlive their Life are freed during update.
+ * Rendering is additive (saturating) on top of whatever is already in the buffer, on a strand the
+ * particle is spread across the 2 nearest leds by its fractional position so slow particles move smoothly.
+ */
+class ParticleSystemBase {
+public:
+	static int32_t toFixed(int16_t v) {return static_cast<int32_t>(v) << 16;}
+public:
+	virtual ~ParticleSystemBase();
+	//returns 0 if the pool is full
+	Particle *spawn(int32_t x, int32_t y, int32_t vx, int32_t vy, const RGB &color, uint16_t lifeMS);
+	void update(uint32_t elapsedMS);
+	void render(LedBuffer *leds);
+	void render(LedMatrix *matrix);
+	void clear();
+	//Q16.16 leds per second squared
+	void setGravity(int32_t ax, int32_t ay) {AX = ax; AY = ay;}
+	//particles outside 0..width/0..height are freed, 0 disables the check for that axis
+	void setBounds(uint16_t width, uint16_t height) {Width = width; Height = height;}
+	uint16_t getActiveCount() const {return ActiveCount;}
+	uint16_t getCapacity() const {return Capacity;}
+	//spawns refused because the pool was full
+	uint32_t getDropped() const {return Dropped;}
+protected:
+	ParticleSystemBase(Particle *pool, uint8_t *active, uint16_t capacity);
+	//free list, implemented by the sized sub class
+	virtual int16_t allocate() = 0;
+	virtual void release(uint8_t idx) = 0;
+	//0-255 brightness left in the particle
+	static uint8_t fade(const Particle &p) {
+		return 255 - (static_cast<uint32_t>(p.Age) * 255) / p.Life;
+	}
+private:
+	Particle *Pool;
+	uint8_t *Active;
+	uint16_t Capacity;
+	uint16_t ActiveCount;
+	int32_t AX;
+	int32_t AY;
+	uint16_t Width;
+	uint16_t Height;
+	uint32_t Dropped;
+};
+
+/*
+ * Statically sized particle pool, N particles of 24 bytes each (N at most 255).
+ * The free list is a Stack of pool indexes so allocate and release are O(1).
+ */
+template<uint8_t N>
+class ParticleSystem : public ParticleSystemBase {
+public:
+	ParticleSystem() : ParticleSystemBase(Pool, Active, N), Pool(), Active(), FreeList() {
+		for (uint8_t i = N; i > 0; i--) {
+			FreeList.push(i - 1);
+		}
+	}
+	virtual ~ParticleSystem() {
+	}
+protected:
+	virtual int16_t allocate() {
+		uint8_t idx;
+		return FreeList.pop(idx) ? idx : -1;
+	}
+	virtual void release(uint8_t idx) {
+		FreeList.push(idx);
+	}
+private:
+	Particle Pool[N];
+	uint8_t Active[N];
+	Stack<uint8_t, N> FreeList;
+};
+
+/*
+ * Rockets launched from the start of the strand that burst into a shower of sparks.
+ * The previous frame is faded rather than cleared which gives the sparks short trails.
+ */
+class FireworksEffect : public Effect {
+public:
+	FireworksEffect(ParticleSystemBase *particles, uint16_t launchMS);
+	virtual ~FireworksEffect();
+	virtual void start(LedBuffer *leds, uint32_t now);
+	virtual void render(LedBuffer *leds, uint32_t now);
+private:
+	ParticleSystemBase *Particles;
+	uint16_t LaunchMS;
+	uint32_t NextLaunch;
+	uint32_t LastFrame;
+	Particle *Rocket;
+};
+
+} //cmdc0de
+
+#endif
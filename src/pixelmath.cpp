@@ -0,0 +1,216 @@
+#include "pixelmath.h"
+
+using cmdc0de::PixelMath;
+using cmdc0de::LedBuffer;
+using cmdc0de::RGB;
+
+namespace {
+
+struct __attribute__((packed)) UnalignedWord {
+	uint32_t v;
+};
+
+inline uint32_t loadWord(const uint8_t *p) {
+	return reinterpret_cast<const UnalignedWord *>(p)->v;
+}
+
+// number of bytes to handle one at a time before p is word aligned
+inline uint32_t headBytes(const uint8_t *p, uint32_t len) {
+	uint32_t h = (4 - ((uintptr_t) p & 3)) & 3;
+	return h < len ? h : len;
+}
+
+inline uint32_t channelCount(LedBuffer *a, LedBuffer *b) {
+	uint32_t n = a->getNumLeds() < b->getNumLeds() ? a->getNumLeds() : b->getNumLeds();
+	return n * 3;
+}
+
+inline bool isPacked(LedBuffer *a, LedBuffer *b = 0, LedBuffer *c = 0) {
+	return a->getBitsPerLed() != 24 || (b && b->getBitsPerLed() != 24) || (c && c->getBitsPerLed() != 24);
+}
+
+enum OP {
+	SCALE, ADD, BLEND
+};
+
+// the slow path for packed buffers, b is either a buffer or one color for every led
+void perPixel(LedBuffer *dst, LedBuffer *a, LedBuffer *b, const RGB *color, OP op, uint8_t amount) {
+	uint8_t sa[3], sb[3], out[3];
+	uint16_t n = dst->getNumLeds() < a->getNumLeds() ? dst->getNumLeds() : a->getNumLeds();
+	if (b && b->getNumLeds() < n)
+		n = b->getNumLeds();
+	for (uint16_t i = 0; i < n; i++) {
+		const uint8_t *ca = a->getColor(i, sa);
+		const uint8_t *cb = b ? b->getColor(i, sb) : (color ? color->getArray() : 0);
+		for (int ch = 0; ch < 3; ch++) {
+			if (op == SCALE)
+				out[ch] = PixelMath::scaleWord(ca[ch], amount);
+			else if (op == ADD)
+				out[ch] = PixelMath::addSaturateWord(ca[ch], cb[ch]);
+			else
+				out[ch] = PixelMath::blendWord(ca[ch], cb[ch], amount);
+		}
+		dst->setLed(i, out[0], out[1], out[2]);
+	}
+}
+
+// color repeated so a word can be read starting at any channel of the pixel
+class ColorPattern {
+public:
+	ColorPattern(const RGB &color) :
+			Bytes(), Pos(0) {
+		for (int i = 0; i < 16; i++) {
+			Bytes[i] = color.getArray()[i % 3];
+		}
+	}
+	uint32_t nextByte() {
+		uint32_t b = Bytes[Pos];
+		advance(1);
+		return b;
+	}
+	uint32_t nextWord() {
+		uint32_t w = loadWord(&Bytes[Pos]);
+		advance(4);
+		return w;
+	}
+private:
+	void advance(uint32_t n) {
+		Pos += n;
+		if (Pos >= 12)
+			Pos -= 12;
+	}
+	uint8_t Bytes[16];
+	uint32_t Pos;
+};
+
+}
+
+void PixelMath::fill(LedBuffer *dst, const RGB &color) {
+	if (isPacked(dst)) {
+		dst->fill(color);
+		return;
+	}
+	uint8_t *d = dst->getLeds();
+	uint32_t len = dst->getNumLeds() * 3;
+	uint32_t i = 0;
+	ColorPattern pattern(color);
+	for (uint32_t head = headBytes(d, len); i < head; i++) {
+		d[i] = pattern.nextByte();
+	}
+	// 12 bytes is 4 pixels in 3 words, after that the pattern repeats
+	uint32_t p0 = pattern.nextWord();
+	uint32_t p1 = pattern.nextWord();
+	uint32_t p2 = pattern.nextWord();
+	for (; i + 12 <= len; i += 12) {
+		uint32_t *w = reinterpret_cast<uint32_t *>(&d[i]);
+		w[0] = p0;
+		w[1] = p1;
+		w[2] = p2;
+	}
+	for (; i + 4 <= len; i += 4) {
+		*reinterpret_cast<uint32_t *>(&d[i]) = pattern.nextWord();
+	}
+	for (; i < len; i++) {
+		d[i] = pattern.nextByte();
+	}
+	dst->invalidate();
+}
+
+void PixelMath::scale(LedBuffer *dst, uint8_t scale) {
+	if (isPacked(dst)) {
+		perPixel(dst, dst, 0, 0, SCALE, scale);
+		return;
+	}
+	uint8_t *d = dst->getLeds();
+	uint32_t len = dst->getNumLeds() * 3;
+	uint32_t i = 0;
+	for (uint32_t head = headBytes(d, len); i < head; i++) {
+		d[i] = scaleWord(d[i], scale);
+	}
+	for (; i + 4 <= len; i += 4) {
+		uint32_t *w = reinterpret_cast<uint32_t *>(&d[i]);
+		*w = scaleWord(*w, scale);
+	}
+	for (; i < len; i++) {
+		d[i] = scaleWord(d[i], scale);
+	}
+	dst->invalidate();
+}
+
+void PixelMath::addSaturate(LedBuffer *dst, LedBuffer *src) {
+	if (isPacked(dst, src)) {
+		perPixel(dst, dst, src, 0, ADD, 0);
+		return;
+	}
+	uint8_t *d = dst->getLeds();
+	const uint8_t *s = src->getLeds();
+	uint32_t len = channelCount(dst, src);
+	uint32_t i = 0;
+	for (uint32_t head = headBytes(d, len); i < head; i++) {
+		d[i] = addSaturateWord(d[i], s[i]);
+	}
+	for (; i + 4 <= len; i += 4) {
+		uint32_t *w = reinterpret_cast<uint32_t *>(&d[i]);
+		*w = addSaturateWord(*w, loadWord(&s[i]));
+	}
+	for (; i < len; i++) {
+		d[i] = addSaturateWord(d[i], s[i]);
+	}
+	dst->invalidate();
+}
+
+void PixelMath::blend(LedBuffer *dst, LedBuffer *a, LedBuffer *b, uint8_t amount) {
+	if (isPacked(dst, a, b)) {
+		perPixel(dst, a, b, 0, BLEND, amount);
+		return;
+	}
+	uint8_t *d = dst->getLeds();
+	const uint8_t *pa = a->getLeds();
+	const uint8_t *pb = b->getLeds();
+	uint32_t len = channelCount(a, b);
+	uint32_t dlen = dst->getNumLeds() * 3;
+	uint32_t i = 0;
+	if (dlen < len)
+		len = dlen;
+	for (uint32_t head = headBytes(d, len); i < head; i++) {
+		d[i] = blendWord(pa[i], pb[i], amount);
+	}
+	for (; i + 4 <= len; i += 4) {
+		*reinterpret_cast<uint32_t *>(&d[i]) = blendWord(loadWord(&pa[i]), loadWord(&pb[i]), amount);
+	}
+	for (; i < len; i++) {
+		d[i] = blendWord(pa[i], pb[i], amount);
+	}
+	dst->invalidate();
+}
+
+void PixelMath::fadeToward(LedBuffer *dst, const RGB &color, uint8_t amount) {
+	if (isPacked(dst)) {
+		perPixel(dst, dst, 0, &color, BLEND, amount);
+		return;
+	}
+	uint8_t *d = dst->getLeds();
+	uint32_t len = dst->getNumLeds() * 3;
+	uint32_t i = 0;
+	ColorPattern pattern(color);
+	for (uint32_t head = headBytes(d, len); i < head; i++) {
+		d[i] = blendWord(d[i], pattern.nextByte(), amount);
+	}
+	uint32_t p0 = pattern.nextWord();
+	uint32_t p1 = pattern.nextWord();
+	uint32_t p2 = pattern.nextWord();
+	for (; i + 12 <= len; i += 12) {
+		uint32_t *w = reinterpret_cast<uint32_t *>(&d[i]);
+		w[0] = blendWord(w[0], p0, amount);
+		w[1] = blendWord(w[1], p1, amount);
+		w[2] = blendWord(w[2], p2, amount);
+	}
+	for (; i + 4 <= len; i += 4) {
+		uint32_t *w = reinterpret_cast<uint32_t *>(&d[i]);
+		*w = blendWord(*w, pattern.nextWord(), amount);
+	}
+	for (; i < len; i++) {
+		d[i] = blendWord(d[i], pattern.nextByte(), amount);
+	}
+	dst->invalidate();
+}
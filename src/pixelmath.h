@@ -0,0 +1,56 @@
+#ifndef __PIXELMATH_H__
+#define __PIXELMATH_H__
+
+#include "ledbuffer.h"
+
+namespace cmdc0de {
+
+/*
+ * Buffer wide pixel operations for RGB LedBuffers.
+ *
+ * The M3 has no SIMD so these work on 32 bit words holding 4 channel bytes at a time (SWAR),
+ * splitting the word into even/odd byte lanes where a multiply needs 16 bits of headroom.
+ * Channel bytes are treated independently so it does not matter where a pixel starts inside a word.
+ * All of them write through the raw buffer, so the channel sum of the destination is invalidated.
+ * Packed buffers (getBitsPerLed not 24) are handled a pixel at a time through getColor/setLed instead.
+ *
+ * Amounts are 0-255 where 255 means all the way (scale 255 leaves the buffer untouched,
+ * blend 255 is all of the second buffer).
+ */
+class PixelMath {
+public:
+	static void fill(LedBuffer *dst, const RGB &color);
+	//dst = dst * scale / 256
+	static void scale(LedBuffer *dst, uint8_t scale);
+	//dst = min(dst + src, 255)
+	static void addSaturate(LedBuffer *dst, LedBuffer *src);
+	//dst = a + (b - a) * amount
+	static void blend(LedBuffer *dst, LedBuffer *a, LedBuffer *b, uint8_t amount);
+	//dst = dst + (color - dst) * amount
+	static void fadeToward(LedBuffer *dst, const RGB &color, uint8_t amount);
+public:
+	static uint32_t scaleWord(uint32_t w, uint8_t scale) {
+		uint32_t s = scale + 1;
+		uint32_t rb = (((w & 0x00FF00FF) * s) >> 8) & 0x00FF00FF;
+		uint32_t ag = (((w >> 8) & 0x00FF00FF) * s) & 0xFF00FF00;
+		return rb | ag;
+	}
+	static uint32_t addSaturateWord(uint32_t a, uint32_t b) {
+		//add the low 7 bits of each lane, then work out the carry out of bit 7 by hand
+		uint32_t sum = (a & 0x7F7F7F7F) + (b & 0x7F7F7F7F);
+		uint32_t carry = ((a & b) | ((a | b) & sum)) & 0x80808080;
+		sum ^= (a ^ b) & 0x80808080;
+		return sum | ((carry >> 7) * 0xFF);
+	}
+	static uint32_t blendWord(uint32_t a, uint32_t b, uint8_t amount) {
+		uint32_t wb = amount + (amount >> 7);
+		uint32_t wa = 256 - wb;
+		uint32_t rb = ((((a & 0x00FF00FF) * wa) + ((b & 0x00FF00FF) * wb)) >> 8) & 0x00FF00FF;
+		uint32_t ag = ((((a >> 8) & 0x00FF00FF) * wa) + (((b >> 8) & 0x00FF00FF) * wb)) & 0xFF00FF00;
+		return rb | ag;
+	}
+};
+
+} //cmdc0de
+
+#endif
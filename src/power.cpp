@@ -0,0 +1,36 @@
+#include "power.h"
+
+using cmdc0de::PowerManager;
+using cmdc0de::LedBuffer;
+using cmdc0de::WS2818;
+
+PowerManager::PowerManager(uint16_t mAPerChannel, uint16_t idlemAPerLed, uint32_t budgetmA) :
+		MAPerChannel(mAPerChannel), IdlemAPerLed(idlemAPerLed), BudgetmA(budgetmA), LastEstimatemA(0),
+				MaxBrightness(255) {
+
+}
+
+PowerManager::~PowerManager() {
+
+}
+
+uint32_t PowerManager::estimatemA(LedBuffer *colorLeds) {
+	return (colorLeds->getChannelSum() * MAPerChannel) / 255
+			+ (uint32_t) colorLeds->getNumLeds() * IdlemAPerLed;
+}
+
+uint8_t PowerManager::apply(WS2818 *leds, LedBuffer *colorLeds) {
+	uint32_t idle = (uint32_t) colorLeds->getNumLeds() * IdlemAPerLed;
+	// what the channels draw at full brightness
+	uint32_t active = (colorLeds->getChannelSum() * MAPerChannel) / 255;
+	uint32_t brightness = MaxBrightness;
+
+	LastEstimatemA = active + idle;
+	if ((active * MaxBrightness) / 255 + idle > BudgetmA) {
+		brightness = BudgetmA > idle ? ((BudgetmA - idle) * 255) / active : 0;
+		if (brightness > MaxBrightness)
+			brightness = MaxBrightness;
+	}
+	leds->setBrightness(brightness);
+	return brightness;
+}
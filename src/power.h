@@ -0,0 +1,40 @@
+#ifndef __POWER_H__
+#define __POWER_H__
+
+#include "ws2812.h"
+
+namespace cmdc0de {
+
+/*
+ * Keeps a strand inside the current budget of its supply.
+ *
+ * The estimate comes from the running channel sum the LedBuffer keeps as pixels are written,
+ * so it does not cost another pass over the frame:
+ * 		mA = channelSum * mAPerChannel / 255 + numLeds * idlemAPerLed
+ * If that is over budget the strand brightness is lowered (folded into the encoding tables)
+ * just enough to fit, call apply right before sendColors.
+ */
+class PowerManager {
+public:
+	//mAPerChannel is the draw of a single channel at 255, typically 20mA for a WS2812
+	PowerManager(uint16_t mAPerChannel, uint16_t idlemAPerLed, uint32_t budgetmA);
+	~PowerManager();
+	uint32_t estimatemA(LedBuffer *colorLeds);
+	//returns the brightness the strand was set to
+	uint8_t apply(WS2818 *leds, LedBuffer *colorLeds);
+	void setBudget(uint32_t budgetmA) {BudgetmA = budgetmA;}
+	uint32_t getBudget() const {return BudgetmA;}
+	//estimate of the last frame passed to apply, before any limiting
+	uint32_t getLastEstimate() const {return LastEstimatemA;}
+	void setMaxBrightness(uint8_t b) {MaxBrightness = b;}
+private:
+	uint16_t MAPerChannel;
+	uint16_t IdlemAPerLed;
+	uint32_t BudgetmA;
+	uint32_t LastEstimatemA;
+	uint8_t MaxBrightness;
+};
+
+} //cmdc0de
+
+#endif
@@ -0,0 +1,168 @@
+#include "protocol.h"
+#include <string.h>
+
+using cmdc0de::Crc32;
+using cmdc0de::SoftCrc32;
+using cmdc0de::PacketHandler;
+using cmdc0de::PacketParser;
+using cmdc0de::PacketWriter;
+namespace protocol = cmdc0de::protocol;
+
+// 0x04C11DB7 applied to each 4 bit value, msb first
+static const uint32_t NibbleTable[16] = { 0x00000000, 0x04C11DB7, 0x09823B6E, 0x0D4326D9, 0x130476DC, 0x17C56B6B,
+		0x1A864DB2, 0x1E475005, 0x2608EDB8, 0x22C9F00F, 0x2F8AD6D6, 0x2B4BCB61, 0x350C9B64, 0x31CD86D3, 0x3C8EA00A,
+		0x384FBDBD };
+
+SoftCrc32::SoftCrc32() :
+		Value(0xFFFFFFFF) {
+
+}
+
+SoftCrc32::~SoftCrc32() {
+
+}
+
+void SoftCrc32::reset() {
+	Value = 0xFFFFFFFF;
+}
+
+void SoftCrc32::update(uint32_t word) {
+	for (int shift = 28; shift >= 0; shift -= 4) {
+		Value = (Value << 4) ^ NibbleTable[((Value >> 28) ^ (word >> shift)) & 0xF];
+	}
+}
+
+uint32_t SoftCrc32::get() {
+	return Value;
+}
+
+uint32_t PacketWriter::checksum(Crc32 *crc, const uint8_t *bytes, uint32_t len) {
+	uint32_t i = 0;
+	crc->reset();
+	for (; i + 4 <= len; i += 4) {
+		crc->update(PacketWriter::get32(&bytes[i]));
+	}
+	if (i < len) {
+		uint8_t last[4] = { 0, 0, 0, 0 };
+		memcpy(last, &bytes[i], len - i);
+		crc->update(PacketWriter::get32(last));
+	}
+	return crc->get();
+}
+
+uint32_t PacketWriter::encode(Crc32 *crc, uint8_t type, const uint8_t *payload, uint16_t len, uint8_t *out,
+		uint32_t outSize) {
+	if (outSize < packetSize(len))
+		return 0;
+	out[0] = protocol::SYNC;
+	out[1] = len;
+	out[2] = len >> 8;
+	out[3] = type;
+	out[4] = out[1] ^ out[2] ^ type ^ protocol::HEADER_CHECK;
+	if (len)
+		memcpy(&out[protocol::HEADER_SIZE], payload, len);
+	put32(&out[protocol::HEADER_SIZE + len], checksum(crc, &out[1], protocol::HEADER_SIZE - 1 + len));
+	return packetSize(len);
+}
+
+PacketParser::PacketParser(Crc32 *crc, PacketHandler *handler) :
+		Checksum(crc), Handler(handler), State(WAIT_SYNC), Header(), Fill(0), Length(0), Offset(0), Word(0), WordBytes(0),
+				Packets(0), CRCErrors(0), HeaderErrors(0) {
+
+}
+
+PacketParser::~PacketParser() {
+
+}
+
+void PacketParser::reset() {
+	// a packet that was cut off still gets its end call so the handler can drop it
+	if (State == PAYLOAD || State == CHECK)
+		Handler->end(false);
+	State = WAIT_SYNC;
+}
+
+void PacketParser::crcByte(uint8_t b) {
+	Word |= static_cast<uint32_t>(b) << (8 * WordBytes);
+	if (++WordBytes == 4) {
+		Checksum->update(Word);
+		Word = 0;
+		WordBytes = 0;
+	}
+}
+
+uint32_t PacketParser::crcFinish() {
+	if (WordBytes)
+		Checksum->update(Word);
+	return Checksum->get();
+}
+
+void PacketParser::feed(const uint8_t *bytes, uint32_t len) {
+	uint32_t i = 0;
+	while (i < len) {
+		switch (State) {
+		case WAIT_SYNC:
+			while (i < len && bytes[i] != protocol::SYNC)
+				i++;
+			if (i < len) {
+				i++;
+				Header[0] = protocol::SYNC;
+				Fill = 1;
+				Checksum->reset();
+				Word = 0;
+				WordBytes = 0;
+				State = HEADER;
+			}
+			break;
+		case HEADER:
+			Header[Fill++] = bytes[i];
+			crcByte(bytes[i++]);
+			if (Fill == protocol::HEADER_SIZE) {
+				Length = Header[1] | (Header[2] << 8);
+				if ((Header[1] ^ Header[2] ^ Header[3] ^ protocol::HEADER_CHECK) != Header[4]
+						|| Length > protocol::MAX_PAYLOAD) {
+					// false sync, the real one may be among the header bytes just taken
+					uint8_t rescan[protocol::HEADER_SIZE - 1];
+					HeaderErrors++;
+					memcpy(rescan, &Header[1], sizeof(rescan));
+					State = WAIT_SYNC;
+					feed(rescan, sizeof(rescan));
+					break;
+				}
+				Offset = 0;
+				Fill = 0;
+				Handler->begin(Header[3], Length);
+				State = Length ? PAYLOAD : CHECK;
+			}
+			break;
+		case PAYLOAD: {
+			uint32_t n = len - i;
+			if (n > (uint32_t) (Length - Offset))
+				n = Length - Offset;
+			for (uint32_t j = 0; j < n; j++) {
+				crcByte(bytes[i + j]);
+			}
+			Handler->data(&bytes[i], n, Offset);
+			Offset += n;
+			i += n;
+			if (Offset == Length) {
+				Fill = 0;
+				State = CHECK;
+			}
+			break;
+		}
+		case CHECK:
+			Header[Fill++] = bytes[i++];
+			if (Fill == protocol::CRC_SIZE) {
+				bool ok = PacketWriter::get32(Header) == crcFinish();
+				if (ok)
+					Packets++;
+				else
+					CRCErrors++;
+				State = WAIT_SYNC;
+				Handler->end(ok);
+			}
+			break;
+		}
+	}
+}
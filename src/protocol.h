@@ -0,0 +1,153 @@
+#ifndef __PROTOCOL_H__
+#define __PROTOCOL_H__
+
+#include <stdint.h>
+
+namespace cmdc0de {
+
+/*
+ * Packet format shared by the firmware and the Linux tools (multi byte fields little endian):
+ * 	0      SYNC   0xA5
+ * 	1-2    LEN    payload length
+ * 	3      TYPE
+ * 	4      HCHK   LEN0 ^ LEN1 ^ TYPE ^ 0x5A, lets the parser drop a false SYNC before trusting LEN
+ * 	5..    payload
+ * 	       CRC32  over bytes 1 up to the end of the payload
+ *
+ * The CRC is the one the STM32 CRC unit computes (polynomial 0x04C11DB7, initial value 0xFFFFFFFF,
+ * no reflection, no final xor) which works on 32 bit words. The covered bytes are taken 4 at a time as
+ * little endian words (the way the M3 loads them) and the last word is padded with zeros.
+ * Crc32 hides whether the unit or the table driven SoftCrc32 does the work.
+ */
+namespace protocol {
+	static const uint8_t SYNC = 0xA5;
+	static const uint8_t HEADER_CHECK = 0x5A;
+	static const uint8_t HEADER_SIZE = 5;
+	static const uint8_t CRC_SIZE = 4;
+	//largest payload the parser accepts, anything longer is taken as a false sync
+	static const uint16_t MAX_PAYLOAD = 2048;
+	//replies set the top bit of the request type
+	static const uint8_t REPLY = 0x80;
+	enum TYPE {
+		//R,G,B bytes from led 0
+		FRAME = 0x01,
+		//u8 max brightness
+		BRIGHTNESS = 0x02,
+		//u8 effect index
+		SELECT_EFFECT = 0x03,
+		//no payload, answered with STATS | REPLY
+		STATS = 0x04,
+		//FrameDecoder (framecodec.h) RLE runs
+		FRAME_RLE = 0x05,
+		//FrameDecoder DELTA ops against the last frame received
+		FRAME_DELTA = 0x06,
+		//u8 1 = answer every frame packet with FLOW_CONTROL | REPLY, 0 = stop, answered itself either way
+		FLOW_CONTROL = 0x07
+	};
+	//STATS | REPLY payload: u32 packets, CRC errors, header errors, overruns, dropped frames,
+	//then u8 max brightness, u8 effect index (0xFF if none)
+	static const uint8_t STATS_SIZE = 22;
+	//FLOW_CONTROL | REPLY payload: u32 frame packets received, frames rejected (CRC, decode or no delta base),
+	//frames published but overwritten before the strand showed them, all counted since power up
+	static const uint8_t FLOW_SIZE = 12;
+}
+
+class Crc32 {
+public:
+	virtual ~Crc32() {
+	}
+	virtual void reset() = 0;
+	virtual void update(uint32_t word) = 0;
+	virtual uint32_t get() = 0;
+};
+
+class SoftCrc32 : public Crc32 {
+public:
+	SoftCrc32();
+	virtual ~SoftCrc32();
+	virtual void reset();
+	virtual void update(uint32_t word);
+	virtual uint32_t get();
+private:
+	uint32_t Value;
+};
+
+/*
+ * Receives payload of the packets PacketParser finds. data may be called several times per packet with
+ * consecutive chunks (pointers into the caller's receive buffer, they are only valid during the call),
+ * end always follows a begin and tells whether the CRC matched, only then should the packet take effect.
+ */
+class PacketHandler {
+public:
+	virtual ~PacketHandler() {
+	}
+	virtual void begin(uint8_t type, uint16_t len) = 0;
+	virtual void data(const uint8_t *bytes, uint16_t len, uint16_t offset) = 0;
+	virtual void end(bool crcOk) = 0;
+};
+
+/*
+ * Byte stream to packets, bytes can be fed in any split (e.g. whatever a DMA ring holds right now).
+ * Payload is passed through to the handler as runs, it is never copied.
+ */
+class PacketParser {
+public:
+	PacketParser(Crc32 *crc, PacketHandler *handler);
+	~PacketParser();
+	void feed(const uint8_t *bytes, uint32_t len);
+	void reset();
+	uint32_t getPackets() const {return Packets;}
+	uint32_t getCRCErrors() const {return CRCErrors;}
+	//false SYNCs, bad header checks and oversize lengths
+	uint32_t getHeaderErrors() const {return HeaderErrors;}
+protected:
+	enum STATE {
+		WAIT_SYNC,
+		HEADER,
+		PAYLOAD,
+		CHECK
+	};
+	void crcByte(uint8_t b);
+	uint32_t crcFinish();
+private:
+	Crc32 *Checksum;
+	PacketHandler *Handler;
+	STATE State;
+	uint8_t Header[protocol::HEADER_SIZE];
+	uint8_t Fill;
+	uint16_t Length;
+	uint16_t Offset;
+	uint32_t Word;
+	uint8_t WordBytes;
+	uint32_t Packets;
+	uint32_t CRCErrors;
+	uint32_t HeaderErrors;
+};
+
+/*
+ * Builds packets, returns the number of bytes written to out or 0 if it does not fit
+ * (out needs len + HEADER_SIZE + CRC_SIZE bytes).
+ */
+class PacketWriter {
+public:
+	static uint32_t encode(Crc32 *crc, uint8_t type, const uint8_t *payload, uint16_t len, uint8_t *out,
+			uint32_t outSize);
+	//CRC of bytes as the packets use it, little endian words with the last one zero padded
+	static uint32_t checksum(Crc32 *crc, const uint8_t *bytes, uint32_t len);
+	static uint32_t packetSize(uint16_t len) {
+		return len + protocol::HEADER_SIZE + protocol::CRC_SIZE;
+	}
+	static void put32(uint8_t *p, uint32_t v) {
+		p[0] = v;
+		p[1] = v >> 8;
+		p[2] = v >> 16;
+		p[3] = v >> 24;
+	}
+	static uint32_t get32(const uint8_t *p) {
+		return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+	}
+};
+
+} //cmdc0de
+
+#endif
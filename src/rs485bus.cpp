@@ -0,0 +1,266 @@
+#include "rs485bus.h"
+#include <string.h>
+
+using cmdc0de::RS485Master;
+using cmdc0de::RS485Node;
+using cmdc0de::SerialPort;
+using cmdc0de::Crc32;
+using cmdc0de::PacketWriter;
+using cmdc0de::TripleBuffer;
+using cmdc0de::LedBuffer;
+namespace rs485 = cmdc0de::rs485;
+
+void rs485::makeHeader(uint8_t *out, uint8_t addr, uint8_t seq, uint16_t len) {
+	out[0] = SYNC;
+	out[1] = addr;
+	out[2] = seq;
+	out[3] = len;
+	out[4] = len >> 8;
+	out[5] = addr ^ seq ^ out[3] ^ out[4] ^ HEADER_CHECK;
+}
+
+bool rs485::checkHeader(const uint8_t *header) {
+	return header[0] == SYNC && (header[1] ^ header[2] ^ header[3] ^ header[4] ^ HEADER_CHECK) == header[5];
+}
+
+RS485Master::RS485Master(SerialPort *port, GPIO_TypeDef *dePort, uint16_t dePin, Crc32 *crc, const Slice *slices,
+		uint8_t numSlices) :
+		Port(port), DEPort(dePort), DEPin(dePin), Checksum(crc), Slices(slices),
+				NumSlices(numSlices > MAX_SLICES ? MAX_SLICES : numSlices), Glue(), Payload(), PayloadLength(),
+				Chunk(0), Seq(0), Busy(false), FrameBytes(0), Frames(0) {
+
+}
+
+RS485Master::~RS485Master() {
+
+}
+
+void RS485Master::init(uint32_t baud, uint8_t irqPriority) {
+	GPIO_InitTypeDef gpio;
+	if (DEPort == GPIOA)
+		RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOA, ENABLE);
+	else if (DEPort == GPIOB)
+		RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOB, ENABLE);
+	else
+		RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOC, ENABLE);
+	// receiving until there is something to send
+	DEPort->BRR = DEPin;
+	gpio.GPIO_Pin = DEPin;
+	gpio.GPIO_Mode = GPIO_Mode_Out_PP;
+	gpio.GPIO_Speed = GPIO_Speed_50MHz;
+	GPIO_Init(DEPort, &gpio);
+
+	Port->init(baud, USART_StopBits_1, irqPriority);
+	Port->enableTxIRQ(irqPriority);
+}
+
+bool RS485Master::send(LedBuffer *leds) {
+	if (Busy)
+		return false;
+	Seq++;
+	FrameBytes = rs485::HEADER_SIZE;
+	for (uint8_t i = 0; i < NumSlices; i++) {
+		const Slice &slice = Slices[i];
+		uint32_t numLeds = 0;
+		if (slice.FirstLed < leds->getNumLeds()) {
+			numLeds = leds->getNumLeds() - slice.FirstLed;
+			if (numLeds > slice.NumLeds)
+				numLeds = slice.NumLeds;
+		}
+		uint32_t len = numLeds * 3;
+		if (len > rs485::MAX_SLICE)
+			len = rs485::MAX_SLICE - rs485::MAX_SLICE % 3;
+		Payload[i] = leds->getLeds() + slice.FirstLed * 3;
+		PayloadLength[i] = len;
+		rs485::makeHeader(&Glue[i][rs485::CRC_SIZE], slice.Node, Seq, len);
+		PacketWriter::put32(&Glue[i + 1][0], PacketWriter::checksum(Checksum, Payload[i], len));
+		FrameBytes += len + rs485::CRC_SIZE + rs485::HEADER_SIZE;
+	}
+	rs485::makeHeader(&Glue[NumSlices][rs485::CRC_SIZE], rs485::LATCH, Seq, 0);
+
+	Busy = true;
+	Chunk = 0;
+	DEPort->BSRR = DEPin;
+	startChunk();
+	return true;
+}
+
+// even chunks are glue, odd ones the leds of a slice
+void RS485Master::startChunk() {
+	while (Chunk & 1) {
+		uint8_t slice = Chunk >> 1;
+		if (PayloadLength[slice]) {
+			Port->startTx(Payload[slice], PayloadLength[slice]);
+			return;
+		}
+		Chunk++;
+	}
+	if (Chunk == 0)
+		Port->startTx(&Glue[0][rs485::CRC_SIZE], rs485::HEADER_SIZE);
+	else
+		Port->startTx(&Glue[Chunk >> 1][0], sizeof(Glue[0]));
+}
+
+void RS485Master::handleDMAISR() {
+	if (!Port->txComplete())
+		return;
+	if (++Chunk <= NumSlices * 2) {
+		startChunk();
+	} else {
+		// the latch is in the USART, let go of the line once its last bit is out
+		USART_ITConfig(Port->getUSART(), USART_IT_TC, ENABLE);
+	}
+}
+
+void RS485Master::handleUSARTISR() {
+	USART_TypeDef *usart = Port->getUSART();
+	if (USART_GetITStatus(usart, USART_IT_TC) != SET)
+		return;
+	USART_ITConfig(usart, USART_IT_TC, DISABLE);
+	DEPort->BRR = DEPin;
+	Busy = false;
+	Frames++;
+}
+
+RS485Node::RS485Node(SerialPort *port, uint8_t node, Crc32 *crc, TripleBuffer *frames) :
+		Port(port), Node(node), Checksum(crc), FrameBuffers(frames), State(HEADER), Header(), Check(), Sink(0),
+				Length(0), Seq(0), Ready(false), Frames(0), Missed(0), CRCErrors(0), HeaderErrors(0), SizeErrors(0),
+				Truncated(0) {
+
+}
+
+RS485Node::~RS485Node() {
+
+}
+
+void RS485Node::init(uint32_t baud, uint8_t irqPriority) {
+	Port->init(baud, USART_StopBits_1, irqPriority);
+	USART_ITConfig(Port->getUSART(), USART_IT_IDLE, ENABLE);
+	USART_ITConfig(Port->getUSART(), USART_IT_ERR, ENABLE);
+	// whatever is on the line now is the middle of a frame
+	armWaitIdle();
+}
+
+void RS485Node::armHeader() {
+	State = HEADER;
+	Port->armRx(Header, rs485::HEADER_SIZE, true);
+}
+
+void RS485Node::armSkip(uint32_t len) {
+	State = SKIP;
+	Port->armRx(&Sink, len, false);
+}
+
+void RS485Node::armWaitIdle() {
+	State = WAIT_IDLE;
+	Ready = false;
+	Port->armRx(&Sink, 0xFFFF, false);
+}
+
+void RS485Node::latch(uint8_t seq) {
+	if (!Ready || seq != Seq) {
+		Missed++;
+		return;
+	}
+	Ready = false;
+	LedBuffer *back = FrameBuffers->getBack();
+	if (back->getBitsPerLed() != 24)
+		return;
+	if (PacketWriter::get32(Check) != PacketWriter::checksum(Checksum, back->getLeds(), Length)) {
+		CRCErrors++;
+		return;
+	}
+	uint32_t room = back->getNumLeds() * 3;
+	if (Length < room)
+		memset(back->getLeds() + Length, 0, room - Length);
+	FrameBuffers->publish();
+	Frames++;
+}
+
+void RS485Node::headerReceived() {
+	if (!rs485::checkHeader(Header)) {
+		HeaderErrors++;
+		armWaitIdle();
+		return;
+	}
+	uint16_t len = Header[3] | (Header[4] << 8);
+	if (Header[1] == rs485::LATCH) {
+		// nothing follows on the line until the next frame, plenty of time for the CRC
+		armHeader();
+		latch(Header[2]);
+		return;
+	}
+	if (len > rs485::MAX_SLICE) {
+		HeaderErrors++;
+		armWaitIdle();
+		return;
+	}
+	if (Header[1] != Node) {
+		armSkip(len + rs485::CRC_SIZE);
+		return;
+	}
+	Ready = false;
+	LedBuffer *back = FrameBuffers->getBack();
+	if (len == 0 || back->getBitsPerLed() != 24 || len > back->getNumLeds() * 3) {
+		SizeErrors++;
+		armSkip(len + rs485::CRC_SIZE);
+		return;
+	}
+	Length = len;
+	Seq = Header[2];
+	State = PAYLOAD;
+	Port->armRx(back->getLeds(), len, true);
+}
+
+void RS485Node::handleDMAISR() {
+	if (!Port->rxComplete())
+		return;
+	switch (State) {
+	case HEADER:
+		headerReceived();
+		break;
+	case PAYLOAD:
+		State = CHECK;
+		Port->armRx(Check, rs485::CRC_SIZE, true);
+		break;
+	case CHECK:
+		armHeader();
+		Ready = true;
+		break;
+	case SKIP:
+		armHeader();
+		break;
+	case WAIT_IDLE:
+		// no idle for 65535 byte times, keep waiting
+		armWaitIdle();
+		break;
+	}
+}
+
+void RS485Node::handleUSARTISR() {
+	USART_TypeDef *usart = Port->getUSART();
+	uint16_t sr = usart->SR;
+	if (!(sr & (USART_FLAG_IDLE | USART_FLAG_ORE | USART_FLAG_FE | USART_FLAG_NE)))
+		return;
+	// SR then DR clears IDLE and the error flags, the DMA has already taken the data byte
+	(void) usart->DR;
+	if (sr & USART_FLAG_ORE) {
+		// bytes are missing, nothing more of this frame can be trusted
+		Truncated++;
+		Port->stopRx();
+		armWaitIdle();
+		return;
+	}
+	if (!(sr & USART_FLAG_IDLE))
+		return;
+	if (State == WAIT_IDLE) {
+		Port->stopRx();
+		armHeader();
+	} else if (State != HEADER || Port->getRxRemaining() != rs485::HEADER_SIZE) {
+		// the frame stopped part way, the next one starts with a header
+		Truncated++;
+		Ready = false;
+		Port->stopRx();
+		armHeader();
+	}
+}
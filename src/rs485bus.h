@@ -0,0 +1,146 @@
+#ifndef __RS485BUS_H__
+#define __RS485BUS_H__
+
+#include "serialport.h"
+#include "ledbuffer.h"
+#include "protocol.h"
+
+namespace cmdc0de {
+
+/*
+ * Multi drop RS-485 bus, one master broadcasting every frame to all nodes (multi byte fields little endian):
+ * 	per node: SYNC 0x96, ADDR, SEQ, LEN0, LEN1, HCHK (ADDR ^ SEQ ^ LEN0 ^ LEN1 ^ 0x5A), LEN bytes R,G,B,
+ * 	          CRC32 of the R,G,B bytes (PacketWriter::checksum)
+ * 	then:     a header with ADDR LATCH, the same SEQ and LEN 0, nothing follows it
+ * A node whose slice came in with a good CRC publishes it on the latch, so all nodes change frame together.
+ * A frame is one burst with no gap longer than a byte; the line going idle ends it, and a node that is
+ * part way through a frame at that point drops it and waits for the next header.
+ */
+namespace rs485 {
+	static const uint8_t SYNC = 0x96;
+	static const uint8_t HEADER_CHECK = 0x5A;
+	static const uint8_t HEADER_SIZE = 6;
+	static const uint8_t CRC_SIZE = 4;
+	static const uint8_t LATCH = 0xFF;
+	//the node skips a slice and its CRC with one transfer
+	static const uint16_t MAX_SLICE = 0xFFFF - CRC_SIZE;
+	void makeHeader(uint8_t *out, uint8_t addr, uint8_t seq, uint16_t len);
+	bool checkHeader(const uint8_t *header);
+}
+
+/*
+ * Master on a USART with the transceiver's DE (and /RE) on a GPIO pin.
+ *
+ * send raises DE and hands the frame to the TX DMA as a chain of transfers, re-armed from the TX transfer
+ * complete interrupt: header of the first slice, its leds straight from the LedBuffer, then the CRC of that
+ * slice together with the next header and so on up to the latch. The USART transfer complete interrupt
+ * drops DE once the last stop bit is out. The interrupt must be serviced within a byte time (10us at 1Mbaud)
+ * or the nodes see the gap as the end of the frame, give it a high priority.
+ * The buffer is read until isBusy is false, do not render into it before then.
+ */
+class RS485Master {
+public:
+	static const uint8_t MAX_SLICES = 32;
+	struct Slice {
+		uint8_t Node;
+		uint16_t FirstLed;
+		uint16_t NumLeds;
+	};
+public:
+	RS485Master(SerialPort *port, GPIO_TypeDef *dePort, uint16_t dePin, Crc32 *crc, const Slice *slices,
+			uint8_t numSlices);
+	~RS485Master();
+	void init(uint32_t baud, uint8_t irqPriority);
+	//false if the previous frame is still going out
+	bool send(LedBuffer *leds);
+	bool isBusy() const {return Busy;}
+	void handleUSARTISR();
+	void handleDMAISR();
+	uint32_t getFrames() const {return Frames;}
+	//bytes on the wire per frame
+	uint32_t getFrameBytes() const {return FrameBytes;}
+protected:
+	void startChunk();
+private:
+	SerialPort *Port;
+	GPIO_TypeDef *DEPort;
+	uint16_t DEPin;
+	Crc32 *Checksum;
+	const Slice *Slices;
+	uint8_t NumSlices;
+	//CRC of slice i - 1 then header of slice i, the last one ends with the latch
+	uint8_t Glue[MAX_SLICES + 1][rs485::CRC_SIZE + rs485::HEADER_SIZE];
+	const uint8_t *Payload[MAX_SLICES];
+	uint16_t PayloadLength[MAX_SLICES];
+	uint8_t Chunk;
+	uint8_t Seq;
+	volatile bool Busy;
+	uint32_t FrameBytes;
+	volatile uint32_t Frames;
+};
+
+/*
+ * Node, receive only (DE tied low). The RX DMA runs in phases, re-armed from its transfer complete interrupt:
+ * 	HEADER:   6 bytes into Header
+ * 	PAYLOAD:  this node's slice straight into the back buffer of the TripleBuffer
+ * 	CHECK:    its CRC
+ * 	SKIP:     other nodes' slices and CRCs go into one byte with memory increment off
+ * 	WAIT_IDLE after a bad header or an overrun, everything goes into that byte until the line goes idle
+ * The CRC is checked on the latch (the line is quiet after it), a slice shorter than the buffer leaves the
+ * rest black, a longer one (or any slice if the buffer is packed) is dropped.
+ */
+class RS485Node {
+public:
+	RS485Node(SerialPort *port, uint8_t node, Crc32 *crc, TripleBuffer *frames);
+	~RS485Node();
+	//priority should be above (numerically lower than) the strand DMA
+	void init(uint32_t baud, uint8_t irqPriority);
+	void handleUSARTISR();
+	void handleDMAISR();
+	uint8_t getNode() const {return Node;}
+	uint32_t getFrames() const {return Frames;}
+	//latches without a good slice of that frame
+	uint32_t getMissed() const {return Missed;}
+	uint32_t getCRCErrors() const {return CRCErrors;}
+	uint32_t getHeaderErrors() const {return HeaderErrors;}
+	//slices longer than the buffer
+	uint32_t getSizeErrors() const {return SizeErrors;}
+	//frames cut off by idle or overrun
+	uint32_t getTruncated() const {return Truncated;}
+protected:
+	enum STATE {
+		HEADER,
+		PAYLOAD,
+		CHECK,
+		SKIP,
+		WAIT_IDLE
+	};
+	void armHeader();
+	void armSkip(uint32_t len);
+	void armWaitIdle();
+	void headerReceived();
+	void latch(uint8_t seq);
+private:
+	SerialPort *Port;
+	uint8_t Node;
+	Crc32 *Checksum;
+	TripleBuffer *FrameBuffers;
+	volatile STATE State;
+	uint8_t Header[rs485::HEADER_SIZE];
+	uint8_t Check[rs485::CRC_SIZE];
+	uint8_t Sink;
+	uint16_t Length;
+	uint8_t Seq;
+	//a slice is waiting in the back buffer for the latch of Seq
+	bool Ready;
+	volatile uint32_t Frames;
+	volatile uint32_t Missed;
+	volatile uint32_t CRCErrors;
+	volatile uint32_t HeaderErrors;
+	volatile uint32_t SizeErrors;
+	volatile uint32_t Truncated;
+};
+
+} //cmdc0de
+
+#endif
@@ -0,0 +1,170 @@
+#include "serialport.h"
+
+using cmdc0de::SerialPort;
+
+SerialPort::SerialPort(USART_TypeDef *usart) :
+		Usart(usart), RxDMA(DMA1_Channel5), TxDMA(DMA1_Channel4), UsartIRQ(USART1_IRQn), RxIRQ(DMA1_Channel5_IRQn),
+				TxIRQ(DMA1_Channel4_IRQn) {
+	if (usart == USART2) {
+		RxDMA = DMA1_Channel6;
+		TxDMA = DMA1_Channel7;
+		UsartIRQ = USART2_IRQn;
+		RxIRQ = DMA1_Channel6_IRQn;
+		TxIRQ = DMA1_Channel7_IRQn;
+	} else if (usart == USART3) {
+		RxDMA = DMA1_Channel3;
+		TxDMA = DMA1_Channel2;
+		UsartIRQ = USART3_IRQn;
+		RxIRQ = DMA1_Channel3_IRQn;
+		TxIRQ = DMA1_Channel2_IRQn;
+	}
+}
+
+SerialPort::~SerialPort() {
+
+}
+
+uint32_t SerialPort::dmaShift(DMA_Channel_TypeDef *ch) {
+	// DMA1 channel registers are 0x14 apart, each channel owns 4 flag bits
+	return (((uint32_t) ch - (uint32_t) DMA1_Channel1) / 0x14) * 4;
+}
+
+void SerialPort::enableIRQ(IRQn_Type irq, uint8_t priority) {
+	NVIC_InitTypeDef nvic;
+	nvic.NVIC_IRQChannel = irq;
+	nvic.NVIC_IRQChannelPreemptionPriority = priority;
+	nvic.NVIC_IRQChannelSubPriority = 0;
+	nvic.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_Init(&nvic);
+}
+
+void SerialPort::setupDMA(DMA_Channel_TypeDef *ch, uint32_t dir) {
+	DMA_InitTypeDef dma;
+	DMA_DeInit(ch);
+	dma.DMA_PeripheralBaseAddr = (uint32_t) &Usart->DR;
+	dma.DMA_MemoryBaseAddr = 0;
+	dma.DMA_DIR = dir;
+	dma.DMA_BufferSize = 0;
+	dma.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+	dma.DMA_MemoryInc = DMA_MemoryInc_Enable;
+	dma.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+	dma.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+	dma.DMA_Mode = DMA_Mode_Normal;
+	// above the strand refill so a byte is never left sitting in DR long enough to overrun
+	dma.DMA_Priority = DMA_Priority_VeryHigh;
+	dma.DMA_M2M = DMA_M2M_Disable;
+	DMA_Init(ch, &dma);
+}
+
+void SerialPort::init(uint32_t baud, uint16_t stopBits, uint8_t irqPriority) {
+	GPIO_InitTypeDef gpio;
+	USART_InitTypeDef usart;
+	GPIO_TypeDef *port = GPIOA;
+	uint16_t txPin = GPIO_Pin_9;
+	uint16_t rxPin = GPIO_Pin_10;
+
+	RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
+	if (Usart == USART1) {
+		RCC_APB2PeriphClockCmd(RCC_APB2Periph_USART1 | RCC_APB2Periph_GPIOA | RCC_APB2Periph_AFIO, ENABLE);
+	} else if (Usart == USART2) {
+		RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOA | RCC_APB2Periph_AFIO, ENABLE);
+		RCC_APB1PeriphClockCmd(RCC_APB1Periph_USART2, ENABLE);
+		txPin = GPIO_Pin_2;
+		rxPin = GPIO_Pin_3;
+	} else {
+		RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOB | RCC_APB2Periph_AFIO, ENABLE);
+		RCC_APB1PeriphClockCmd(RCC_APB1Periph_USART3, ENABLE);
+		port = GPIOB;
+		txPin = GPIO_Pin_10;
+		rxPin = GPIO_Pin_11;
+	}
+
+	gpio.GPIO_Pin = txPin;
+	gpio.GPIO_Mode = GPIO_Mode_AF_PP;
+	gpio.GPIO_Speed = GPIO_Speed_50MHz;
+	GPIO_Init(port, &gpio);
+	gpio.GPIO_Pin = rxPin;
+	gpio.GPIO_Mode = GPIO_Mode_IPU;
+	GPIO_Init(port, &gpio);
+
+	USART_DeInit(Usart);
+	usart.USART_BaudRate = baud;
+	usart.USART_WordLength = USART_WordLength_8b;
+	usart.USART_StopBits = stopBits;
+	usart.USART_Parity = USART_Parity_No;
+	usart.USART_HardwareFlowControl = USART_HardwareFlowControl_None;
+	usart.USART_Mode = USART_Mode_Rx | USART_Mode_Tx;
+	USART_Init(Usart, &usart);
+
+	setupDMA(RxDMA, DMA_DIR_PeripheralSRC);
+	setupDMA(TxDMA, DMA_DIR_PeripheralDST);
+	USART_DMACmd(Usart, USART_DMAReq_Rx | USART_DMAReq_Tx, ENABLE);
+
+	enableIRQ(UsartIRQ, irqPriority);
+	enableIRQ(RxIRQ, irqPriority);
+	USART_Cmd(Usart, ENABLE);
+}
+
+void SerialPort::armRx(uint8_t *dst, uint16_t len, bool increment) {
+	RxDMA->CCR &= ~(DMA_CCR1_EN | DMA_CCR1_CIRC | DMA_CCR1_MINC | DMA_CCR1_HTIE);
+	RxDMA->CMAR = (uint32_t) dst;
+	RxDMA->CNDTR = len;
+	RxDMA->CCR |= (increment ? DMA_CCR1_MINC : 0) | DMA_CCR1_TCIE | DMA_CCR1_EN;
+}
+
+void SerialPort::armRxCircular(uint8_t *dst, uint16_t len) {
+	RxDMA->CCR &= ~DMA_CCR1_EN;
+	RxDMA->CMAR = (uint32_t) dst;
+	RxDMA->CNDTR = len;
+	RxDMA->CCR |= DMA_CCR1_MINC | DMA_CCR1_CIRC | DMA_CCR1_HTIE | DMA_CCR1_TCIE | DMA_CCR1_EN;
+}
+
+void SerialPort::stopRx() {
+	RxDMA->CCR &= ~DMA_CCR1_EN;
+}
+
+void SerialPort::startTx(const uint8_t *src, uint16_t len) {
+	TxDMA->CCR &= ~DMA_CCR1_EN;
+	TxDMA->CMAR = (uint32_t) src;
+	TxDMA->CNDTR = len;
+	// TC has to be clear or the last byte of the previous transfer would count as this one finishing
+	USART_ClearFlag(Usart, USART_FLAG_TC);
+	TxDMA->CCR |= DMA_CCR1_EN;
+}
+
+bool SerialPort::isTxBusy() const {
+	// CNDTR reaches 0 once the DMA has handed the last byte over, TC once it has left the shift register
+	return TxDMA->CNDTR != 0 || !(Usart->SR & USART_FLAG_TC);
+}
+
+void SerialPort::enableTxIRQ(uint8_t irqPriority) {
+	TxDMA->CCR |= DMA_CCR1_TCIE;
+	enableIRQ(TxIRQ, irqPriority);
+}
+
+bool SerialPort::rxComplete() {
+	uint32_t flag = DMA1_IT_TC1 << dmaShift(RxDMA);
+	if (DMA1->ISR & flag) {
+		DMA1->IFCR = flag | (DMA1_IT_GL1 << dmaShift(RxDMA));
+		return true;
+	}
+	return false;
+}
+
+bool SerialPort::rxHalfOrComplete() {
+	uint32_t flags = (DMA1_IT_TC1 | DMA1_IT_HT1) << dmaShift(RxDMA);
+	if (DMA1->ISR & flags) {
+		DMA1->IFCR = flags | (DMA1_IT_GL1 << dmaShift(RxDMA));
+		return true;
+	}
+	return false;
+}
+
+bool SerialPort::txComplete() {
+	uint32_t flag = DMA1_IT_TC1 << dmaShift(TxDMA);
+	if (DMA1->ISR & flag) {
+		DMA1->IFCR = flag | (DMA1_IT_GL1 << dmaShift(TxDMA));
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,64 @@
+#ifndef __SERIALPORT_H__
+#define __SERIALPORT_H__
+
+#include "stm32f10x_conf.h"
+
+namespace cmdc0de {
+
+/*
+ * Clocks, pins and DMA channels of USART1-3 on their default pins, shared by the serial receivers.
+ *
+ * 	USART1: TX PA9,  RX PA10, RX DMA1 channel 5, TX DMA1 channel 4
+ * 	USART2: TX PA2,  RX PA3,  RX DMA1 channel 6, TX DMA1 channel 7
+ * 	USART3: TX PB10, RX PB11, RX DMA1 channel 3, TX DMA1 channel 2
+ * USART3 TX shares DMA1 channel 2 with TIM1 CC1 (the WS2818 on PA7), use it receive only next to that strand.
+ *
+ * The RX channel is set up for byte transfers from DR with the transfer complete interrupt on,
+ * armRx repoints it for each phase of a protocol so payload can land straight in its final place.
+ * The owner handles the USART and RX DMA interrupts and uses the flag helpers below. TX runs without an
+ * interrupt, isTxBusy tells when the last byte has left the pin, unless enableTxIRQ turns the TX transfer
+ * complete interrupt on for an owner that chains transfers.
+ */
+class SerialPort {
+public:
+	SerialPort(USART_TypeDef *usart);
+	~SerialPort();
+	//stopBits is USART_StopBits_1 or USART_StopBits_2, the NVIC priority is used for the USART and RX DMA interrupts
+	void init(uint32_t baud, uint16_t stopBits, uint8_t irqPriority);
+	USART_TypeDef *getUSART() {return Usart;}
+	DMA_Channel_TypeDef *getRxDMA() {return RxDMA;}
+	DMA_Channel_TypeDef *getTxDMA() {return TxDMA;}
+	//(re)starts the RX channel, increment false keeps writing the same byte (used to skip data)
+	void armRx(uint8_t *dst, uint16_t len, bool increment);
+	//same but wraps around forever, with the half and full interrupts on so a ring is drained at least twice a lap
+	void armRxCircular(uint8_t *dst, uint16_t len);
+	void stopRx();
+	//bytes the current RX transfer still expects
+	uint16_t getRxRemaining() const {return RxDMA->CNDTR;}
+	void startTx(const uint8_t *src, uint16_t len);
+	bool isTxBusy() const;
+	//transfer complete interrupt on the TX channel, the owner handles it and checks txComplete
+	void enableTxIRQ(uint8_t irqPriority);
+	//DMA1 interrupt flag bits of a channel, e.g. DMA1_IT_TC1 << dmaShift(ch)
+	static uint32_t dmaShift(DMA_Channel_TypeDef *ch);
+	//checks and clears the RX transfer complete flag
+	bool rxComplete();
+	//checks and clears the RX half and full flags (circular mode)
+	bool rxHalfOrComplete();
+	//checks and clears the TX transfer complete flag
+	bool txComplete();
+protected:
+	void setupDMA(DMA_Channel_TypeDef *ch, uint32_t dir);
+	void enableIRQ(IRQn_Type irq, uint8_t priority);
+private:
+	USART_TypeDef *Usart;
+	DMA_Channel_TypeDef *RxDMA;
+	DMA_Channel_TypeDef *TxDMA;
+	IRQn_Type UsartIRQ;
+	IRQn_Type RxIRQ;
+	IRQn_Type TxIRQ;
+};
+
+} //cmdc0de
+
+#endif
@@ -0,0 +1,139 @@
+#include "spislave.h"
+#include <string.h>
+
+using cmdc0de::SpiSlaveReceiver;
+using cmdc0de::TripleBuffer;
+using cmdc0de::WS2818;
+using cmdc0de::PowerManager;
+using cmdc0de::LedBuffer;
+
+SpiSlaveReceiver::SpiSlaveReceiver(TripleBuffer *frames, WS2818 *strand, PowerManager *power) :
+		FrameBuffers(frames), Strand(strand), Power(power), Frames(0), Runts(0), Overflows(0) {
+
+}
+
+SpiSlaveReceiver::~SpiSlaveReceiver() {
+
+}
+
+void SpiSlaveReceiver::init(uint8_t irqPriority) {
+	GPIO_InitTypeDef gpio;
+	SPI_InitTypeDef spi;
+	DMA_InitTypeDef dma;
+	EXTI_InitTypeDef exti;
+	NVIC_InitTypeDef nvic;
+
+	RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOB | RCC_APB2Periph_AFIO, ENABLE);
+	RCC_APB1PeriphClockCmd(RCC_APB1Periph_SPI2, ENABLE);
+	RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
+
+	gpio.GPIO_Pin = GPIO_Pin_12 | GPIO_Pin_13 | GPIO_Pin_14 | GPIO_Pin_15;
+	gpio.GPIO_Mode = GPIO_Mode_IN_FLOATING;
+	gpio.GPIO_Speed = GPIO_Speed_50MHz;
+	GPIO_Init(GPIOB, &gpio);
+
+	SPI_I2S_DeInit(SPI2);
+	spi.SPI_Direction = SPI_Direction_2Lines_RxOnly;
+	spi.SPI_Mode = SPI_Mode_Slave;
+	spi.SPI_DataSize = SPI_DataSize_8b;
+	spi.SPI_CPOL = SPI_CPOL_Low;
+	spi.SPI_CPHA = SPI_CPHA_1Edge;
+	spi.SPI_NSS = SPI_NSS_Hard;
+	spi.SPI_BaudRatePrescaler = SPI_BaudRatePrescaler_2;
+	spi.SPI_FirstBit = SPI_FirstBit_MSB;
+	spi.SPI_CRCPolynomial = 7;
+	SPI_Init(SPI2, &spi);
+
+	DMA_DeInit(DMA1_Channel4);
+	dma.DMA_PeripheralBaseAddr = (uint32_t) &SPI2->DR;
+	dma.DMA_MemoryBaseAddr = 0;
+	dma.DMA_DIR = DMA_DIR_PeripheralSRC;
+	dma.DMA_BufferSize = 0;
+	dma.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+	dma.DMA_MemoryInc = DMA_MemoryInc_Enable;
+	dma.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+	dma.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+	dma.DMA_Mode = DMA_Mode_Normal;
+	dma.DMA_Priority = DMA_Priority_VeryHigh;
+	dma.DMA_M2M = DMA_M2M_Disable;
+	DMA_Init(DMA1_Channel4, &dma);
+	SPI_I2S_DMACmd(SPI2, SPI_I2S_DMAReq_Rx, ENABLE);
+
+	// NSS going high ends the frame
+	GPIO_EXTILineConfig(GPIO_PortSourceGPIOB, GPIO_PinSource12);
+	exti.EXTI_Line = EXTI_Line12;
+	exti.EXTI_Mode = EXTI_Mode_Interrupt;
+	exti.EXTI_Trigger = EXTI_Trigger_Rising;
+	exti.EXTI_LineCmd = ENABLE;
+	EXTI_Init(&exti);
+
+	nvic.NVIC_IRQChannel = EXTI15_10_IRQn;
+	nvic.NVIC_IRQChannelPreemptionPriority = irqPriority;
+	nvic.NVIC_IRQChannelSubPriority = 0;
+	nvic.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_Init(&nvic);
+
+	arm();
+	SPI_Cmd(SPI2, ENABLE);
+}
+
+void SpiSlaveReceiver::arm() {
+	LedBuffer *back = FrameBuffers->getBack();
+	DMA1_Channel4->CCR &= ~DMA_CCR1_EN;
+	DMA1_Channel4->CMAR = (uint32_t) back->getLeds();
+	DMA1_Channel4->CNDTR = back->getNumLeds() * 3;
+	DMA1_Channel4->CCR |= DMA_CCR1_EN;
+}
+
+void SpiSlaveReceiver::latch() {
+	LedBuffer *back = FrameBuffers->getBack();
+	uint32_t room = back->getNumLeds() * 3;
+	uint32_t received;
+
+	DMA1_Channel4->CCR &= ~DMA_CCR1_EN;
+	received = room - DMA1_Channel4->CNDTR;
+	// a full buffer leaves the extra bytes in DR and OVR set, reading DR then SR clears both
+	if (SPI2->SR & (SPI_I2S_FLAG_RXNE | SPI_I2S_FLAG_OVR)) {
+		if (SPI2->SR & SPI_I2S_FLAG_OVR)
+			Overflows++;
+		(void) SPI2->DR;
+		(void) SPI2->SR;
+	}
+	// drops a partial byte left in the shift register by a glitch on SCK
+	SPI_Cmd(SPI2, DISABLE);
+	SPI_Cmd(SPI2, ENABLE);
+
+	if (received < 3) {
+		Runts++;
+		arm();
+		return;
+	}
+	if (received < room)
+		memset(back->getLeds() + received, 0, room - received);
+	FrameBuffers->publish();
+	Frames++;
+	arm();
+	kick();
+}
+
+void SpiSlaveReceiver::kick() {
+	if (!Strand->isBusy() && FrameBuffers->acquire()) {
+		if (Power)
+			Power->apply(Strand, FrameBuffers->getFront());
+		Strand->sendColors(FrameBuffers->getFront(), 0);
+	}
+}
+
+void SpiSlaveReceiver::handleEXTIISR() {
+	if (EXTI_GetITStatus(EXTI_Line12) != RESET) {
+		EXTI_ClearITPendingBit(EXTI_Line12);
+		latch();
+	}
+}
+
+void SpiSlaveReceiver::poll() {
+	// the latch interrupt kicks frames too, keep it out while this one does
+	NVIC_DisableIRQ(EXTI15_10_IRQn);
+	kick();
+	NVIC_EnableIRQ(EXTI15_10_IRQn);
+}
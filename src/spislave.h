@@ -0,0 +1,52 @@
+#ifndef __SPISLAVE_H__
+#define __SPISLAVE_H__
+
+#include "ws2812.h"
+#include "power.h"
+
+namespace cmdc0de {
+
+/*
+ * Takes frames from an SPI master on SPI2 as a receive only slave (mode 0, msb first):
+ * 	NSS PB12, SCK PB13, MOSI PB15. MISO (PB14) is left as an input so several slaves can share the bus.
+ * A frame is everything clocked in while NSS is low, R,G,B from led 0 on. Leds past the buffer are dropped,
+ * a short frame leaves the rest black.
+ *
+ * RX DMA (DMA1 channel 4) writes straight into the back buffer of the TripleBuffer with no interrupts,
+ * NSS going high (EXTI line 12) latches the frame: the byte count is read back from the DMA, the buffer is
+ * published, the DMA is pointed at the next back buffer and if the strand is idle the frame is sent right
+ * away from the interrupt. Frames that land while the strand is busy go out from poll in the main loop.
+ * The master should keep NSS high for ~5us between frames so the latch is done before the next one starts.
+ *
+ * SPI1 is not usable here, its RX DMA channel is the one TIM1 uses for the strand. Channel 4 is also
+ * USART1 TX, so SerialPort TX on USART1 can not be used at the same time.
+ */
+class SpiSlaveReceiver {
+public:
+	SpiSlaveReceiver(TripleBuffer *frames, WS2818 *strand, PowerManager *power);
+	~SpiSlaveReceiver();
+	//use the same priority as the strand DMA interrupt, sending from the latch must not preempt its refill
+	void init(uint8_t irqPriority);
+	void handleEXTIISR();
+	void poll();
+	uint32_t getFrames() const {return Frames;}
+	//NSS pulses with less than one led of data
+	uint32_t getRunts() const {return Runts;}
+	//frames that were longer than the buffer
+	uint32_t getOverflows() const {return Overflows;}
+protected:
+	void arm();
+	void latch();
+	void kick();
+private:
+	TripleBuffer *FrameBuffers;
+	WS2818 *Strand;
+	PowerManager *Power;
+	volatile uint32_t Frames;
+	volatile uint32_t Runts;
+	volatile uint32_t Overflows;
+};
+
+} //cmdc0de
+
+#endif
@@ -0,0 +1,91 @@
+#include "sprite.h"
+
+using cmdc0de::Sprite;
+using cmdc0de::LedMatrix;
+using cmdc0de::RGB;
+
+void Sprite::expand(uint16_t row, uint16_t column, uint8_t count, const RGB &color, uint8_t *line,
+		uint32_t *opaque) const {
+	opaque[0] = opaque[1] = 0;
+	switch (Format) {
+	case MONO1: {
+		const uint8_t *src = &Data[row * ((Width + 7) >> 3)];
+		for (uint8_t i = 0; i < count; i++, line += 3) {
+			uint16_t c = column + i;
+			if (src[c >> 3] & (0x80 >> (c & 7))) {
+				opaque[i >> 5] |= 1u << (i & 31);
+				line[0] = color.getR();
+				line[1] = color.getG();
+				line[2] = color.getB();
+			}
+		}
+		break;
+	}
+	case PALETTE8: {
+		const uint8_t *src = &Data[row * Width + column];
+		for (uint8_t i = 0; i < count; i++, line += 3) {
+			if (Transparent && src[i] == 0)
+				continue;
+			const uint8_t *p = &Palette[src[i] * 3];
+			opaque[i >> 5] |= 1u << (i & 31);
+			line[0] = p[0];
+			line[1] = p[1];
+			line[2] = p[2];
+		}
+		break;
+	}
+	case RGB888:
+	default: {
+		const uint8_t *src = &Data[(row * Width + column) * 3];
+		for (uint8_t i = 0; i < count; i++, line += 3, src += 3) {
+			if (Transparent && (src[0] | src[1] | src[2]) == 0)
+				continue;
+			opaque[i >> 5] |= 1u << (i & 31);
+			line[0] = src[0];
+			line[1] = src[1];
+			line[2] = src[2];
+		}
+		break;
+	}
+	}
+}
+
+void Sprite::draw(LedMatrix *matrix, int16_t x, int16_t y, const RGB &color) const {
+	// clip to the part of the sprite that lands on the matrix
+	int16_t col0 = x < 0 ? -x : 0;
+	int16_t row0 = y < 0 ? -y : 0;
+	int16_t col1 = Width;
+	int16_t row1 = Height;
+	if (x + col1 > matrix->getWidth())
+		col1 = matrix->getWidth() - x;
+	if (y + row1 > matrix->getHeight())
+		row1 = matrix->getHeight() - y;
+	if (col0 >= col1 || row0 >= row1)
+		return;
+
+	// opaque RGB rows are already laid out the way blit wants them
+	if (Format == RGB888 && !Transparent) {
+		matrix->blit(x + col0, y + row0, col1 - col0, row1 - row0, &Data[(row0 * Width + col0) * 3], Width * 3);
+		return;
+	}
+
+	uint8_t line[MAX_LINE * 3];
+	uint32_t opaque[2];
+	for (int16_t row = row0; row < row1; row++) {
+		for (int16_t col = col0; col < col1; col += MAX_LINE) {
+			uint8_t count = (col1 - col) > MAX_LINE ? MAX_LINE : (col1 - col);
+			expand(row, col, count, color, line, opaque);
+			// hand each run of opaque pixels to the matrix in one go
+			uint8_t i = 0;
+			while (i < count) {
+				while (i < count && !(opaque[i >> 5] & (1u << (i & 31))))
+					i++;
+				uint8_t start = i;
+				while (i < count && (opaque[i >> 5] & (1u << (i & 31))))
+					i++;
+				if (i > start)
+					matrix->blit(x + col + start, y + row, i - start, 1, &line[start * 3], 0);
+			}
+		}
+	}
+}
@@ -0,0 +1,55 @@
+#ifndef __SPRITE_H__
+#define __SPRITE_H__
+
+#include "ledmatrix.h"
+
+namespace cmdc0de {
+
+/*
+ * Read only image that is drawn onto a LedMatrix, the constructor is constexpr so a const Sprite
+ * (and the pixel data / palette it points at) stays in flash.
+ *
+ * 	MONO1:    1 bit per pixel, rows padded to whole bytes, msb is the leftmost pixel.
+ * 	          Set bits are drawn in the color passed to draw, clear bits are transparent.
+ * 	PALETTE8: 1 byte index per pixel into palette (R,G,B bytes per entry), index 0 is transparent
+ * 	          when the sprite is marked transparent.
+ * 	RGB888:   R,G,B per pixel, black is transparent when the sprite is marked transparent.
+ *
+ * Drawing clips against the matrix so x/y may be negative or run past the edge, which is all
+ * scrolling needs. Each row is expanded into a line buffer and the opaque runs are handed to
+ * LedMatrix::blit so the layout mapping is done per run, not per pixel.
+ */
+class Sprite {
+public:
+	enum FORMAT {
+		MONO1 = 0,
+		PALETTE8,
+		RGB888
+	};
+	//pixels expanded per pass, wider sprites are drawn in several passes
+	static const uint8_t MAX_LINE = 64;
+public:
+	constexpr Sprite(FORMAT format, uint16_t width, uint16_t height, const uint8_t *data, const uint8_t *palette,
+			bool transparent) :
+			Format(format), Width(width), Height(height), Data(data), Palette(palette), Transparent(transparent) {
+	}
+	uint16_t getWidth() const {return Width;}
+	uint16_t getHeight() const {return Height;}
+	//color is only used by MONO1 sprites
+	void draw(LedMatrix *matrix, int16_t x, int16_t y, const RGB &color) const;
+protected:
+	//expands count pixels of row starting at column into line, returns a bitmask word per 32 pixels of opacity
+	void expand(uint16_t row, uint16_t column, uint8_t count, const RGB &color, uint8_t *line,
+			uint32_t *opaque) const;
+private:
+	FORMAT Format;
+	uint16_t Width;
+	uint16_t Height;
+	const uint8_t *Data;
+	const uint8_t *Palette;
+	bool Transparent;
+};
+
+} //cmdc0de
+
+#endif
@@ -0,0 +1,68 @@
+#include "uartstream.h"
+
+using cmdc0de::UartStream;
+using cmdc0de::SerialPort;
+using cmdc0de::PacketParser;
+using cmdc0de::PacketWriter;
+using cmdc0de::Crc32;
+
+UartStream::UartStream(SerialPort *port, PacketParser *parser, Crc32 *crc) :
+		Port(port), Parser(parser), Checksum(crc), Ring(), Tail(0), TxBuffer(), Overruns(0) {
+
+}
+
+UartStream::~UartStream() {
+
+}
+
+void UartStream::init(uint32_t baud, uint8_t irqPriority) {
+	Port->init(baud, USART_StopBits_1, irqPriority);
+	USART_ITConfig(Port->getUSART(), USART_IT_IDLE, ENABLE);
+	USART_ITConfig(Port->getUSART(), USART_IT_ERR, ENABLE);
+	Tail = 0;
+	Port->armRxCircular(Ring, RING_SIZE);
+}
+
+void UartStream::drain() {
+	uint16_t head = RING_SIZE - Port->getRxRemaining();
+	if (head == RING_SIZE)
+		head = 0;
+	if (head < Tail) {
+		Parser->feed(&Ring[Tail], RING_SIZE - Tail);
+		Tail = 0;
+	}
+	if (head > Tail) {
+		Parser->feed(&Ring[Tail], head - Tail);
+		Tail = head;
+	}
+}
+
+void UartStream::handleDMAISR() {
+	if (Port->rxHalfOrComplete())
+		drain();
+}
+
+void UartStream::handleUSARTISR() {
+	USART_TypeDef *usart = Port->getUSART();
+	uint16_t sr = usart->SR;
+	if (!(sr & (USART_FLAG_IDLE | USART_FLAG_ORE | USART_FLAG_FE | USART_FLAG_NE)))
+		return;
+	// SR then DR clears IDLE and the error flags
+	(void) usart->DR;
+	drain();
+	if (sr & USART_FLAG_ORE) {
+		// a byte is gone, whatever packet it was in can not pass its CRC
+		Overruns++;
+		Parser->reset();
+	}
+}
+
+bool UartStream::sendPacket(uint8_t type, const uint8_t *payload, uint16_t len) {
+	if (Port->isTxBusy())
+		return false;
+	uint32_t n = PacketWriter::encode(Checksum, type, payload, len, TxBuffer, sizeof(TxBuffer));
+	if (n == 0)
+		return false;
+	Port->startTx(TxBuffer, n);
+	return true;
+}
@@ -0,0 +1,45 @@
+#ifndef __UARTSTREAM_H__
+#define __UARTSTREAM_H__
+
+#include "serialport.h"
+#include "protocol.h"
+
+namespace cmdc0de {
+
+/*
+ * Packet transport over a USART.
+ * RX DMA runs circular into a ring, the half, full and IDLE line interrupts hand whatever arrived since the
+ * last call to the PacketParser in place (the handler sees runs of the ring, nothing is copied out first).
+ * At 1Mbaud the half ring interrupt comes every ~1.3ms, handlers have to finish well inside that.
+ * sendPacket encodes into a small TX buffer and sends it with DMA, it shares the Crc32 with the parser
+ * so it must only be called from the same interrupt context (i.e. from the packet handler).
+ */
+class UartStream {
+public:
+	static const uint16_t RING_SIZE = 256;
+	static const uint16_t TX_SIZE = 64;
+public:
+	UartStream(SerialPort *port, PacketParser *parser, Crc32 *crc);
+	~UartStream();
+	void init(uint32_t baud, uint8_t irqPriority);
+	void handleUSARTISR();
+	void handleDMAISR();
+	//false if the previous packet is still going out or this one does not fit TX_SIZE
+	bool sendPacket(uint8_t type, const uint8_t *payload, uint16_t len);
+	PacketParser *getParser() {return Parser;}
+	uint32_t getOverruns() const {return Overruns;}
+protected:
+	void drain();
+private:
+	SerialPort *Port;
+	PacketParser *Parser;
+	Crc32 *Checksum;
+	uint8_t Ring[RING_SIZE];
+	uint16_t Tail;
+	uint8_t TxBuffer[TX_SIZE];
+	volatile uint32_t Overruns;
+};
+
+} //cmdc0de
+
+#endif
@@ -0,0 +1,68 @@
+#include "universe.h"
+#include <string.h>
+
+using cmdc0de::UniverseMapper;
+using cmdc0de::LedBuffer;
+
+// where R, G and B sit in the 3 channels of a pixel, by ORDER
+static const uint8_t ChannelOffsets[6][3] = { { 0, 1, 2 }, { 0, 2, 1 }, { 1, 0, 2 }, { 2, 0, 1 }, { 1, 2, 0 }, { 2, 1, 0 } };
+
+UniverseMapper::UniverseMapper(const Mapping *map, uint8_t count) :
+		Map(map), Count(count > MAX_MAPPINGS ? MAX_MAPPINGS : count), AllMask(0), Arrived(0) {
+	for (uint8_t i = 0; i < Count; i++) {
+		AllMask |= 1u << i;
+	}
+}
+
+UniverseMapper::~UniverseMapper() {
+
+}
+
+uint32_t UniverseMapper::maskOf(uint16_t universe) const {
+	uint32_t mask = 0;
+	for (uint8_t i = 0; i < Count; i++) {
+		if (Map[i].Universe == universe)
+			mask |= 1u << i;
+	}
+	return mask;
+}
+
+int8_t UniverseMapper::indexOf(uint16_t universe) const {
+	for (uint8_t i = 0; i < Count; i++) {
+		if (Map[i].Universe == universe)
+			return i;
+	}
+	return -1;
+}
+
+uint16_t UniverseMapper::write(uint16_t universe, const uint8_t *channels, uint16_t count, LedBuffer *leds) const {
+	uint16_t written = 0;
+	if (leds->getBitsPerLed() != 24)
+		return 0;
+	if (count > CHANNELS)
+		count = CHANNELS;
+	for (uint8_t i = 0; i < Count; i++) {
+		const Mapping &m = Map[i];
+		if (m.Universe != universe || m.StartAddress < 1 || m.StartAddress > count || m.FirstLed >= leds->getNumLeds())
+			continue;
+		uint16_t n = (count - (m.StartAddress - 1)) / 3;
+		if (n > m.NumLeds)
+			n = m.NumLeds;
+		if (n > leds->getNumLeds() - m.FirstLed)
+			n = leds->getNumLeds() - m.FirstLed;
+		const uint8_t *src = &channels[m.StartAddress - 1];
+		uint8_t *dst = leds->getLed(m.FirstLed);
+		if (m.Order == RGB_ORDER) {
+			memcpy(dst, src, n * 3);
+		} else {
+			const uint8_t *o = ChannelOffsets[m.Order];
+			for (uint16_t led = 0; led < n; led++, src += 3, dst += 3) {
+				dst[0] = src[o[0]];
+				dst[1] = src[o[1]];
+				dst[2] = src[o[2]];
+			}
+		}
+		written += n;
+	}
+	return written;
+}
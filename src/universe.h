@@ -0,0 +1,72 @@
+#ifndef __UNIVERSE_H__
+#define __UNIVERSE_H__
+
+#include "ledbuffer.h"
+
+namespace cmdc0de {
+
+/*
+ * Maps lighting control universes (512 channel DMX style address spaces, as they arrive over DMX512,
+ * E1.31 or Art-Net) onto the pixels of an RGB LedBuffer.
+ *
+ * Each Mapping takes NumLeds * 3 channels of one universe starting at StartAddress (1 based, as on a desk)
+ * and writes them to the leds from FirstLed on, in the channel order of the fixture profile. One universe can
+ * feed several ranges and a range can be shorter than its universe, anything past the end of the universe
+ * data or the buffer is left alone. Pixels are written through the raw buffer, the buffer has to be
+ * invalidated (TripleBuffer::publish does) before it is used, and a packed buffer gets nothing.
+ *
+ * The mapper also tracks which of its universes arrived since the last frame so receivers know when a frame
+ * is complete, see arrived.
+ */
+class UniverseMapper {
+public:
+	static const uint16_t CHANNELS = 512;
+	static const uint8_t MAX_MAPPINGS = 32;
+	//order the 3 channels of a pixel arrive in
+	enum ORDER {
+		RGB_ORDER,
+		RBG_ORDER,
+		GRB_ORDER,
+		GBR_ORDER,
+		BRG_ORDER,
+		BGR_ORDER
+	};
+	struct Mapping {
+		uint16_t Universe;
+		uint16_t StartAddress;
+		uint16_t FirstLed;
+		uint16_t NumLeds;
+		ORDER Order;
+	};
+public:
+	//map is used in place, at most MAX_MAPPINGS entries
+	UniverseMapper(const Mapping *map, uint8_t count);
+	~UniverseMapper();
+	bool isMapped(uint16_t universe) const {return maskOf(universe)!=0;}
+	//first mapping entry of the universe or -1, a small stable key for per universe state
+	int8_t indexOf(uint16_t universe) const;
+	//channels is slot 1 onwards (no start code), returns the number of leds written
+	uint16_t write(uint16_t universe, const uint8_t *channels, uint16_t count, LedBuffer *leds) const;
+	//true if the universe was already received for the frame being built
+	bool hasArrived(uint16_t universe) const {return (Arrived & maskOf(universe))!=0;}
+	//records the universe, returns true once every mapped universe arrived, start the next frame with clearArrived
+	bool arrived(uint16_t universe) {
+		Arrived |= maskOf(universe);
+		return Arrived==AllMask;
+	}
+	void clearArrived() {Arrived = 0;}
+	uint8_t getCount() const {return Count;}
+	const Mapping *getMapping(uint8_t i) const {return &Map[i];}
+protected:
+	//one bit per mapping entry fed by the universe
+	uint32_t maskOf(uint16_t universe) const;
+private:
+	const Mapping *Map;
+	uint8_t Count;
+	uint32_t AllMask;
+	uint32_t Arrived;
+};
+
+} //cmdc0de
+
+#endif
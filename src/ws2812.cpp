@@ -3,39 +3,6 @@
 #include <string.h>
 #include <stdlib.h>
 
-using cmdc0de::RGB;
-using cmdc0de::LedBuffer;
-
-RGB RGB::WHITE(255, 255, 255);
-RGB RGB::BLACK(0, 0, 0);
-RGB RGB::RED(255, 0, 0);
-RGB RGB::GREEN(0, 255, 0);
-RGB RGB::BLUE(0, 0, 255);
-
-RGB::RGB() {
-	Clr[0] = 0;
-	Clr[1] = 0;
-	Clr[2] = 0;
-}
-
-RGB::RGB(uint8_t r, uint8_t g, uint8_t b) {
-	Clr[0] = r;
-	Clr[1] = g;
-	Clr[2] = b;
-}
-
-RGB::~RGB() {
-
-}
-
-const uint8_t *RGB::getArray() const {
-	return &Clr[0];
-}
-
-RGB RGB::createRandomColor() {
-	return RGB(rand() % 256, rand() % 256, rand() % 256);
-}
-
 // The minimum is to have 2 leds (1 per half buffer) in the buffer, this
 // consume 42Bytes and will trigger the DMA interrupt at ~2KHz.
 // Putting 2 there will divide by 2 the interrupt frequency but will also
@@ -52,21 +19,79 @@ static union {
 		uint8_t begin[LED_PER_HALF * 24];
 		uint8_t end[LED_PER_HALF * 24];
 	}__attribute__((packed));
-} LedDMA;
+} LedDMA __attribute__((aligned(4)));
 
 cmdc0de::WS2818::WS2818(uint16_t ledPin, GPIO_TypeDef *ledPort, TIM_TypeDef *ledTimer,
 		DMA_Channel_TypeDef *ledDMAChannel, IRQn_Type irqt) :
 		TIM_TimeBaseStructure(),
 				TIM_OCInitStructure(), GPIO_InitStructure(), DMA_InitStructure(),
 				NVIC_InitStructure(), LedPin(ledPin), LedPort(ledPort), LedTimer(ledTimer),
-				LedDMAChannel(ledDMAChannel), Irqt(irqt), CurrentLed(0), TotalLeds(0), ColorLeds(0) {
-
+				LedDMAChannel(ledDMAChannel), Irqt(irqt), CurrentLed(0), TotalLeds(0), ColorLeds(0), Correction(),
+				Temperature(), Brightness(255), ChannelLUT(), LUTStale(true), EncodeCache(0), CacheLeds(0), CacheOwner(0),
+				CacheValid(false), CacheFrameValid(false), StaticFrame(0), StaticFrameSize(0), RefreshTimer(0),
+				RefreshIrq(TIM3_IRQn), Prepared(false) {
+	setColorCorrection(255, 255, 255);
+	setColorTemperature(UNCORRECTED);
 }
 
 cmdc0de::WS2818::~WS2818() {
 
 }
 
+static const uint8_t ColorTemperatures[cmdc0de::WS2818::TOTAL_COLOR_TEMPERATURES][3] = {
+		{ 255, 255, 255 },	// UNCORRECTED
+		{ 255, 147, 41 },	// CANDLE 1900K
+		{ 255, 214, 170 },	// TUNGSTEN_100W 2850K
+		{ 255, 241, 224 },	// HALOGEN 3200K
+		{ 255, 250, 244 },	// CARBON_ARC 5200K
+		{ 255, 255, 251 },	// HIGH_NOON_SUN 5400K
+		{ 201, 226, 255 },	// OVERCAST_SKY 7000K
+		{ 64, 156, 255 },	// CLEAR_BLUE_SKY 20000K
+};
+
+void cmdc0de::WS2818::setColorCorrection(uint8_t r, uint8_t g, uint8_t b) {
+	Correction[0] = r;
+	Correction[1] = g;
+	Correction[2] = b;
+	LUTStale = true;
+}
+
+void cmdc0de::WS2818::setColorTemperature(COLOR_TEMPERATURE ct) {
+	if (ct >= TOTAL_COLOR_TEMPERATURES)
+		ct = UNCORRECTED;
+	Temperature[0] = ColorTemperatures[ct][0];
+	Temperature[1] = ColorTemperatures[ct][1];
+	Temperature[2] = ColorTemperatures[ct][2];
+	LUTStale = true;
+}
+
+void cmdc0de::WS2818::setBrightness(uint8_t brightness) {
+	if (brightness != Brightness) {
+		Brightness = brightness;
+		LUTStale = true;
+	}
+}
+
+void cmdc0de::WS2818::setEncodeCache(uint8_t *cache, uint16_t numLeds) {
+	EncodeCache = cache;
+	CacheLeds = cache ? numLeds : 0;
+	CacheValid = false;
+}
+
+void cmdc0de::WS2818::updateChannelLUT() {
+	// everything in the cache was encoded with the old tables
+	CacheValid = false;
+	LUTStale = false;
+	for (int c = 0; c < 3; c++) {
+		uint32_t scale = ((uint32_t) Correction[c] * Temperature[c] * Brightness) / (255 * 255);
+		// (v * scale * 257) >> 16 is v * scale / 255 without a divide per entry
+		scale *= 257;
+		for (uint32_t v = 0; v < 256; v++) {
+			ChannelLUT[c][v] = (v * scale + 0x8000) >> 16;
+		}
+	}
+}
+
 static uint32_t findRemap(TIM_TypeDef *ledTimer) {
 	uint32_t retVal = 0;
 	if (ledTimer == TIM1) {
@@ -169,16 +194,46 @@ void cmdc0de::WS2818::init() {
 
 }
 
-void cmdc0de::WS2818::fillLed(uint8_t *buffer, uint8_t *color) {
+void cmdc0de::WS2818::fillLed(uint8_t *buffer, const uint8_t *color) {
 	int i;
+	uint8_t r = ChannelLUT[0][color[0]];
+	uint8_t g = ChannelLUT[1][color[1]];
+	uint8_t b = ChannelLUT[2][color[2]];
 	for (i = 0; i < 8; i++) { // GREEN data
-		buffer[i] = ((color[1] << i) & 0x80) ? 17 : 9;
+		buffer[i] = ((g << i) & 0x80) ? 17 : 9;
 	}
 	for (i = 0; i < 8; i++) { // RED
-		buffer[8 + i] = ((color[0] << i) & 0x80) ? 17 : 9;
+		buffer[8 + i] = ((r << i) & 0x80) ? 17 : 9;
 	}
 	for (i = 0; i < 8; i++) { // BLUE
-		buffer[16 + i] = ((color[2] << i) & 0x80) ? 17 : 9;
+		buffer[16 + i] = ((b << i) & 0x80) ? 17 : 9;
+	}
+}
+
+static inline void copyEncoded(uint8_t *dst, const uint8_t *src) {
+	uint32_t *d = reinterpret_cast<uint32_t *>(dst);
+	const uint32_t *s = reinterpret_cast<const uint32_t *>(src);
+	d[0] = s[0];
+	d[1] = s[1];
+	d[2] = s[2];
+	d[3] = s[3];
+	d[4] = s[4];
+	d[5] = s[5];
+}
+
+void cmdc0de::WS2818::encodeLed(uint8_t *buffer, uint16_t led) {
+	uint8_t scratch[3];
+	if (led < CacheLeds) {
+		uint8_t *cached = &EncodeCache[led * 24];
+		if (CacheFrameValid && !ColorLeds->isDirty(led)) {
+			copyEncoded(buffer, cached);
+		} else {
+			fillLed(buffer, ColorLeds->getColor(led, scratch));
+			copyEncoded(cached, buffer);
+			ColorLeds->clearDirty(led);
+		}
+	} else {
+		fillLed(buffer, ColorLeds->getColor(led, scratch));
 	}
 }
 
@@ -189,37 +244,61 @@ void delay(uint32_t ms) {
 //void cmdc0de::WS2818::sendColors(uint8_t (*color)[3], uint16_t len) {
 //void cmdc0de::WS2818::sendColors(LedBuffer *colorLeds, uint16_t len) {
 bool cmdc0de::WS2818::sendColors(LedBuffer *colorLeds, uint32_t timeOut) {
+	if (!prepareColors(colorLeds, timeOut))
+		return false;
+	fire();
+	return true;
+}
+
+bool cmdc0de::WS2818::prepareColors(LedBuffer *colorLeds, uint32_t timeOut) {
 	int i = 0;
 	if (colorLeds->getNumLeds() < 1)
 		return false;
 
-	if(ColorLeds!=0) {
+	if (StaticFrame != 0)
+		stopStaticFrame();
+
+	// a prepared frame that was never fired is simply replaced
+	if(ColorLeds!=0 && !Prepared) {
 		while(ColorLeds!=0 && timeOut--);
 		if(timeOut==0) return false;
 	}
 
+	// nothing is encoding from the tables now (a prepared frame only has its first buffer filled and is
+	// re-encoded below)
+	if (LUTStale)
+		updateChannelLUT();
+
 	// Set interrupt context ...
 	CurrentLed = 0;
 	TotalLeds = colorLeds->getNumLeds();
 	ColorLeds = colorLeds;
+	// the cache only holds good encodings if it was last filled from this buffer with the current tables,
+	// otherwise this frame re-encodes every led and refills it
+	CacheFrameValid = CacheValid && CacheOwner == colorLeds;
+	CacheOwner = colorLeds;
+	CacheValid = true;
 
 	for (i = 0; (i < LED_PER_HALF) && (CurrentLed < TotalLeds + 2); i++, CurrentLed++) {
 		if (CurrentLed < TotalLeds)
-			fillLed(LedDMA.begin + (24 * i), ColorLeds->getLed(CurrentLed));
+			encodeLed(LedDMA.begin + (24 * i), CurrentLed);
 		else
 			bzero(LedDMA.begin + (24 * i), 24);
 	}
 
 	for (i = 0; (i < LED_PER_HALF) && (CurrentLed < TotalLeds + 2); i++, CurrentLed++) {
 		if (CurrentLed < TotalLeds)
-			fillLed(LedDMA.end + (24 * i), ColorLeds->getLed(CurrentLed));
+			encodeLed(LedDMA.end + (24 * i), CurrentLed);
 		else
 			bzero(LedDMA.end + (24 * i), 24);
 	}
 
+	// the channel only moves on timer compare events, nothing goes out until fire
+	DMA_Cmd(LedDMAChannel, DISABLE);
 	LedDMAChannel->CNDTR = sizeof(LedDMA.buffer); // load number of bytes to be transferred
 	DMA_Cmd(LedDMAChannel, ENABLE); 			// enable DMA channel 2
-	TIM_Cmd(LedTimer, ENABLE);                      // Go!!!
+	Prepared = true;
+	return true;
 }
 
 void cmdc0de::WS2818::handleISR() {
@@ -243,7 +322,7 @@ void cmdc0de::WS2818::handleISR() {
 
 	for (i = 0; (i < LED_PER_HALF) && (CurrentLed < TotalLeds + 2); i++, CurrentLed++) {
 		if (CurrentLed < TotalLeds)
-			fillLed(buffer + (24 * i), ColorLeds->getLed(CurrentLed));
+			encodeLed(buffer + (24 * i), CurrentLed);
 		else
 			bzero(buffer + (24 * i), 24);
 	}
@@ -256,3 +335,105 @@ void cmdc0de::WS2818::handleISR() {
 	}
 }
 
+
+void cmdc0de::WS2818::setRefreshTimer(TIM_TypeDef *timer, IRQn_Type irq) {
+	RefreshTimer = timer;
+	RefreshIrq = irq;
+}
+
+bool cmdc0de::WS2818::startStaticFrame(LedBuffer *colorLeds, uint8_t *frame, uint32_t frameSize, uint16_t refreshHz,
+		uint32_t timeOut) {
+	uint8_t scratch[3];
+	uint32_t ledBytes = colorLeds->getNumLeds() * 24;
+	TIM_TimeBaseInitTypeDef refresh;
+
+	if (colorLeds->getNumLeds() < 1 || frameSize < staticFrameSize(colorLeds->getNumLeds()) || RefreshTimer == 0
+			|| refreshHz == 0 || 1000000 / refreshHz < colorLeds->getNumLeds() * 30 + RESET_US)
+		return false;
+
+	if (StaticFrame != 0)
+		stopStaticFrame();
+
+	if (ColorLeds != 0) {
+		while (ColorLeds != 0 && timeOut)
+			--timeOut;
+		if (ColorLeds != 0)
+			return false;
+	}
+
+	if (LUTStale)
+		updateChannelLUT();
+
+	for (uint16_t i = 0; i < colorLeds->getNumLeds(); i++) {
+		fillLed(frame + (24 * i), colorLeds->getColor(i, scratch));
+	}
+	bzero(frame + ledBytes, STATIC_TAIL_BYTES);
+
+	StaticFrame = frame;
+	StaticFrameSize = ledBytes + STATIC_TAIL_BYTES;
+
+	// one pass over the frame per refresh, the timer keeps running at CCR 0 (line low) in between
+	DMA_Cmd(LedDMAChannel, DISABLE);
+	DMA_ITConfig(LedDMAChannel, DMA_IT_TC | DMA_IT_HT, DISABLE);
+	LedDMAChannel->CCR &= ~DMA_CCR1_CIRC;
+	LedDMAChannel->CMAR = (uint32_t) frame;
+	LedDMAChannel->CNDTR = StaticFrameSize;
+	DMA_Cmd(LedDMAChannel, ENABLE);
+	TIM_Cmd(LedTimer, ENABLE);
+
+	// 10kHz tick, assumes 72 MHz timer clock
+	if (RefreshTimer == TIM2)
+		RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM2, ENABLE);
+	else if (RefreshTimer == TIM3)
+		RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM3, ENABLE);
+	else
+		RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM4, ENABLE);
+	TIM_TimeBaseStructInit(&refresh);
+	refresh.TIM_Prescaler = 7200 - 1;
+	refresh.TIM_Period = 10000 / refreshHz - 1;
+	TIM_TimeBaseInit(RefreshTimer, &refresh);
+	TIM_ClearITPendingBit(RefreshTimer, TIM_IT_Update);
+	TIM_ITConfig(RefreshTimer, TIM_IT_Update, ENABLE);
+	NVIC_InitStructure.NVIC_IRQChannel = RefreshIrq;
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 9;
+	NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_Init(&NVIC_InitStructure);
+	TIM_Cmd(RefreshTimer, ENABLE);
+	return true;
+}
+
+void cmdc0de::WS2818::handleRefreshISR() {
+	if (TIM_GetITStatus(RefreshTimer, TIM_IT_Update) == RESET)
+		return;
+	TIM_ClearITPendingBit(RefreshTimer, TIM_IT_Update);
+	// the previous pass is over (the period is checked to leave room for it), send the frame again
+	if (StaticFrame != 0 && LedDMAChannel->CNDTR == 0) {
+		DMA_Cmd(LedDMAChannel, DISABLE);
+		LedDMAChannel->CNDTR = StaticFrameSize;
+		DMA_Cmd(LedDMAChannel, ENABLE);
+	}
+}
+
+void cmdc0de::WS2818::stopStaticFrame() {
+	if (StaticFrame == 0)
+		return;
+
+	TIM_Cmd(RefreshTimer, DISABLE);
+	TIM_ITConfig(RefreshTimer, TIM_IT_Update, DISABLE);
+	// let a pass that is under way finish so the strand latches a whole frame
+	while (LedDMAChannel->CNDTR != 0)
+		;
+
+	TIM_Cmd(LedTimer, DISABLE);
+	DMA_Cmd(LedDMAChannel, DISABLE);
+
+	// back to the refill buffer driven by handleISR
+	LedDMAChannel->CCR |= DMA_CCR1_CIRC;
+	LedDMAChannel->CMAR = (uint32_t) LedDMA.buffer;
+	LedDMAChannel->CNDTR = sizeof(LedDMA.buffer);
+	DMA_ClearITPendingBit(DMA1_IT_HT2 | DMA1_IT_TC2);
+	DMA_ITConfig(LedDMAChannel, DMA_IT_TC | DMA_IT_HT, ENABLE);
+	StaticFrame = 0;
+	StaticFrameSize = 0;
+}
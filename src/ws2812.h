@@ -3,77 +3,10 @@
 
 //#include <stdint.h>
 #include "stm32f10x_conf.h"
+#include "ledbuffer.h"
 
 namespace cmdc0de {
 
-class RGB {
-public:
-	static RGB WHITE;
-	static RGB BLACK;
-	static RGB RED;
-	static RGB GREEN;
-	static RGB BLUE;
-	public:
-	RGB();
-	RGB(uint8_t r, uint8_t g, uint8_t b);
-	~RGB();
-	const uint8_t *getArray() const;
-	uint8_t getR() const {
-		return Clr[0];
-	}
-	uint8_t getG() const {
-		return Clr[1];
-	}
-	uint8_t getB() const {
-		return Clr[2];
-	}
-public:
-	static RGB createRandomColor();
-	private:
-	uint8_t Clr[3];
-};
-
-class LedBuffer {
-public:
-	LedBuffer(uint8_t *ledColorBuffer, uint32_t NUM_LEDS) :
-			LedData(ledColorBuffer), NumLeds(NUM_LEDS) {
-	}
-	~LedBuffer() {
-	}
-	uint8_t *getLeds() {return LedData;}
-	uint8_t *getLed(uint16_t led) {return &LedData[led*3];}
-	uint16_t getNumLeds() {return NumLeds;}
-private:
-	uint8_t *LedData;
-	uint16_t NumLeds;
-};
-
-template<typename T, uint8_t D>
-class Stack {
-public:
-	Stack() : StackMem(), InsertionPos(0) {}
-	~Stack() {}
-	bool push(T &v) {
-		bool bRetVal = false;
-		if(InsertionPos==(D)) {
-			return false;
-		}
-		StackMem[InsertionPos]=v;
-		InsertionPos++;
-		return true;
-	}
-	T &pop() {
-		if(InsertionPos==0) {
-			return 0;
-		} else {
-			return StackMem[--InsertionPos];
-		}
-	}
-protected:
-	T StackMem[D];
-	uint8_t InsertionPos;
-};
-
 /*
  * @author cmdc0de
  * @ date: 6/25/17
@@ -83,18 +16,82 @@ protected:
  * 	LED_PER_DMA_BUFFER if this is set it will be used to set the DMA buffer size
  * 	Otherwise the DMA buffer size will be set large enough for 2 LEDs
  * 		Remember that's not the total number of LEDS you can have just the number that is buffered.
+ *
+ * 	setEncodeCache gives the strand 24 bytes per led to keep the encoded bit stream of each led. Together
+ * 	with a dirty map on the LedBuffer the ISR then copies the cached encoding for leds that did not change
+ * 	and only runs fillLed for the dirty ones. Changing brightness/correction or sending a different
+ * 	buffer re-encodes everything once.
+ *
+ * 	startStaticFrame encodes a whole frame once into a caller supplied buffer and lets the DMA send it
+ * 	again on every update of a refresh timer (setRefreshTimer, e.g. TIM3), with the half/full interrupts
+ * 	off. Refreshing the strand (to recover from glitches) costs one short interrupt per refresh and the
+ * 	core can sit in __WFI in between. The line stays low from the end of the frame to the next refresh,
+ * 	which is the reset gap.
  */
 class WS2818 {
+public:
+	//channel scale factors (R,G,B) for common white points, 255 means no correction
+	enum COLOR_TEMPERATURE {
+		UNCORRECTED = 0,
+		CANDLE,
+		TUNGSTEN_100W,
+		HALOGEN,
+		CARBON_ARC,
+		HIGH_NOON_SUN,
+		OVERCAST_SKY,
+		CLEAR_BLUE_SKY,
+		TOTAL_COLOR_TEMPERATURES
+	};
 public:
 	WS2818(uint16_t LedPin, GPIO_TypeDef *ledPort, TIM_TypeDef *ledTimer, DMA_Channel_TypeDef *ledDMAChannel,
 			IRQn_Type irqt);
 	void init();
 	//void sendColors(uint8_t (*color)[3], uint16_t len);
 	bool sendColors(LedBuffer *ColorLeds, uint32_t timeOut);
+	//sendColors in two steps for starting several strands (or boards) together: prepareColors encodes the
+	//first DMA buffer and loads the channel, fire only starts the timer so it is safe and quick from an interrupt
+	bool prepareColors(LedBuffer *colorLeds, uint32_t timeOut);
+	void fire() {
+		Prepared = false;
+		LedTimer->CR1 |= TIM_CR1_CEN;
+	}
+	bool isPrepared() const {return Prepared;}
 	~WS2818();
 	void handleISR();
+	//per channel scale factors for the strand (255 = no change) used to even out white points between LED batches
+	//these and the brightness are folded into the channel tables, which are only rebuilt by the next
+	//prepareColors/startStaticFrame once the strand is idle, so a frame is never encoded with a mix of two tables
+	void setColorCorrection(uint8_t r, uint8_t g, uint8_t b);
+	void setColorTemperature(COLOR_TEMPERATURE ct);
+	//global brightness, the tables are only marked for a rebuild when the value changes
+	void setBrightness(uint8_t brightness);
+	uint8_t getBrightness() const {return Brightness;}
+	//cache must be 4 byte aligned and hold 24 bytes per led, leds past numLeds are always encoded
+	void setEncodeCache(uint8_t *cache, uint16_t numLeds);
+	//smallest buffer startStaticFrame accepts for numLeds
+	static constexpr uint32_t staticFrameSize(uint16_t numLeds) {
+		return numLeds * 24 + STATIC_TAIL_BYTES;
+	}
+	//general purpose timer (TIM2-4) startStaticFrame uses, the owner calls handleRefreshISR from its interrupt
+	void setRefreshTimer(TIM_TypeDef *timer, IRQn_Type irq);
+	//false without a refresh timer or if refreshHz leaves no reset gap after the frame
+	bool startStaticFrame(LedBuffer *colorLeds, uint8_t *frame, uint32_t frameSize, uint16_t refreshHz,
+			uint32_t timeOut);
+	void handleRefreshISR();
+	//waits for the frame being sent to finish so the strand is left latched, sendColors calls this itself
+	void stopStaticFrame();
+	bool isStaticFrame() const {return StaticFrame!=0;}
+	//true while a frame is still being clocked out of the buffer passed to sendColors (or is prepared)
+	bool isBusy() const {return ColorLeds!=0;}
+protected:
+	//low CCR values after the last led so the line stays low once the DMA is done
+	static const uint16_t STATIC_TAIL_BYTES = 2;
+	//longer than the reset time of every WS281x variant, one led takes 30us
+	static const uint16_t RESET_US = 300;
 protected:
-	void fillLed(uint8_t *buffer, uint8_t *color);
+	void updateChannelLUT();
+	void fillLed(uint8_t *buffer, const uint8_t *color);
+	void encodeLed(uint8_t *buffer, uint16_t led);
 private:
 	TIM_TimeBaseInitTypeDef TIM_TimeBaseStructure;
 	TIM_OCInitTypeDef TIM_OCInitStructure;
@@ -108,7 +105,25 @@ private:
 	IRQn_Type Irqt;
 	int CurrentLed;
 	int TotalLeds;
-	LedBuffer *ColorLeds;
+	//cleared by the ISR when the frame is done
+	LedBuffer * volatile ColorLeds;
+	uint8_t Correction[3];
+	uint8_t Temperature[3];
+	uint8_t Brightness;
+	//color correction is folded into these tables (R,G,B) so fillLed pays one lookup per channel
+	uint8_t ChannelLUT[3][256];
+	//correction, temperature or brightness changed since ChannelLUT was built
+	bool LUTStale;
+	uint8_t *EncodeCache;
+	uint16_t CacheLeds;
+	LedBuffer *CacheOwner;
+	bool CacheValid;
+	bool CacheFrameValid;
+	uint8_t *StaticFrame;
+	uint32_t StaticFrameSize;
+	TIM_TypeDef *RefreshTimer;
+	IRQn_Type RefreshIrq;
+	volatile bool Prepared;
 };
 
 } //cmdc0de
@@ -0,0 +1,150 @@
+//
+// Packs recorded animations into the format AnimationPlayer (src/animation.h) plays from flash.
+//
+// Input is raw frames, numLeds * R,G,B bytes each, back to back ("-" reads stdin).
+// Every frame is stored as whichever of raw, RLE or delta against the previous frame is smallest,
+// key frames (raw or RLE only) are forced every -k frames (0 = only the first).
+// The result is decoded again with AnimationPlayer and compared before it is written.
+//
+// build: g++ -O2 -I../src -o animpack animpack.cpp ../src/animation.cpp ../src/ledbuffer.cpp ../src/framecodec.cpp
+// usage: animpack -n leds [-f frameMS] [-k keyInterval] [-c symbol] input.rgb output
+// 	-c writes C source defining const uint8_t symbol[] instead of a binary blob
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include <string>
+#include "animation.h"
+#include "framecodec.h"
+
+using cmdc0de::AnimationPlayer;
+using cmdc0de::FrameEncoder;
+using cmdc0de::LedBuffer;
+
+typedef std::vector<uint8_t> Bytes;
+
+static void put16(Bytes &out, uint16_t v) {
+	out.push_back(v & 0xFF);
+	out.push_back(v >> 8);
+}
+
+static bool verify(const Bytes &packed, const std::vector<Bytes> &frames, uint16_t numLeds) {
+	AnimationPlayer player;
+	Bytes pixels(numLeds * 3);
+	LedBuffer leds(&pixels[0], numLeds);
+	if (!player.load(&packed[0], packed.size()))
+		return false;
+	for (size_t f = 0; f < frames.size(); f++) {
+		if (!player.decodeNext(&leds) || memcmp(&pixels[0], &frames[f][0], pixels.size()) != 0) {
+			fprintf(stderr, "frame %zu does not decode back to the input\n", f);
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool writeBinary(const char *path, const Bytes &packed) {
+	FILE *f = fopen(path, "wb");
+	if (!f)
+		return false;
+	bool ok = fwrite(&packed[0], 1, packed.size(), f) == packed.size();
+	return fclose(f) == 0 && ok;
+}
+
+static bool writeSource(const char *path, const char *symbol, const Bytes &packed) {
+	FILE *f = fopen(path, "w");
+	if (!f)
+		return false;
+	fprintf(f, "// generated by tools/animpack, do not edit\n#include <stdint.h>\n\n");
+	fprintf(f, "extern const uint8_t %s[];\nextern const uint32_t %s_size;\n\n", symbol, symbol);
+	fprintf(f, "const uint32_t %s_size = %zu;\n", symbol, packed.size());
+	fprintf(f, "const uint8_t %s[] = {", symbol);
+	for (size_t i = 0; i < packed.size(); i++) {
+		fprintf(f, "%s0x%02x,", (i % 16) ? " " : "\n\t\t", packed[i]);
+	}
+	fprintf(f, "\n};\n");
+	return fclose(f) == 0;
+}
+
+static void usage() {
+	fprintf(stderr, "usage: animpack -n leds [-f frameMS] [-k keyInterval] [-c symbol] input.rgb output\n");
+	exit(2);
+}
+
+int main(int argc, char *argv[]) {
+	int numLeds = 0, frameMS = 33, keyInterval = 0, opt;
+	const char *symbol = 0;
+
+	while ((opt = getopt(argc, argv, "n:f:k:c:")) != -1) {
+		switch (opt) {
+		case 'n':
+			numLeds = atoi(optarg);
+			break;
+		case 'f':
+			frameMS = atoi(optarg);
+			break;
+		case 'k':
+			keyInterval = atoi(optarg);
+			break;
+		case 'c':
+			symbol = optarg;
+			break;
+		default:
+			usage();
+		}
+	}
+	if (argc - optind != 2 || numLeds < 1 || numLeds > 0xFFFF || frameMS < 1 || frameMS > 0xFFFF)
+		usage();
+
+	FILE *in = strcmp(argv[optind], "-") == 0 ? stdin : fopen(argv[optind], "rb");
+	if (!in) {
+		perror(argv[optind]);
+		return 1;
+	}
+	std::vector<Bytes> frames;
+	Bytes frame(numLeds * 3);
+	while (fread(&frame[0], 1, frame.size(), in) == frame.size() && frames.size() < 0xFFFF)
+		frames.push_back(frame);
+	if (frames.empty()) {
+		fprintf(stderr, "no complete frames in %s\n", argv[optind]);
+		return 1;
+	}
+
+	Bytes packed;
+	packed.push_back('L');
+	packed.push_back('E');
+	packed.push_back('D');
+	packed.push_back('A');
+	put16(packed, numLeds);
+	put16(packed, frames.size());
+	put16(packed, frameMS);
+	put16(packed, 0);
+	size_t counts[4] = { 0, 0, 0, 0 };
+	for (size_t f = 0; f < frames.size(); f++) {
+		bool key = f == 0 || (keyInterval > 0 && (f % keyInterval) == 0);
+		// the FrameDecoder formats are the AnimationPlayer frame types
+		uint8_t format;
+		size_t at = packed.size();
+		packed.resize(at + 1 + numLeds * 3);
+		uint32_t len = FrameEncoder::smallest(key ? 0 : &frames[f - 1][0], &frames[f][0], numLeds, &packed[at + 1],
+				numLeds * 3, format);
+		packed[at] = format;
+		packed.resize(at + 1 + len);
+		counts[format]++;
+	}
+
+	if (!verify(packed, frames, numLeds))
+		return 1;
+	if (!(symbol ? writeSource(argv[optind + 1], symbol, packed) : writeBinary(argv[optind + 1], packed))) {
+		perror(argv[optind + 1]);
+		return 1;
+	}
+	size_t raw = frames.size() * numLeds * 3;
+	printf("%zu frames (%zu raw, %zu rle, %zu delta) %zu -> %zu bytes (%.1f%%)\n", frames.size(),
+			counts[AnimationPlayer::FRAME_RAW], counts[AnimationPlayer::FRAME_RLE],
+			counts[AnimationPlayer::FRAME_DELTA], raw, packed.size(), (100.0 * packed.size()) / raw);
+	return 0;
+}
@@ -0,0 +1,314 @@
+//
+// Linux side of the CAN pixel distribution (src/cancodec.h) over SocketCAN, e.g. a virtual bus:
+// 	modprobe vcan; ip link add dev vcan0 type vcan; ip link set up vcan0
+// or a USB adapter (ip link set can0 up type can bitrate 1000000) on the same bus as the boards.
+//
+// build: g++ -O2 -I../src -o canleds canleds.cpp ../src/cancodec.cpp ../src/ledbuffer.cpp
+// usage: canleds send [-i if] [-n leds] [-N nodes]   raw R,G,B frames of nodes * leds on stdin, node k gets
+//                                                    the k-th slice, each frame ends with the broadcast latch
+//        canleds node [-i if] [-n leds] [-d node]    acts as a node (same id filter as the boards), writes every
+//                                                    complete frame to stdout, counters on stderr
+//        canleds selftest [-i if]                    codec checks on a mock bus, plus a run over the interface
+//                                                    if it exists, exit 1 on failure
+// e.g. canleds node -d 2 > node2.rgb &  ledgen | canleds send -N 2
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <vector>
+#include "cancodec.h"
+
+using cmdc0de::CanMessage;
+using cmdc0de::CanSegmenter;
+using cmdc0de::CanReassembler;
+using cmdc0de::LedBuffer;
+namespace canproto = cmdc0de::canproto;
+
+typedef std::vector<uint8_t> Bytes;
+
+// node < 0 receives everything
+static int openBus(const char *ifname, int node) {
+	int s = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+	struct ifreq ifr;
+	struct sockaddr_can addr;
+	if (s < 0)
+		return -1;
+	memset(&ifr, 0, sizeof(ifr));
+	strncpy(ifr.ifr_name, ifname, IFNAMSIZ - 1);
+	if (ioctl(s, SIOCGIFINDEX, &ifr) < 0) {
+		close(s);
+		return -1;
+	}
+	if (node >= 0) {
+		// the filter pair the boards load into their bxCAN filter banks
+		struct can_filter filters[2];
+		filters[0].can_id = canproto::nodeFilter(node) | CAN_EFF_FLAG;
+		filters[0].can_mask = canproto::NODE_MASK | CAN_EFF_FLAG;
+		filters[1].can_id = canproto::nodeFilter(canproto::BROADCAST) | CAN_EFF_FLAG;
+		filters[1].can_mask = canproto::NODE_MASK | CAN_EFF_FLAG;
+		setsockopt(s, SOL_CAN_RAW, CAN_RAW_FILTER, filters, sizeof(filters));
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.can_family = AF_CAN;
+	addr.can_ifindex = ifr.ifr_ifindex;
+	if (bind(s, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+		close(s);
+		return -1;
+	}
+	return s;
+}
+
+static bool busWrite(int s, const CanMessage &m) {
+	struct can_frame f;
+	memset(&f, 0, sizeof(f));
+	f.can_id = m.Id | CAN_EFF_FLAG;
+	f.can_dlc = m.Length;
+	memcpy(f.data, m.Data, m.Length);
+	while (write(s, &f, sizeof(f)) != sizeof(f)) {
+		// a real adapter's queue fills up faster than the bus drains it
+		if (errno != ENOBUFS && errno != EAGAIN)
+			return false;
+		usleep(200);
+	}
+	return true;
+}
+
+static bool busRead(int s, CanMessage &m) {
+	struct can_frame f;
+	while (read(s, &f, sizeof(f)) == sizeof(f)) {
+		if (!(f.can_id & CAN_EFF_FLAG) || (f.can_id & CAN_RTR_FLAG))
+			continue;
+		m.Id = f.can_id & CAN_EFF_MASK;
+		m.Length = f.can_dlc > 8 ? 8 : f.can_dlc;
+		memcpy(m.Data, f.data, m.Length);
+		return true;
+	}
+	return false;
+}
+
+static std::vector<CanSegmenter::Slice> sliceNodes(int numLeds, int nodes) {
+	std::vector<CanSegmenter::Slice> slices;
+	for (int k = 0; k < nodes; k++) {
+		CanSegmenter::Slice slice = { (uint8_t) (k + 1), (uint16_t) (k * numLeds), (uint16_t) numLeds };
+		slices.push_back(slice);
+	}
+	return slices;
+}
+
+static int send(const char *ifname, int numLeds, int nodes) {
+	int s = openBus(ifname, -1);
+	if (s < 0) {
+		perror(ifname);
+		return 1;
+	}
+	std::vector<CanSegmenter::Slice> slices = sliceNodes(numLeds, nodes);
+	CanSegmenter segmenter(&slices[0], slices.size());
+	Bytes pixels(numLeds * nodes * 3);
+	LedBuffer leds(&pixels[0], numLeds * nodes);
+	CanMessage m;
+	uint32_t frames = 0;
+	while (fread(&pixels[0], 1, pixels.size(), stdin) == pixels.size()) {
+		segmenter.start(&leds, frames++);
+		while (segmenter.next(m)) {
+			if (!busWrite(s, m)) {
+				perror(ifname);
+				return 1;
+			}
+		}
+	}
+	fprintf(stderr, "%u frames, %u messages each\n", frames, segmenter.messagesPerFrame());
+	return 0;
+}
+
+static int node(const char *ifname, int numLeds, int id) {
+	int s = openBus(ifname, id);
+	if (s < 0) {
+		perror(ifname);
+		return 1;
+	}
+	CanReassembler reassembler(id);
+	Bytes pixels(numLeds * 3);
+	LedBuffer leds(&pixels[0], numLeds);
+	CanMessage m;
+	while (busRead(s, m)) {
+		CanReassembler::RESULT r = reassembler.receive(m, &leds);
+		if (r == CanReassembler::FRAME) {
+			if (fwrite(&pixels[0], 1, pixels.size(), stdout) != pixels.size() || fflush(stdout) != 0)
+				return 1;
+		} else if (r == CanReassembler::INCOMPLETE) {
+			fprintf(stderr, "frame %u incomplete, %u dropped so far\n", reassembler.getLastFrame(),
+					reassembler.getIncomplete());
+		}
+	}
+	return 0;
+}
+
+// ---- self test ----
+
+static int Failures = 0;
+
+static void expect(bool ok, const char *what) {
+	printf("%-52s %s\n", what, ok ? "ok" : "FAIL");
+	if (!ok)
+		Failures++;
+}
+
+// what the hardware filter of a node lets through
+static bool passes(const CanMessage &m, uint8_t node) {
+	uint32_t n = m.Id & canproto::NODE_MASK;
+	return n == canproto::nodeFilter(node) || n == canproto::nodeFilter(canproto::BROADCAST);
+}
+
+static int selftest(const char *ifname) {
+	const int numLeds = 50, nodes = 3;
+	std::vector<CanSegmenter::Slice> slices = sliceNodes(numLeds, nodes);
+	CanSegmenter segmenter(&slices[0], slices.size());
+	Bytes frame(numLeds * nodes * 3);
+	LedBuffer leds(&frame[0], numLeds * nodes);
+	for (size_t i = 0; i < frame.size(); i++)
+		frame[i] = i * 13 + 5;
+
+	// mock bus: every message goes to every node through its filter
+	std::vector<CanMessage> bus;
+	CanMessage m;
+	segmenter.start(&leds, 7);
+	while (segmenter.next(m))
+		bus.push_back(m);
+	bool ok = bus.size() == segmenter.messagesPerFrame() && bus.back().Id == canproto::makeId(canproto::LATCH,
+			canproto::BROADCAST, 7);
+	for (size_t i = 0; i < bus.size(); i++)
+		ok &= (bus[i].Id & ~0x1FFFFFFFu) == 0 && bus[i].Length <= 8;
+	expect(ok, "segmenter: 29 bit ids, latch last");
+
+	ok = true;
+	size_t filtered = 0;
+	for (int k = 0; k < nodes; k++) {
+		CanReassembler node(k + 1);
+		Bytes pixels(numLeds * 3, 0);
+		LedBuffer out(&pixels[0], numLeds);
+		CanReassembler::RESULT last = CanReassembler::IGNORED;
+		for (size_t i = 0; i < bus.size(); i++) {
+			if (!passes(bus[i], k + 1)) {
+				filtered++;
+				continue;
+			}
+			last = node.receive(bus[i], &out);
+		}
+		ok &= last == CanReassembler::FRAME && node.getLastFrame() == 7
+				&& memcmp(&pixels[0], &frame[k * numLeds * 3], pixels.size()) == 0;
+	}
+	expect(ok && filtered == (bus.size() - 1) * (nodes - 1), "every node reassembles its slice, filter drops rest");
+
+	// a lost message drops the frame, the next one is fine again
+	CanReassembler node(2);
+	Bytes pixels(numLeds * 3, 0);
+	LedBuffer out(&pixels[0], numLeds);
+	CanReassembler::RESULT last = CanReassembler::IGNORED;
+	bool droppedOne = false;
+	for (size_t i = 0; i < bus.size(); i++) {
+		if (!droppedOne && canproto::getNode(bus[i].Id) == 2 && canproto::getOffset(bus[i].Id) == 64) {
+			droppedOne = true;
+			continue;
+		}
+		last = node.receive(bus[i], &out);
+	}
+	ok = last == CanReassembler::INCOMPLETE && node.getIncomplete() == 1;
+	for (size_t i = 0; i < bus.size(); i++)
+		last = node.receive(bus[i], &out);
+	ok &= last == CanReassembler::FRAME && node.getFrames() == 1;
+	expect(ok, "missing message drops the frame");
+
+	// a node with fewer leds than its slice ignores the rest, one with more never completes
+	Bytes few(10 * 3);
+	LedBuffer fewLeds(&few[0], 10);
+	CanReassembler small(1);
+	for (size_t i = 0; i < bus.size(); i++)
+		last = small.receive(bus[i], &fewLeds);
+	ok = last == CanReassembler::FRAME && memcmp(&few[0], &frame[0], few.size()) == 0;
+	Bytes many(numLeds * 2 * 3);
+	LedBuffer manyLeds(&many[0], numLeds * 2);
+	CanReassembler big(1);
+	for (size_t i = 0; i < bus.size(); i++)
+		last = big.receive(bus[i], &manyLeds);
+	ok &= last == CanReassembler::INCOMPLETE;
+	expect(ok, "slice longer/shorter than the node buffer");
+
+	// the same through SocketCAN, if the interface is there
+	int tx = openBus(ifname, -1), rx = openBus(ifname, 3), other = openBus(ifname, 9);
+	if (tx < 0 || rx < 0 || other < 0) {
+		printf("%-52s skipped (no %s)\n", "round trip over SocketCAN", ifname);
+	} else {
+		struct timeval tv = { 1, 0 };
+		setsockopt(rx, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+		tv.tv_sec = 0;
+		tv.tv_usec = 200000;
+		setsockopt(other, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+		ok = true;
+		for (size_t i = 0; i < bus.size(); i++)
+			ok &= busWrite(tx, bus[i]);
+		CanReassembler node3(3);
+		std::fill(pixels.begin(), pixels.end(), 0);
+		last = CanReassembler::IGNORED;
+		while (last != CanReassembler::FRAME && busRead(rx, m))
+			last = node3.receive(m, &out);
+		ok &= last == CanReassembler::FRAME && memcmp(&pixels[0], &frame[2 * numLeds * 3], pixels.size()) == 0;
+		// node 9 is on no slice, its kernel filter only passes the latch
+		int seen = 0;
+		while (busRead(other, m))
+			seen++;
+		expect(ok && seen == 1, "round trip over SocketCAN with kernel filters");
+	}
+
+	printf("%s\n", Failures ? "FAILED" : "all passed");
+	return Failures ? 1 : 0;
+}
+
+static void usage() {
+	fprintf(stderr, "usage: canleds send [-i if] [-n leds] [-N nodes] | node [-i if] [-n leds] [-d node] | selftest [-i if]\n");
+	exit(2);
+}
+
+int main(int argc, char *argv[]) {
+	const char *ifname = "vcan0";
+	int numLeds = 64, nodes = 1, id = 1, opt;
+	if (argc < 2)
+		usage();
+	optind = 2;
+	while ((opt = getopt(argc, argv, "i:n:N:d:")) != -1) {
+		switch (opt) {
+		case 'i':
+			ifname = optarg;
+			break;
+		case 'n':
+			numLeds = atoi(optarg);
+			break;
+		case 'N':
+			nodes = atoi(optarg);
+			break;
+		case 'd':
+			id = atoi(optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+	if (numLeds < 1 || numLeds * 3 > CanReassembler::MAX_MESSAGES * 8 || nodes < 1 || nodes > 254 || id < 0
+			|| id >= canproto::BROADCAST || (long) numLeds * nodes > 0xFFFF)
+		usage();
+	if (strcmp(argv[1], "send") == 0)
+		return send(ifname, numLeds, nodes);
+	if (strcmp(argv[1], "node") == 0)
+		return node(ifname, numLeds, id);
+	if (strcmp(argv[1], "selftest") == 0)
+		return selftest(ifname);
+	usage();
+	return 2;
+}
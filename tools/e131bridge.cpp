@@ -0,0 +1,530 @@
+//
+// Bridges E1.31 (sACN) and Art-Net from lighting software to a board running the binary protocol
+// (src/protocol.h, WS2812_PROTOCOL build) over a serial port.
+//
+// Datagrams are parsed in place by LightingPacketParser (src/lightnet.h), -n leds are taken from consecutive
+// universes starting at -u, 170 leds (510 channels) each, Art-Net uses the same numbers as port addresses.
+// Every complete frame goes out as whichever of FRAME, FRAME_RLE or FRAME_DELTA is smallest, with a key frame
+// every -k frames. Counters are printed to stderr once a second.
+//
+// build: g++ -O2 -I../src -o e131bridge e131bridge.cpp ../src/lightnet.cpp ../src/universe.cpp ../src/protocol.cpp ../src/framecodec.cpp
+// 	../src/ledbuffer.cpp
+// usage: e131bridge [-n leds] [-u universe] [-o order] [-k N] [-b baud] device|-
+// 	-o is one of rgb rbg grb gbr brg bgr (channel order the software sends), - writes the packets to stdout
+//        e131bridge send [-n leds] [-u universe] [-r fps] [-a] [-s] [host]
+// 	test sender, a moving rainbow to host (default 127.0.0.1) as E1.31 or with -a Art-Net, -s adds sync packets
+//        e131bridge selftest
+// 	parser checks plus a round trip through a local UDP socket, exit 1 on failure
+// e.g. e131bridge -n 64 - | ledproto decode    and in another terminal    e131bridge send -n 64
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <vector>
+#include "lightnet.h"
+#include "protocol.h"
+#include "framecodec.h"
+
+using cmdc0de::LightingPacketParser;
+using cmdc0de::UniverseMapper;
+using cmdc0de::LedBuffer;
+using cmdc0de::SoftCrc32;
+using cmdc0de::PacketWriter;
+using cmdc0de::FrameDecoder;
+using cmdc0de::FrameEncoder;
+namespace protocol = cmdc0de::protocol;
+
+typedef std::vector<uint8_t> Bytes;
+
+static const uint16_t LEDS_PER_UNIVERSE = 170;
+
+static uint32_t millis() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// consecutive universes from first, LEDS_PER_UNIVERSE each
+static std::vector<UniverseMapper::Mapping> mapLeds(int numLeds, int first, UniverseMapper::ORDER order) {
+	std::vector<UniverseMapper::Mapping> map;
+	for (int led = 0; led < numLeds; led += LEDS_PER_UNIVERSE) {
+		UniverseMapper::Mapping m;
+		m.Universe = first + led / LEDS_PER_UNIVERSE;
+		m.StartAddress = 1;
+		m.FirstLed = led;
+		m.NumLeds = numLeds - led < LEDS_PER_UNIVERSE ? numLeds - led : LEDS_PER_UNIVERSE;
+		m.Order = order;
+		map.push_back(m);
+	}
+	return map;
+}
+
+static int udpSocket(uint16_t port) {
+	int s = socket(AF_INET, SOCK_DGRAM, 0);
+	int on = 1;
+	struct sockaddr_in addr;
+	if (s < 0)
+		return -1;
+	setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	if (bind(s, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+		close(s);
+		return -1;
+	}
+	return s;
+}
+
+// E1.31 universes are also multicast to 239.255.hi.lo, joining is best effort (no route on a bare loopback)
+static void joinUniverse(int s, uint16_t universe) {
+	struct ip_mreq mreq;
+	mreq.imr_multiaddr.s_addr = htonl(0xEFFF0000 | universe);
+	mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+	setsockopt(s, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq));
+}
+
+static speed_t baudConstant(int baud) {
+	switch (baud) {
+	case 115200:
+		return B115200;
+	case 230400:
+		return B230400;
+	case 460800:
+		return B460800;
+	case 500000:
+		return B500000;
+	case 921600:
+		return B921600;
+	case 1000000:
+		return B1000000;
+	case 2000000:
+		return B2000000;
+	default:
+		return 0;
+	}
+}
+
+static int openSerial(const char *path, int baud) {
+	if (strcmp(path, "-") == 0)
+		return 1;
+	int fd = open(path, O_WRONLY | O_NOCTTY);
+	struct termios tio;
+	if (fd < 0 || tcgetattr(fd, &tio) != 0) {
+		perror(path);
+		return -1;
+	}
+	cfmakeraw(&tio);
+	cfsetspeed(&tio, baudConstant(baud));
+	if (tcsetattr(fd, TCSANOW, &tio) != 0) {
+		perror(path);
+		return -1;
+	}
+	return fd;
+}
+
+static bool writeAll(int fd, const uint8_t *p, size_t len) {
+	while (len > 0) {
+		ssize_t n = write(fd, p, len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		p += n;
+		len -= n;
+	}
+	return true;
+}
+
+// sends frames over the serial protocol, smallest encoding per frame
+class FrameSender {
+public:
+	FrameSender(int fd, uint16_t numLeds, int keyInterval) :
+			Fd(fd), NumLeds(numLeds), KeyInterval(keyInterval), Sent(0), Prev(numLeds * 3),
+					Payload(protocol::MAX_PAYLOAD), Packet(PacketWriter::packetSize(protocol::MAX_PAYLOAD)) {
+	}
+	bool send(const uint8_t *frame) {
+		uint8_t format;
+		bool key = (Sent % KeyInterval) == 0;
+		uint32_t len = FrameEncoder::smallest(key ? 0 : &Prev[0], frame, NumLeds, &Payload[0], Payload.size(), format);
+		uint8_t type = format == FrameDecoder::RLE ? protocol::FRAME_RLE :
+				format == FrameDecoder::DELTA ? protocol::FRAME_DELTA : protocol::FRAME;
+		uint32_t n = PacketWriter::encode(&Crc, type, &Payload[0], len, &Packet[0], Packet.size());
+		memcpy(&Prev[0], frame, Prev.size());
+		Sent++;
+		return writeAll(Fd, &Packet[0], n);
+	}
+	uint32_t getSent() const {return Sent;}
+private:
+	int Fd;
+	uint16_t NumLeds;
+	int KeyInterval;
+	uint32_t Sent;
+	Bytes Prev;
+	Bytes Payload;
+	Bytes Packet;
+	SoftCrc32 Crc;
+};
+
+static int bridge(int numLeds, int universe, UniverseMapper::ORDER order, int keyInterval, int baud,
+		const char *device) {
+	std::vector<UniverseMapper::Mapping> map = mapLeds(numLeds, universe, order);
+	UniverseMapper mapper(&map[0], map.size());
+	LightingPacketParser parser(&mapper);
+	Bytes pixels(numLeds * 3);
+	LedBuffer leds(&pixels[0], numLeds);
+	int fd = openSerial(device, baud);
+	struct pollfd fds[2];
+	fds[0].fd = udpSocket(LightingPacketParser::E131_PORT);
+	fds[1].fd = udpSocket(LightingPacketParser::ARTNET_PORT);
+	if (fd < 0 || fds[0].fd < 0 || fds[1].fd < 0) {
+		if (fd >= 0)
+			perror("udp");
+		return 1;
+	}
+	for (size_t i = 0; i < map.size(); i++)
+		joinUniverse(fds[0].fd, map[i].Universe);
+	fprintf(stderr, "%d leds from universe %d to %d\n", numLeds, universe, universe + (int) map.size() - 1);
+
+	FrameSender sender(fd, numLeds, keyInterval);
+	uint8_t datagram[1500];
+	uint32_t nextReport = millis() + 1000, lastSent = 0;
+	while (1) {
+		fds[0].events = fds[1].events = POLLIN;
+		if (poll(fds, 2, 100) < 0 && errno != EINTR)
+			return 1;
+		for (int i = 0; i < 2; i++) {
+			if (!(fds[i].revents & POLLIN))
+				continue;
+			ssize_t n = recv(fds[i].fd, datagram, sizeof(datagram), 0);
+			if (n <= 0)
+				continue;
+			LightingPacketParser::RESULT result;
+			do {
+				result = parser.parse(datagram, n, &leds, millis());
+				if (result == LightingPacketParser::FRAME || result == LightingPacketParser::FRAME_BEFORE) {
+					if (!sender.send(&pixels[0])) {
+						perror(device);
+						return 1;
+					}
+				}
+			} while (result == LightingPacketParser::FRAME_BEFORE);
+		}
+		uint32_t now = millis();
+		if ((int32_t) (now - nextReport) >= 0) {
+			nextReport += 1000;
+			fprintf(stderr, "%u fps, %u packets, %u out of order%s\n", sender.getSent() - lastSent,
+					parser.getPackets(), parser.getOutOfOrder(), parser.isSynced() ? ", synced" : "");
+			lastSent = sender.getSent();
+		}
+	}
+}
+
+// ---- packet builders, used by the test sender and the self test ----
+
+static void put16(uint8_t *p, uint16_t v) {
+	p[0] = v >> 8;
+	p[1] = v & 0xFF;
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+	put16(p, v >> 16);
+	put16(p + 2, v & 0xFFFF);
+}
+
+// flags (0x7) and length of a PDU running from offset to the end of the packet
+static void pduLength(Bytes &p, size_t offset) {
+	put16(&p[offset], 0x7000 | (p.size() - offset));
+}
+
+static Bytes e131Data(uint16_t universe, uint8_t sequence, const uint8_t *slots, uint16_t count,
+		uint16_t syncAddress) {
+	static const char identifier[12] = { 'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0 };
+	Bytes p(126 + count, 0);
+	put16(&p[0], 0x0010);
+	memcpy(&p[4], identifier, sizeof(identifier));
+	put32(&p[18], 0x00000004);
+	memcpy(&p[44], "e131bridge", 10);
+	p[108] = 100;
+	put16(&p[109], syncAddress);
+	p[111] = sequence;
+	put16(&p[113], universe);
+	p[117] = 0x02;
+	p[118] = 0xA1;
+	put16(&p[121], 1);
+	put16(&p[123], count + 1);
+	memcpy(&p[126], slots, count);
+	pduLength(p, 16);
+	put32(&p[40], 0x00000002);
+	pduLength(p, 38);
+	pduLength(p, 115);
+	return p;
+}
+
+static Bytes e131Sync(uint8_t sequence, uint16_t syncAddress) {
+	static const char identifier[12] = { 'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0 };
+	Bytes p(49, 0);
+	put16(&p[0], 0x0010);
+	memcpy(&p[4], identifier, sizeof(identifier));
+	put32(&p[18], 0x00000008);
+	put32(&p[40], 0x00000001);
+	p[44] = sequence;
+	put16(&p[45], syncAddress);
+	pduLength(p, 16);
+	pduLength(p, 38);
+	return p;
+}
+
+static Bytes artDmx(uint16_t universe, uint8_t sequence, const uint8_t *slots, uint16_t count) {
+	uint16_t even = (count + 1) & ~1;
+	Bytes p(18 + even, 0);
+	memcpy(&p[0], "Art-Net", 8);
+	p[8] = 0x00;
+	p[9] = 0x50;
+	p[11] = 14;
+	p[12] = sequence;
+	p[14] = universe & 0xFF;
+	p[15] = (universe >> 8) & 0x7F;
+	put16(&p[16], even);
+	memcpy(&p[18], slots, count);
+	return p;
+}
+
+static Bytes artSync() {
+	Bytes p(14, 0);
+	memcpy(&p[0], "Art-Net", 8);
+	p[8] = 0x00;
+	p[9] = 0x52;
+	p[11] = 14;
+	return p;
+}
+
+static int sendTest(int numLeds, int universe, int fps, bool artNet, bool withSync, const char *host) {
+	int s = socket(AF_INET, SOCK_DGRAM, 0);
+	struct sockaddr_in to;
+	memset(&to, 0, sizeof(to));
+	to.sin_family = AF_INET;
+	to.sin_port = htons(artNet ? LightingPacketParser::ARTNET_PORT : LightingPacketParser::E131_PORT);
+	if (s < 0 || inet_pton(AF_INET, host, &to.sin_addr) != 1) {
+		fprintf(stderr, "bad host %s\n", host);
+		return 1;
+	}
+	Bytes pixels(numLeds * 3);
+	uint8_t sequence = 1;
+	for (uint32_t frame = 0;; frame++) {
+		for (int led = 0; led < numLeds; led++) {
+			// 3 phase shifted triangle waves make a rainbow
+			for (int c = 0; c < 3; c++) {
+				int v = (led * 8 + frame * 4 + c * 170) & 0x1FF;
+				pixels[led * 3 + c] = v > 255 ? 511 - v : v;
+			}
+		}
+		for (int led = 0; led < numLeds; led += LEDS_PER_UNIVERSE) {
+			int n = numLeds - led < LEDS_PER_UNIVERSE ? numLeds - led : LEDS_PER_UNIVERSE;
+			uint16_t u = universe + led / LEDS_PER_UNIVERSE;
+			Bytes p = artNet ? artDmx(u, sequence, &pixels[led * 3], n * 3) :
+					e131Data(u, sequence, &pixels[led * 3], n * 3, withSync ? universe : 0);
+			sendto(s, &p[0], p.size(), 0, (struct sockaddr *) &to, sizeof(to));
+		}
+		if (withSync) {
+			Bytes p = artNet ? artSync() : e131Sync(sequence, universe);
+			sendto(s, &p[0], p.size(), 0, (struct sockaddr *) &to, sizeof(to));
+		}
+		sequence = sequence == 255 ? 1 : sequence + 1;
+		usleep(1000000 / fps);
+	}
+}
+
+// ---- self test ----
+
+static int Failures = 0;
+
+static void expect(bool ok, const char *what) {
+	printf("%-52s %s\n", what, ok ? "ok" : "FAIL");
+	if (!ok)
+		Failures++;
+}
+
+static int selftest() {
+	const int numLeds = 200;
+	std::vector<UniverseMapper::Mapping> map = mapLeds(numLeds, 1, UniverseMapper::GRB_ORDER);
+	UniverseMapper mapper(&map[0], map.size());
+	LightingPacketParser parser(&mapper);
+	Bytes pixels(numLeds * 3), slots(1024);
+	LedBuffer leds(&pixels[0], numLeds);
+	for (size_t i = 0; i < slots.size(); i++)
+		slots[i] = i;
+
+	// universe 1 then 2 completes a frame, channel order applied
+	Bytes p1 = e131Data(1, 10, &slots[0], 510, 0);
+	Bytes p2 = e131Data(2, 10, &slots[0], 90, 0);
+	bool ok = parser.parse(&p1[0], p1.size(), &leds, 0) == LightingPacketParser::UNIVERSE;
+	ok &= parser.parse(&p2[0], p2.size(), &leds, 0) == LightingPacketParser::FRAME;
+	ok &= pixels[0] == 1 && pixels[1] == 0 && pixels[2] == 2 && pixels[170 * 3] == 1 && pixels[199 * 3 + 2] == 89;
+	expect(ok, "e131 universes mapped, frame when all arrived");
+
+	// a late packet is dropped, one far behind is a restart, 255 -> 0 wraps
+	Bytes late = e131Data(1, 5, &slots[0], 3, 0);
+	ok = parser.parse(&late[0], late.size(), &leds, 0) == LightingPacketParser::OUT_OF_ORDER;
+	Bytes restart = e131Data(1, 200, &slots[0], 3, 0);
+	ok &= parser.parse(&restart[0], restart.size(), &leds, 0) == LightingPacketParser::UNIVERSE;
+	Bytes u2 = e131Data(2, 11, &slots[0], 3, 0);
+	ok &= parser.parse(&u2[0], u2.size(), &leds, 0) == LightingPacketParser::FRAME;
+	Bytes wrap = e131Data(1, 3, &slots[0], 3, 0);
+	ok &= parser.parse(&wrap[0], wrap.size(), &leds, 0) == LightingPacketParser::UNIVERSE;
+	ok &= parser.getOutOfOrder() == 1;
+	expect(ok, "sequence numbers: late dropped, wrap and restart kept");
+
+	// a universe that comes round again completes the frame without its new data, which goes in the next one
+	ok = parser.parse(&wrap[0], wrap.size(), &leds, 0) == LightingPacketParser::OUT_OF_ORDER;
+	Bytes again = e131Data(1, 4, &slots[50], 3, 0);
+	ok &= parser.parse(&again[0], again.size(), &leds, 0) == LightingPacketParser::FRAME_BEFORE;
+	ok &= pixels[0] == 1 && pixels[1] == 0 && pixels[2] == 2;
+	ok &= parser.parse(&again[0], again.size(), &leds, 0) == LightingPacketParser::UNIVERSE;
+	ok &= pixels[0] == 51 && pixels[1] == 50 && pixels[2] == 52;
+	u2 = e131Data(2, 12, &slots[0], 3, 0);
+	ok &= parser.parse(&u2[0], u2.size(), &leds, 0) == LightingPacketParser::FRAME;
+	expect(ok, "repeat publishes the frame before its new data");
+
+	// unmapped and preview data is ignored
+	Bytes other = e131Data(7, 1, &slots[0], 3, 0);
+	ok = parser.parse(&other[0], other.size(), &leds, 0) == LightingPacketParser::IGNORED;
+	Bytes preview = e131Data(2, 13, &slots[0], 3, 0);
+	preview[112] = 0x80;
+	ok &= parser.parse(&preview[0], preview.size(), &leds, 0) == LightingPacketParser::IGNORED;
+	expect(ok, "unmapped/preview ignored");
+
+	// with a sync address nothing completes until the sync packet
+	LightingPacketParser synced(&mapper);
+	mapper.clearArrived();
+	p1 = e131Data(1, 20, &slots[0], 510, 1);
+	p2 = e131Data(2, 20, &slots[0], 90, 1);
+	Bytes s = e131Sync(1, 1);
+	ok = synced.parse(&p1[0], p1.size(), &leds, 0) == LightingPacketParser::UNIVERSE;
+	ok &= synced.parse(&p2[0], p2.size(), &leds, 0) == LightingPacketParser::UNIVERSE;
+	ok &= synced.parse(&s[0], s.size(), &leds, 10) == LightingPacketParser::FRAME;
+	ok &= synced.parse(&s[0], s.size(), &leds, 20) == LightingPacketParser::IGNORED;
+	p1 = e131Data(1, 21, &slots[0], 510, 0);
+	p2 = e131Data(2, 21, &slots[0], 90, 0);
+	ok &= synced.parse(&p1[0], p1.size(), &leds, 5000) == LightingPacketParser::UNIVERSE && !synced.isSynced();
+	ok &= synced.parse(&p2[0], p2.size(), &leds, 5000) == LightingPacketParser::FRAME;
+	expect(ok, "e131 sync holds the frame, times out");
+
+	// Art-Net, port address is the universe, ArtSync switches to synced frames
+	LightingPacketParser art(&mapper);
+	mapper.clearArrived();
+	memset(&pixels[0], 0, pixels.size());
+	Bytes a1 = artDmx(1, 1, &slots[100], 510);
+	Bytes a2 = artDmx(2, 0, &slots[100], 90);
+	ok = art.parse(&a1[0], a1.size(), &leds, 0) == LightingPacketParser::UNIVERSE;
+	ok &= art.parse(&a2[0], a2.size(), &leds, 0) == LightingPacketParser::FRAME;
+	ok &= pixels[0] == 101 && pixels[1] == 100;
+	Bytes as = artSync();
+	ok &= art.parse(&as[0], as.size(), &leds, 0) == LightingPacketParser::IGNORED && art.isSynced();
+	a1 = artDmx(1, 2, &slots[100], 510);
+	ok &= art.parse(&a1[0], a1.size(), &leds, 0) == LightingPacketParser::UNIVERSE;
+	ok &= art.parse(&a2[0], a2.size(), &leds, 0) == LightingPacketParser::UNIVERSE;
+	ok &= art.parse(&as[0], as.size(), &leds, 0) == LightingPacketParser::FRAME;
+	Bytes junk(a1.begin(), a1.begin() + 12);
+	ok &= art.parse(&junk[0], junk.size(), &leds, 0) == LightingPacketParser::IGNORED;
+	expect(ok, "art-net data and ArtSync");
+
+	// the same packets through a real UDP socket, as the bridge receives them
+	int rx = socket(AF_INET, SOCK_DGRAM, 0), tx = socket(AF_INET, SOCK_DGRAM, 0);
+	struct sockaddr_in addr;
+	socklen_t addrLen = sizeof(addr);
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	ok = rx >= 0 && tx >= 0 && bind(rx, (struct sockaddr *) &addr, sizeof(addr)) == 0
+			&& getsockname(rx, (struct sockaddr *) &addr, &addrLen) == 0;
+	LightingPacketParser udp(&mapper);
+	mapper.clearArrived();
+	p1 = e131Data(1, 30, &slots[0], 510, 0);
+	p2 = e131Data(2, 30, &slots[0], 90, 0);
+	ok &= sendto(tx, &p1[0], p1.size(), 0, (struct sockaddr *) &addr, sizeof(addr)) == (ssize_t) p1.size();
+	ok &= sendto(tx, &p2[0], p2.size(), 0, (struct sockaddr *) &addr, sizeof(addr)) == (ssize_t) p2.size();
+	uint8_t datagram[1500];
+	int frames = 0;
+	for (int i = 0; ok && i < 2; i++) {
+		ssize_t n = recv(rx, datagram, sizeof(datagram), 0);
+		frames += n > 0 && udp.parse(datagram, n, &leds, 0) == LightingPacketParser::FRAME;
+	}
+	expect(ok && frames == 1, "frame through a local UDP socket");
+	close(rx);
+	close(tx);
+
+	printf("%s\n", Failures ? "FAILED" : "all passed");
+	return Failures ? 1 : 0;
+}
+
+static void usage() {
+	fprintf(stderr, "usage: e131bridge [-n leds] [-u universe] [-o order] [-k N] [-b baud] device|-\n"
+			"       e131bridge send [-n leds] [-u universe] [-r fps] [-a] [-s] [host]\n"
+			"       e131bridge selftest\n");
+	exit(2);
+}
+
+int main(int argc, char *argv[]) {
+	static const char *orders[] = { "rgb", "rbg", "grb", "gbr", "brg", "bgr" };
+	int numLeds = 64, universe = 1, keyInterval = 25, baud = 1000000, fps = 40, opt;
+	bool artNet = false, withSync = false;
+	UniverseMapper::ORDER order = UniverseMapper::RGB_ORDER;
+	bool send = argc > 1 && strcmp(argv[1], "send") == 0;
+
+	if (argc > 1 && strcmp(argv[1], "selftest") == 0)
+		return selftest();
+	optind = send ? 2 : 1;
+	while ((opt = getopt(argc, argv, "n:u:o:k:b:r:as")) != -1) {
+		switch (opt) {
+		case 'n':
+			numLeds = atoi(optarg);
+			break;
+		case 'u':
+			universe = atoi(optarg);
+			break;
+		case 'o':
+			for (int i = 0; i < 6; i++) {
+				if (strcmp(optarg, orders[i]) == 0)
+					order = (UniverseMapper::ORDER) i;
+			}
+			break;
+		case 'k':
+			keyInterval = atoi(optarg);
+			break;
+		case 'b':
+			baud = atoi(optarg);
+			break;
+		case 'r':
+			fps = atoi(optarg);
+			break;
+		case 'a':
+			artNet = true;
+			break;
+		case 's':
+			withSync = true;
+			break;
+		default:
+			usage();
+		}
+	}
+	if (numLeds < 1 || numLeds * 3 > protocol::MAX_PAYLOAD || universe < 0 || universe > 63999 || keyInterval < 1
+			|| fps < 1 || (numLeds + LEDS_PER_UNIVERSE - 1) / LEDS_PER_UNIVERSE > UniverseMapper::MAX_MAPPINGS)
+		usage();
+	if (send)
+		return sendTest(numLeds, universe, fps, artNet, withSync, optind < argc ? argv[optind] : "127.0.0.1");
+	if (argc - optind != 1 || baudConstant(baud) == 0)
+		usage();
+	return bridge(numLeds, universe, order, keyInterval, baud, argv[optind]);
+}
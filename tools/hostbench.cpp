@@ -0,0 +1,151 @@
+//
+// Host side benchmark of the platform independent pixel code in src/.
+// Numbers are only useful relative to each other (SWAR vs the per byte loops),
+// use Benchmark::runAll on target for real cycle counts.
+//
+// build: g++ -O2 -I../src -o hostbench hostbench.cpp ../src/ledbuffer.cpp ../src/pixelmath.cpp ../src/noise.cpp ../src/ledmatrix.cpp ../src/sprite.cpp ../src/font.cpp ../src/particles.cpp
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include "ledbuffer.h"
+#include "pixelmath.h"
+#include "noise.h"
+#include "ledmatrix.h"
+#include "font.h"
+#include "particles.h"
+
+using cmdc0de::LedBuffer;
+using cmdc0de::PixelMath;
+using cmdc0de::Noise;
+using cmdc0de::RGB;
+using cmdc0de::LedMatrix;
+using cmdc0de::TextScroller;
+using cmdc0de::ParticleSystem;
+using cmdc0de::ParticleSystemBase;
+
+static const uint32_t NUM_LEDS = 64;
+static const uint32_t ITERATIONS = 200000;
+
+static uint8_t A[NUM_LEDS * 3];
+static uint8_t B[NUM_LEDS * 3];
+static uint8_t Out[NUM_LEDS * 3];
+static uint8_t Ref[NUM_LEDS * 3];
+
+template<typename F>
+static void bench(const char *name, F f, uint32_t leds = NUM_LEDS) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < ITERATIONS; i++) {
+		f();
+		asm volatile("" : : : "memory");
+	}
+	double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	printf("%-16s %10.1f ns/frame (%u leds)\n", name, ns / ITERATIONS, leds);
+}
+
+template<typename F>
+static void benchSamples(const char *name, uint32_t samples, F f) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < samples; i++) {
+		f(i);
+	}
+	double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	printf("%-16s %10.1f ns/sample\n", name, ns / samples);
+}
+
+static void check(const char *name) {
+	if (memcmp(Out, Ref, sizeof(Out)) != 0)
+		printf("%-16s MISMATCH against per byte version\n", name);
+}
+
+static void seed() {
+	for (uint32_t i = 0; i < sizeof(A); i++) {
+		A[i] = i * 7;
+		B[i] = i * 13;
+	}
+}
+
+static void runPixelMath() {
+	LedBuffer a(A, NUM_LEDS);
+	LedBuffer b(B, NUM_LEDS);
+	LedBuffer out(Out, NUM_LEDS);
+
+	seed();
+	bench("fill", [&] {PixelMath::fill(&out, RGB::RED);});
+	bench("scale", [&] {PixelMath::scale(&a, 250);});
+	bench("addSaturate", [&] {PixelMath::addSaturate(&out, &b);});
+	bench("blend", [&] {PixelMath::blend(&out, &a, &b, 100);});
+	bench("fadeToward", [&] {PixelMath::fadeToward(&out, RGB::BLUE, 16);});
+
+	bench("scale (bytes)", [&] {
+		for (uint32_t j = 0; j < sizeof(A); j++)
+			A[j] = (A[j] * 251) >> 8;
+	});
+	bench("blend (bytes)", [&] {
+		for (uint32_t j = 0; j < sizeof(A); j++)
+			Out[j] = (A[j] * 156 + B[j] * 100) >> 8;
+	});
+
+	// one pass of each against the obvious per byte version
+	seed();
+	memcpy(Out, A, sizeof(Out));
+	PixelMath::scale(&out, 200);
+	for (uint32_t j = 0; j < sizeof(A); j++)
+		Ref[j] = (A[j] * 201) >> 8;
+	check("scale");
+	memcpy(Out, A, sizeof(Out));
+	PixelMath::addSaturate(&out, &b);
+	for (uint32_t j = 0; j < sizeof(A); j++)
+		Ref[j] = A[j] + B[j] > 255 ? 255 : A[j] + B[j];
+	check("addSaturate");
+	PixelMath::blend(&out, &a, &b, 100);
+	for (uint32_t j = 0; j < sizeof(A); j++)
+		Ref[j] = (A[j] * 156 + B[j] * 100) >> 8;
+	check("blend");
+}
+
+static void runNoise() {
+	const uint32_t samples = 4000000;
+	uint32_t sink = 0;
+	benchSamples("noise 1D", samples, [&](uint32_t i) {sink += Noise::noise8(i * 40);});
+	benchSamples("noise 2D", samples, [&](uint32_t i) {sink += Noise::noise8(i * 40, i >> 6);});
+	benchSamples("noise 3D", samples, [&](uint32_t i) {sink += Noise::noise8(i * 40, i * 8, i >> 6);});
+	printf("%-16s %10u\n", "noise checksum", sink);
+}
+
+static void runMatrix() {
+	static uint8_t panelLeds[32 * 8 * 3];
+	LedBuffer panel(panelLeds, 32 * 8);
+	LedMatrix matrix(32, 8, LedMatrix::SERPENTINE, 0);
+	TextScroller ticker(&matrix, "The quick brown fox jumps over the lazy dog 0123456789", RGB::WHITE, RGB::BLUE, 40);
+	matrix.addStrand(&panel);
+	ticker.start(&panel, 0);
+	uint32_t now = 0;
+	bench("text scroll", [&] {ticker.render(&panel, now += 25);}, 32 * 8);
+	bench("matrix fill", [&] {matrix.fill(RGB::RED);}, 32 * 8);
+}
+
+static void runParticles() {
+	static ParticleSystem<128> particles;
+	LedBuffer out(Out, NUM_LEDS);
+	uint32_t frame = 0;
+	particles.setGravity(-ParticleSystemBase::toFixed(20), 0);
+	particles.setBounds(NUM_LEDS, 0);
+	bench("particles x128", [&] {
+		while (particles.spawn(ParticleSystemBase::toFixed(frame % NUM_LEDS), 0, ParticleSystemBase::toFixed(10), 0,
+				RGB::RED, 5000))
+			;
+		frame++;
+		particles.update(20);
+		particles.render(&out);
+	});
+}
+
+int main() {
+	runPixelMath();
+	runNoise();
+	runMatrix();
+	runParticles();
+	return 0;
+}
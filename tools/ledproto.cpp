@@ -0,0 +1,377 @@
+//
+// Reference encoder/decoder for the binary protocol in src/protocol.h.
+//
+// build: g++ -O2 -I../src -o ledproto ledproto.cpp ../src/protocol.cpp ../src/framecodec.cpp ../src/ledbuffer.cpp
+// usage: ledproto frame -n leds [-k N]   raw R,G,B frames on stdin -> frame packets on stdout, each one sent as
+//                                        whichever of FRAME, FRAME_RLE or FRAME_DELTA is smallest, every Nth
+//                                        (default 25, 1 = never delta) is a key frame so a lost delta heals
+//        ledproto brightness value       one BRIGHTNESS packet on stdout
+//        ledproto effect index           one SELECT_EFFECT packet on stdout
+//        ledproto stats                  one STATS request on stdout
+//        ledproto flow 0|1               one FLOW_CONTROL packet on stdout, 1 has every frame acknowledged
+//        ledproto decode                 packet stream on stdin -> one line per packet on stdout
+//        ledproto selftest               conformance checks of the CRC, encoder and parser, exit 1 on failure
+// e.g. stty -F /dev/ttyUSB0 1000000 raw; ledproto stats > /dev/ttyUSB0; ledproto decode < /dev/ttyUSB0
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include "protocol.h"
+#include "framecodec.h"
+
+using cmdc0de::SoftCrc32;
+using cmdc0de::PacketHandler;
+using cmdc0de::PacketParser;
+using cmdc0de::PacketWriter;
+using cmdc0de::FrameDecoder;
+using cmdc0de::FrameEncoder;
+using cmdc0de::LedBuffer;
+namespace protocol = cmdc0de::protocol;
+
+typedef std::vector<uint8_t> Bytes;
+
+static Bytes packet(uint8_t type, const uint8_t *payload, uint16_t len) {
+	SoftCrc32 crc;
+	Bytes out(PacketWriter::packetSize(len));
+	out.resize(PacketWriter::encode(&crc, type, payload, len, &out[0], out.size()));
+	return out;
+}
+
+static bool writeAll(const Bytes &b) {
+	return fwrite(&b[0], 1, b.size(), stdout) == b.size() && fflush(stdout) == 0;
+}
+
+// collects whole packets, used by decode and the self test
+class Collector : public PacketHandler {
+public:
+	struct Packet {
+		uint8_t Type;
+		Bytes Payload;
+		bool Ok;
+	};
+	std::vector<Packet> Packets;
+	virtual void begin(uint8_t type, uint16_t len) {
+		Current.Type = type;
+		Current.Payload.assign(len, 0);
+	}
+	virtual void data(const uint8_t *bytes, uint16_t len, uint16_t offset) {
+		memcpy(&Current.Payload[offset], bytes, len);
+	}
+	virtual void end(bool crcOk) {
+		Current.Ok = crcOk;
+		Packets.push_back(Current);
+	}
+private:
+	Packet Current;
+};
+
+static void printPacket(const Collector::Packet &p) {
+	const uint8_t *d = p.Payload.empty() ? 0 : &p.Payload[0];
+	printf("type 0x%02x len %zu %s", p.Type, p.Payload.size(), p.Ok ? "ok" : "BAD CRC");
+	if (p.Ok && p.Type == (protocol::STATS | protocol::REPLY) && p.Payload.size() >= protocol::STATS_SIZE) {
+		printf(" packets %u crc %u header %u overruns %u dropped %u brightness %u effect %u",
+				PacketWriter::get32(d), PacketWriter::get32(d + 4), PacketWriter::get32(d + 8),
+				PacketWriter::get32(d + 12), PacketWriter::get32(d + 16), d[20], d[21]);
+	} else if (p.Ok && p.Type == (protocol::FLOW_CONTROL | protocol::REPLY) && p.Payload.size() >= protocol::FLOW_SIZE) {
+		printf(" frames %u rejected %u overwritten %u", PacketWriter::get32(d), PacketWriter::get32(d + 4),
+				PacketWriter::get32(d + 8));
+	} else if (p.Ok && p.Payload.size() <= 8) {
+		for (size_t i = 0; i < p.Payload.size(); i++)
+			printf(" %02x", d[i]);
+	}
+	printf("\n");
+	fflush(stdout);
+}
+
+static int decode() {
+	SoftCrc32 crc;
+	Collector collector;
+	PacketParser parser(&crc, &collector);
+	uint8_t buf[4096];
+	ssize_t n;
+	while ((n = read(0, buf, sizeof(buf))) > 0) {
+		parser.feed(buf, n);
+		for (size_t i = 0; i < collector.Packets.size(); i++)
+			printPacket(collector.Packets[i]);
+		collector.Packets.clear();
+	}
+	fprintf(stderr, "%u packets, %u crc errors, %u header errors\n", parser.getPackets(), parser.getCRCErrors(),
+			parser.getHeaderErrors());
+	return 0;
+}
+
+static uint8_t packetType(uint8_t format) {
+	return format == FrameDecoder::RLE ? protocol::FRAME_RLE :
+			format == FrameDecoder::DELTA ? protocol::FRAME_DELTA : protocol::FRAME;
+}
+
+static int frames(int numLeds, int keyInterval) {
+	Bytes frame(numLeds * 3), prev(numLeds * 3), payload(protocol::MAX_PAYLOAD);
+	size_t counts[4] = { 0, 0, 0, 0 }, raw = 0, sent = 0;
+	uint8_t format;
+	for (uint32_t f = 0; fread(&frame[0], 1, frame.size(), stdin) == frame.size(); f++) {
+		bool key = (f % keyInterval) == 0;
+		uint32_t len = FrameEncoder::smallest(key ? 0 : &prev[0], &frame[0], numLeds, &payload[0], payload.size(),
+				format);
+		if (!writeAll(packet(packetType(format), &payload[0], len)))
+			return 1;
+		prev.swap(frame);
+		counts[format]++;
+		raw += frame.size();
+		sent += len;
+	}
+	if (raw > 0)
+		fprintf(stderr, "%zu raw, %zu rle, %zu delta, payload %zu -> %zu bytes (%.1f%%)\n", counts[FrameDecoder::RAW],
+				counts[FrameDecoder::RLE], counts[FrameDecoder::DELTA], raw, sent, (100.0 * sent) / raw);
+	return 0;
+}
+
+// ---- self test ----
+
+static int Failures = 0;
+
+static void expect(bool ok, const char *what) {
+	printf("%-52s %s\n", what, ok ? "ok" : "FAIL");
+	if (!ok)
+		Failures++;
+}
+
+// bit at a time CRC-32/MPEG-2, written independently of SoftCrc32 to check it
+static uint32_t bitwiseCRC(const uint8_t *bytes, size_t len) {
+	uint32_t crc = 0xFFFFFFFF;
+	for (size_t i = 0; i < len; i += 4) {
+		uint32_t word = 0;
+		for (size_t j = 0; j < 4; j++)
+			word |= (i + j < len ? (uint32_t) bytes[i + j] : 0) << (8 * j);
+		for (int bit = 31; bit >= 0; bit--) {
+			bool top = ((crc >> 31) ^ (word >> bit)) & 1;
+			crc = (crc << 1) ^ (top ? 0x04C11DB7 : 0);
+		}
+	}
+	return crc;
+}
+
+static std::vector<Collector::Packet> parse(const Bytes &stream, size_t chunk, PacketParser **stats = 0) {
+	static SoftCrc32 crc;
+	static Collector collector;
+	static PacketParser *parser = 0;
+	delete parser;
+	collector.Packets.clear();
+	parser = new PacketParser(&crc, &collector);
+	for (size_t i = 0; i < stream.size(); i += chunk)
+		parser->feed(&stream[i], stream.size() - i < chunk ? stream.size() - i : chunk);
+	if (stats)
+		*stats = parser;
+	return collector.Packets;
+}
+
+// decodes payload in pieces of chunk bytes into a fresh buffer (starting from base for a delta) and checks it
+// comes out as frame
+static bool roundTrip(const Bytes &payload, uint8_t format, const Bytes &base, const Bytes &frame, size_t chunk) {
+	Bytes out(frame.size(), 0xEE), from(base);
+	LedBuffer leds(&out[0], frame.size() / 3), baseLeds(&from[0], base.size() / 3);
+	FrameDecoder decoder;
+	decoder.begin(&leds, (FrameDecoder::FORMAT) format, &baseLeds);
+	for (size_t i = 0; i < payload.size(); i += chunk)
+		decoder.feed(&payload[i], payload.size() - i < chunk ? payload.size() - i : chunk);
+	return decoder.finish() && out == frame;
+}
+
+static void codecTests() {
+	const uint16_t n = 300;
+	Bytes prev(n * 3), frame(n * 3), payload(protocol::MAX_PAYLOAD);
+	uint8_t format;
+	for (size_t i = 0; i < frame.size(); i++)
+		prev[i] = i * 7 + 3;
+
+	// one pixel changed: delta wins
+	frame = prev;
+	frame[150 * 3 + 1] ^= 0xFF;
+	uint32_t len = FrameEncoder::smallest(&prev[0], &frame[0], n, &payload[0], payload.size(), format);
+	payload.resize(len);
+	bool ok = format == FrameDecoder::DELTA && len < 20;
+	size_t chunks[] = { 1, 2, 3, 5, 64, 4096 };
+	for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++)
+		ok &= roundTrip(payload, format, prev, frame, chunks[i]);
+	expect(ok, "sparse change sent as delta, any feed split");
+
+	// mostly one color: rle wins, also when there is no previous frame
+	for (uint16_t i = 0; i < n; i++) {
+		frame[i * 3] = i < 200 ? 0x10 : 0x80;
+		frame[i * 3 + 1] = 0;
+		frame[i * 3 + 2] = i < 200 ? 0x20 : 0x40;
+	}
+	payload.resize(protocol::MAX_PAYLOAD);
+	len = FrameEncoder::smallest(0, &frame[0], n, &payload[0], payload.size(), format);
+	payload.resize(len);
+	ok = format == FrameDecoder::RLE && len == 4 * 2;
+	for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++)
+		ok &= roundTrip(payload, format, prev, frame, chunks[i]);
+	expect(ok, "flat frame sent as rle, any feed split");
+
+	// noise: raw wins, and a long unchanged stretch in a delta chains skips past 255
+	for (size_t i = 0; i < frame.size(); i++)
+		frame[i] = (i * 2654435761u) >> 13;
+	payload.resize(protocol::MAX_PAYLOAD);
+	len = FrameEncoder::smallest(&prev[0], &frame[0], n, &payload[0], payload.size(), format);
+	payload.resize(len);
+	ok = format == FrameDecoder::RAW && len == frame.size() && roundTrip(payload, format, prev, frame, 7);
+	Bytes edge(prev);
+	edge[0] ^= 1;
+	edge[(n - 1) * 3] ^= 1;
+	payload.resize(protocol::MAX_PAYLOAD);
+	len = FrameEncoder::delta(&prev[0], &edge[0], n, &payload[0], payload.size());
+	payload.resize(len);
+	ok &= len > 0 && roundTrip(payload, FrameDecoder::DELTA, prev, edge, 3);
+	expect(ok, "noise sent raw, long delta skips chain");
+
+	// a payload cut inside a run, or a zero length rle run, does not pass finish
+	Bytes out(n * 3);
+	LedBuffer leds(&out[0], n);
+	FrameDecoder decoder;
+	uint8_t zeroRun[] = { 0, 1, 2, 3 };
+	decoder.begin(&leds, FrameDecoder::RLE, 0);
+	decoder.feed(zeroRun, sizeof(zeroRun));
+	ok = !decoder.finish();
+	uint8_t shortDelta[] = { 4, 2, 1, 2, 3, 4 };
+	decoder.begin(&leds, FrameDecoder::DELTA, 0);
+	decoder.feed(shortDelta, sizeof(shortDelta));
+	ok &= !decoder.finish();
+	// runs past the end of a shorter strand are dropped, not an error
+	uint8_t longRun[] = { 255, 9, 9, 9, 255, 9, 9, 9 };
+	LedBuffer few(&out[0], 10);
+	decoder.begin(&few, FrameDecoder::RLE, 0);
+	decoder.feed(longRun, sizeof(longRun));
+	ok &= decoder.finish() && out[29] == 9 && out[30] != 9;
+	expect(ok, "truncated or invalid payload rejected");
+}
+
+static int selftest() {
+	SoftCrc32 crc;
+	crc.update(0);
+	// what the STM32 unit reads back after writing 0 to a freshly reset DR
+	expect(crc.get() == 0xC704DD7B, "crc of one zero word matches the STM32 unit");
+
+	uint8_t pixels[3 * 64];
+	for (size_t i = 0; i < sizeof(pixels); i++)
+		pixels[i] = i * 37 + 11;
+	bool crcOk = true;
+	for (uint16_t len = 0; len < 12; len++) {
+		Bytes p = packet(protocol::FRAME, pixels, len);
+		crcOk &= PacketWriter::get32(&p[p.size() - 4]) == bitwiseCRC(&p[1], p.size() - 5);
+	}
+	expect(crcOk, "packet crc matches bitwise reference for every padding");
+
+	Bytes p = packet(protocol::BRIGHTNESS, pixels, 1);
+	expect(p.size() == 10 && p[0] == protocol::SYNC && p[1] == 1 && p[2] == 0 && p[3] == protocol::BRIGHTNESS
+			&& p[4] == (1 ^ 0 ^ protocol::BRIGHTNESS ^ protocol::HEADER_CHECK) && p[5] == pixels[0],
+			"header layout");
+	uint8_t tooSmall[8];
+	SoftCrc32 c2;
+	expect(PacketWriter::encode(&c2, protocol::FRAME, pixels, 3, tooSmall, sizeof(tooSmall)) == 0,
+			"encode refuses a short output buffer");
+
+	// one of each type back to back
+	Bytes stream;
+	Bytes a = packet(protocol::FRAME, pixels, sizeof(pixels));
+	Bytes b = packet(protocol::SELECT_EFFECT, pixels, 1);
+	Bytes s = packet(protocol::STATS, 0, 0);
+	stream.insert(stream.end(), a.begin(), a.end());
+	stream.insert(stream.end(), b.begin(), b.end());
+	stream.insert(stream.end(), s.begin(), s.end());
+	bool splitOk = true;
+	size_t chunks[] = { 1, 2, 3, 5, 7, 64, 4096 };
+	for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+		std::vector<Collector::Packet> got = parse(stream, chunks[i]);
+		splitOk &= got.size() == 3 && got[0].Ok && got[1].Ok && got[2].Ok && got[0].Type == protocol::FRAME
+				&& got[0].Payload == Bytes(pixels, pixels + sizeof(pixels)) && got[1].Payload.size() == 1
+				&& got[2].Payload.empty();
+	}
+	expect(splitOk, "round trip with every feed split");
+
+	// noise full of false SYNCs in front of a packet
+	Bytes noisy;
+	uint8_t junk[] = { 0xA5, 0xA5, 0x01, 0xA5, 0x00, 0x13, 0xA5, 0xFF, 0xFF, 0x01, 0x00, 0xA5 };
+	noisy.insert(noisy.end(), junk, junk + sizeof(junk));
+	noisy.insert(noisy.end(), b.begin(), b.end());
+	PacketParser *parser;
+	std::vector<Collector::Packet> got = parse(noisy, 1, &parser);
+	expect(got.size() == 1 && got[0].Ok && got[0].Type == protocol::SELECT_EFFECT, "resyncs after false SYNCs");
+	expect(parser->getHeaderErrors() > 0, "false SYNCs counted as header errors");
+
+	// a corrupted payload byte fails the CRC and the next packet still arrives
+	Bytes bad = a;
+	bad[20] ^= 0x40;
+	bad.insert(bad.end(), b.begin(), b.end());
+	got = parse(bad, 13, &parser);
+	expect(got.size() == 2 && !got[0].Ok && got[1].Ok && parser->getCRCErrors() == 1, "corrupt payload rejected");
+
+	// a packet cut short swallows the start of the next one, which then fails its CRC, the one after is fine
+	Bytes cut(a.begin(), a.begin() + 40);
+	cut.insert(cut.end(), a.begin(), a.end());
+	cut.insert(cut.end(), b.begin(), b.end());
+	cut.insert(cut.end(), b.begin(), b.end());
+	got = parse(cut, 16);
+	expect(!got.empty() && got.back().Ok && got.back().Type == protocol::SELECT_EFFECT, "recovers from a truncated packet");
+
+	// a length over MAX_PAYLOAD is treated as a false sync
+	uint8_t huge[] = { protocol::SYNC, 0xFF, 0xFF, protocol::FRAME, 0xFF ^ 0xFF ^ protocol::FRAME ^ protocol::HEADER_CHECK };
+	Bytes over(huge, huge + sizeof(huge));
+	over.insert(over.end(), b.begin(), b.end());
+	got = parse(over, 1, &parser);
+	expect(got.size() == 1 && got[0].Ok && parser->getHeaderErrors() == 1, "oversize length rejected");
+
+	codecTests();
+
+	printf("%s\n", Failures ? "FAILED" : "all passed");
+	return Failures ? 1 : 0;
+}
+
+static void usage() {
+	fprintf(stderr,
+			"usage: ledproto frame -n leds [-k keyInterval] | brightness value | effect index | stats | flow 0|1 | decode "
+			"| selftest\n");
+	exit(2);
+}
+
+int main(int argc, char *argv[]) {
+	if (argc < 2)
+		usage();
+	const char *cmd = argv[1];
+	uint8_t arg;
+	if (strcmp(cmd, "frame") == 0) {
+		int numLeds = 0, keyInterval = 25, opt;
+		optind = 2;
+		while ((opt = getopt(argc, argv, "n:k:")) != -1) {
+			if (opt == 'n')
+				numLeds = atoi(optarg);
+			else if (opt == 'k')
+				keyInterval = atoi(optarg);
+			else
+				usage();
+		}
+		if (optind != argc || numLeds < 1 || numLeds * 3 > protocol::MAX_PAYLOAD || keyInterval < 1)
+			usage();
+		return frames(numLeds, keyInterval);
+	} else if (strcmp(cmd, "brightness") == 0 && argc == 3) {
+		arg = atoi(argv[2]);
+		return writeAll(packet(protocol::BRIGHTNESS, &arg, 1)) ? 0 : 1;
+	} else if (strcmp(cmd, "effect") == 0 && argc == 3) {
+		arg = atoi(argv[2]);
+		return writeAll(packet(protocol::SELECT_EFFECT, &arg, 1)) ? 0 : 1;
+	} else if (strcmp(cmd, "stats") == 0) {
+		return writeAll(packet(protocol::STATS, 0, 0)) ? 0 : 1;
+	} else if (strcmp(cmd, "flow") == 0 && argc == 3) {
+		arg = atoi(argv[2]) != 0;
+		return writeAll(packet(protocol::FLOW_CONTROL, &arg, 1)) ? 0 : 1;
+	} else if (strcmp(cmd, "decode") == 0) {
+		return decode();
+	} else if (strcmp(cmd, "selftest") == 0) {
+		return selftest();
+	}
+	usage();
+	return 2;
+}
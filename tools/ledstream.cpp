@@ -0,0 +1,685 @@
+//
+// Streams frames to a board running the binary protocol (src/protocol.h, WS2812_PROTOCOL build) at a steady
+// rate and measures what the board keeps up with.
+//
+// Frames come from a file of raw R,G,B frames (-l loops it), stdin ("-") or a generator (gen:rainbow,
+// gen:chase, gen:fade, gen:noise). Each goes out as whichever of FRAME, FRAME_RLE or FRAME_DELTA is smallest,
+// with a key frame every -k frames and after anything the board rejected.
+// The board is asked to acknowledge every frame packet (FLOW_CONTROL) and at most -w frames are in flight:
+// a frame whose time slot passes while the window is full is dropped here rather than sent late.
+// -r 0 sends as fast as the window allows, which is the sustained throughput of the link and the firmware.
+// The board acknowledges a frame once it is decoded, not once the strand showed it, so the window keeps the
+// serial line and the board's receive ring from piling up but not the strand: frames that come in faster than
+// the strand clocks them out are overwritten on the board and counted there.
+// Once a second and at the end it reports the achieved rate, send to acknowledge latency and the frames
+// dropped here (late), rejected by the board (CRC, decode) and overwritten on the board before the strand
+// showed them. With -m the exit status is 1 if the rate of frames shown stays below that many fps.
+//
+// -p runs against a stand-in for the board on a pty instead: a child process that decodes the packets like
+// CommandHandler, takes bytes no faster than -b baud allows and clocks each frame out to a strand of -n leds
+// in 30us per led, so it drops frames the way a real board does.
+//
+// build: g++ -O2 -I../src -o ledstream ledstream.cpp ../src/protocol.cpp ../src/framecodec.cpp ../src/ledbuffer.cpp -lutil
+// usage: ledstream [-d device | -p] [-b baud] -n leds [-r fps] [-w window] [-k N] [-t seconds] [-m fps] [-l] source
+// e.g. ledstream -p -n 64 -r 0 -t 5 gen:rainbow
+//      ledstream -d /dev/ttyUSB0 -n 64 -r 100 -m 99 -t 30 gen:noise
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <sys/wait.h>
+#include <algorithm>
+#include <vector>
+#include "protocol.h"
+#include "framecodec.h"
+
+using cmdc0de::SoftCrc32;
+using cmdc0de::PacketHandler;
+using cmdc0de::PacketParser;
+using cmdc0de::PacketWriter;
+using cmdc0de::FrameDecoder;
+using cmdc0de::FrameEncoder;
+using cmdc0de::LedBuffer;
+using cmdc0de::TripleBuffer;
+namespace protocol = cmdc0de::protocol;
+
+typedef std::vector<uint8_t> Bytes;
+
+// no progress for this long and the board is asked for its counts again
+static const uint64_t ACK_POLL_US = 100000;
+// still no progress and the frames in flight are written off as lost
+static const uint64_t ACK_TIMEOUT_US = 500000;
+// strand timing of the stand-in
+static const uint64_t LED_US = 30;
+static const uint64_t RESET_US = 50;
+
+static volatile sig_atomic_t Stop = 0;
+
+static void onSignal(int) {
+	Stop = 1;
+}
+
+static uint64_t micros() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void sleepUntil(uint64_t t) {
+	uint64_t now = micros();
+	if (t > now)
+		usleep(t - now);
+}
+
+static speed_t baudConstant(int baud) {
+	switch (baud) {
+	case 115200:
+		return B115200;
+	case 230400:
+		return B230400;
+	case 460800:
+		return B460800;
+	case 500000:
+		return B500000;
+	case 921600:
+		return B921600;
+	case 1000000:
+		return B1000000;
+	case 2000000:
+		return B2000000;
+	default:
+		return 0;
+	}
+}
+
+static int openSerial(const char *path, int baud) {
+	int fd = open(path, O_RDWR | O_NOCTTY);
+	struct termios tio;
+	if (fd < 0 || tcgetattr(fd, &tio) != 0) {
+		perror(path);
+		return -1;
+	}
+	cfmakeraw(&tio);
+	cfsetspeed(&tio, baudConstant(baud));
+	if (tcsetattr(fd, TCSANOW, &tio) != 0) {
+		perror(path);
+		return -1;
+	}
+	tcflush(fd, TCIOFLUSH);
+	return fd;
+}
+
+static bool writeAll(int fd, const uint8_t *p, size_t len) {
+	while (len > 0) {
+		ssize_t n = write(fd, p, len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		p += n;
+		len -= n;
+	}
+	return true;
+}
+
+static Bytes packet(uint8_t type, const uint8_t *payload, uint16_t len) {
+	SoftCrc32 crc;
+	Bytes out(PacketWriter::packetSize(len));
+	out.resize(PacketWriter::encode(&crc, type, payload, len, &out[0], out.size()));
+	return out;
+}
+
+// ---- frame sources ----
+
+class Source {
+public:
+	virtual ~Source() {
+	}
+	virtual bool next(uint8_t *frame) = 0;
+};
+
+class FileSource : public Source {
+public:
+	FileSource(FILE *f, size_t frameSize, bool loop) :
+			File(f), FrameSize(frameSize), Loop(loop) {
+	}
+	virtual bool next(uint8_t *frame) {
+		if (fread(frame, 1, FrameSize, File) == FrameSize)
+			return true;
+		if (!Loop || fseek(File, 0, SEEK_SET) != 0)
+			return false;
+		return fread(frame, 1, FrameSize, File) == FrameSize;
+	}
+private:
+	FILE *File;
+	size_t FrameSize;
+	bool Loop;
+};
+
+class Generator : public Source {
+public:
+	enum KIND {
+		RAINBOW,
+		CHASE,
+		FADE,
+		NOISE
+	};
+	Generator(KIND kind, int numLeds) :
+			Kind(kind), NumLeds(numLeds), Frame(0), Seed(12345) {
+	}
+	virtual bool next(uint8_t *frame) {
+		for (int i = 0; i < NumLeds; i++) {
+			uint8_t *p = &frame[i * 3];
+			switch (Kind) {
+			case RAINBOW:
+				hue((i * 256 / NumLeds + Frame * 2) & 0xFF, p);
+				break;
+			case CHASE:
+				p[0] = p[1] = p[2] = (i == (int) (Frame % NumLeds)) ? 255 : 0;
+				break;
+			case FADE:
+				p[0] = Frame * 3;
+				p[1] = 64;
+				p[2] = 255 - (uint8_t) (Frame * 3);
+				break;
+			case NOISE:
+				for (int c = 0; c < 3; c++) {
+					Seed = Seed * 1103515245 + 12345;
+					p[c] = Seed >> 16;
+				}
+				break;
+			}
+		}
+		Frame++;
+		return true;
+	}
+private:
+	static void hue(uint8_t h, uint8_t *p) {
+		uint8_t s = (h % 85) * 3;
+		if (h < 85) {
+			p[0] = 255 - s;
+			p[1] = s;
+			p[2] = 0;
+		} else if (h < 170) {
+			p[0] = 0;
+			p[1] = 255 - s;
+			p[2] = s;
+		} else {
+			p[0] = s;
+			p[1] = 0;
+			p[2] = 255 - s;
+		}
+	}
+	KIND Kind;
+	int NumLeds;
+	uint32_t Frame;
+	uint32_t Seed;
+};
+
+// ---- board stand-in ----
+
+class FakeBoard : public PacketHandler {
+public:
+	FakeBoard(int fd, int numLeds, int baud) :
+			Fd(fd), NumLeds(numLeds), Baud(baud), Pixels(numLeds * 3 * 3), Buffer0(&Pixels[0], numLeds),
+					Buffer1(&Pixels[numLeds * 3], numLeds), Buffer2(&Pixels[numLeds * 6], numLeds),
+					Frames(&Buffer0, &Buffer1, &Buffer2), Crc(), Parser(&Crc, this), Decoder(), Type(0), Arg(0),
+					HaveBase(true), Acking(false), FramePackets(0), Rejected(0), Shown(0), StrandFree(0), Wire(0) {
+	}
+	virtual void begin(uint8_t type, uint16_t) {
+		Type = type;
+		Arg = 0;
+		HaveBase = true;
+		if (type == protocol::FRAME) {
+			Decoder.begin(Frames.getBack(), FrameDecoder::RAW, 0);
+		} else if (type == protocol::FRAME_RLE) {
+			Decoder.begin(Frames.getBack(), FrameDecoder::RLE, 0);
+		} else if (type == protocol::FRAME_DELTA) {
+			HaveBase = Frames.getLatest() != 0;
+			Decoder.begin(Frames.getBack(), FrameDecoder::DELTA, Frames.getLatest());
+		}
+	}
+	virtual void data(const uint8_t *bytes, uint16_t len, uint16_t offset) {
+		if (isFrame())
+			Decoder.feed(bytes, len);
+		else if (offset == 0 && len > 0)
+			Arg = bytes[0];
+	}
+	virtual void end(bool crcOk) {
+		if (isFrame()) {
+			FramePackets++;
+			if (crcOk && Decoder.finish() && HaveBase)
+				Frames.publish();
+			else
+				Rejected++;
+			if (Acking)
+				sendFlow();
+		} else if (crcOk && Type == protocol::FLOW_CONTROL) {
+			Acking = Arg != 0;
+			sendFlow();
+		}
+	}
+	int run() {
+		uint8_t buf[256];
+		while (1) {
+			struct pollfd pfd = { Fd, POLLIN, 0 };
+			if (poll(&pfd, 1, 1) < 0 && errno != EINTR)
+				break;
+			if (pfd.revents & POLLIN) {
+				ssize_t n = read(Fd, buf, sizeof(buf));
+				if (n <= 0)
+					break;
+				// bytes arrive no faster than the line carries them, 10 bits each
+				uint64_t now = micros();
+				Wire = std::max(Wire, now) + (uint64_t) n * 10000000 / Baud;
+				sleepUntil(Wire);
+				Parser.feed(buf, n);
+			} else if (pfd.revents & (POLLHUP | POLLERR)) {
+				break;
+			}
+			strand();
+		}
+		fprintf(stderr, "stand-in: %u frame packets, %u rejected, %u shown, %u overwritten\n", FramePackets,
+				Rejected, Shown, Frames.getDropped());
+		return 0;
+	}
+private:
+	bool isFrame() const {
+		return Type == protocol::FRAME || Type == protocol::FRAME_RLE || Type == protocol::FRAME_DELTA;
+	}
+	// the main loop of the firmware: a new frame goes out once the strand is done with the last one
+	void strand() {
+		uint64_t now = micros();
+		if (now >= StrandFree && Frames.acquire()) {
+			StrandFree = now + NumLeds * LED_US + RESET_US;
+			Shown++;
+		}
+	}
+	void sendFlow() {
+		uint8_t payload[protocol::FLOW_SIZE];
+		PacketWriter::put32(&payload[0], FramePackets);
+		PacketWriter::put32(&payload[4], Rejected);
+		PacketWriter::put32(&payload[8], Frames.getDropped());
+		Bytes p = packet(protocol::FLOW_CONTROL | protocol::REPLY, payload, sizeof(payload));
+		writeAll(Fd, &p[0], p.size());
+	}
+	int Fd;
+	int NumLeds;
+	int Baud;
+	Bytes Pixels;
+	LedBuffer Buffer0;
+	LedBuffer Buffer1;
+	LedBuffer Buffer2;
+	TripleBuffer Frames;
+	SoftCrc32 Crc;
+	PacketParser Parser;
+	FrameDecoder Decoder;
+	uint8_t Type;
+	uint8_t Arg;
+	bool HaveBase;
+	bool Acking;
+	uint32_t FramePackets;
+	uint32_t Rejected;
+	uint32_t Shown;
+	uint64_t StrandFree;
+	uint64_t Wire;
+};
+
+static int startFake(int numLeds, int baud, pid_t *child) {
+	int master, slave;
+	struct termios tio;
+	if (openpty(&master, &slave, 0, 0, 0) != 0) {
+		perror("openpty");
+		return -1;
+	}
+	tcgetattr(slave, &tio);
+	cfmakeraw(&tio);
+	tcsetattr(slave, TCSANOW, &tio);
+	*child = fork();
+	if (*child < 0) {
+		perror("fork");
+		return -1;
+	}
+	if (*child == 0) {
+		close(master);
+		signal(SIGINT, SIG_IGN);
+		FakeBoard board(slave, numLeds, baud);
+		_exit(board.run());
+	}
+	close(slave);
+	return master;
+}
+
+// ---- streamer ----
+
+struct FlowCounts {
+	uint32_t FramePackets;
+	uint32_t Rejected;
+	uint32_t Dropped;
+};
+
+class Streamer : public PacketHandler {
+public:
+	Streamer(int fd, int numLeds, int window, int keyInterval) :
+			Fd(fd), NumLeds(numLeds), Window(window), KeyInterval(keyInterval), Crc(), Parser(&Crc, this), Type(0),
+					Reply(), Current(), Base(), HaveReply(false), Acked(0), Lost(0), Sent(0), Late(0), Timeouts(0),
+					ForceKey(true), LastProgress(0), LastPoll(0), PayloadBytes(0), LinkBytes(0), Prev(numLeds * 3),
+					Payload(protocol::MAX_PAYLOAD) {
+	}
+	virtual void begin(uint8_t type, uint16_t len) {
+		Type = type;
+		Reply.assign(len, 0);
+	}
+	virtual void data(const uint8_t *bytes, uint16_t len, uint16_t offset) {
+		memcpy(&Reply[offset], bytes, len);
+	}
+	virtual void end(bool crcOk) {
+		if (!crcOk || Type != (protocol::FLOW_CONTROL | protocol::REPLY) || Reply.size() < protocol::FLOW_SIZE)
+			return;
+		FlowCounts c = { PacketWriter::get32(&Reply[0]), PacketWriter::get32(&Reply[4]), PacketWriter::get32(&Reply[8]) };
+		if (!HaveReply) {
+			// counts since power up, everything from here on is relative to them
+			Base = c;
+			HaveReply = true;
+		}
+		if (c.Rejected != Current.Rejected)
+			ForceKey = true;
+		Current = c;
+		uint64_t now = micros();
+		uint32_t acked = Current.FramePackets - Base.FramePackets + Lost;
+		if (acked > Sent)
+			acked = Sent;
+		for (; Acked < acked; Acked++) {
+			Latencies.push_back(now - SendTimes[Acked]);
+			LastProgress = now;
+		}
+	}
+	bool start() {
+		HaveReply = false;
+		for (int attempt = 0; attempt < 5 && !HaveReply; attempt++) {
+			if (!flowControl(true))
+				return false;
+			pump(micros() + 200000);
+		}
+		LastProgress = micros();
+		return HaveReply;
+	}
+	void stop() {
+		// give the last frames a chance to be acknowledged
+		uint64_t until = micros() + ACK_TIMEOUT_US;
+		while (inFlight() > 0 && micros() < until) {
+			pump(std::min(until, micros() + ACK_POLL_US));
+			if (inFlight() > 0)
+				flowControl(true);
+		}
+		flowControl(false);
+	}
+	// reads replies until one arrives or until
+	void pump(uint64_t until) {
+		uint8_t buf[256];
+		bool gotOne = false;
+		while (!gotOne && !Stop) {
+			uint64_t now = micros();
+			int timeout = now >= until ? 0 : (int) ((until - now + 999) / 1000);
+			struct pollfd pfd = { Fd, POLLIN, 0 };
+			if (poll(&pfd, 1, timeout) <= 0 || !(pfd.revents & POLLIN))
+				return;
+			ssize_t n = read(Fd, buf, sizeof(buf));
+			if (n <= 0)
+				return;
+			uint32_t before = Acked;
+			Parser.feed(buf, n);
+			gotOne = Acked != before || micros() >= until;
+		}
+	}
+	// waits for room in the window, false if the slot ends first
+	bool waitForWindow(uint64_t slotEnd) {
+		while (inFlight() >= (uint32_t) Window && !Stop) {
+			uint64_t now = micros();
+			if (now >= slotEnd)
+				return false;
+			if (now - LastProgress >= ACK_TIMEOUT_US) {
+				// a frame packet lost its header on the way, it will never be acknowledged
+				Lost += inFlight();
+				Acked = Sent;
+				Timeouts++;
+				ForceKey = true;
+				LastProgress = now;
+				break;
+			}
+			if (now - LastProgress >= ACK_POLL_US && now - LastPoll >= ACK_POLL_US) {
+				// the board skips a reply while the last one is still going out, ask for the counts
+				flowControl(true);
+				LastPoll = now;
+			}
+			pump(std::min(slotEnd, now + ACK_POLL_US / 4));
+		}
+		return true;
+	}
+	bool send(const uint8_t *frame) {
+		uint8_t format;
+		bool key = ForceKey || (Sent % KeyInterval) == 0;
+		uint32_t len = FrameEncoder::smallest(key ? 0 : &Prev[0], frame, NumLeds, &Payload[0], Payload.size(), format);
+		uint8_t type = format == FrameDecoder::RLE ? protocol::FRAME_RLE :
+				format == FrameDecoder::DELTA ? protocol::FRAME_DELTA : protocol::FRAME;
+		Bytes p = packet(type, &Payload[0], len);
+		if (inFlight() == 0)
+			LastProgress = micros();
+		SendTimes.push_back(micros());
+		Sent++;
+		ForceKey = false;
+		memcpy(&Prev[0], frame, Prev.size());
+		PayloadBytes += len;
+		LinkBytes += p.size();
+		return writeAll(Fd, &p[0], p.size());
+	}
+	void late() {
+		Late++;
+	}
+	uint32_t inFlight() const {return Sent - Acked;}
+	uint32_t getSent() const {return Sent;}
+	uint32_t getAcked() const {return Acked - Lost;}
+	uint32_t getLate() const {return Late;}
+	uint32_t getLost() const {return Lost;}
+	uint32_t getTimeouts() const {return Timeouts;}
+	uint32_t getRejected() const {return Current.Rejected - Base.Rejected;}
+	uint32_t getDropped() const {return Current.Dropped - Base.Dropped;}
+	//acknowledged and not overwritten before the strand got to it
+	uint32_t getShown() const {return getAcked() - getRejected() - getDropped();}
+	uint64_t getPayloadBytes() const {return PayloadBytes;}
+	uint64_t getLinkBytes() const {return LinkBytes;}
+	const std::vector<uint64_t> &getLatencies() const {return Latencies;}
+private:
+	bool flowControl(bool on) {
+		uint8_t arg = on ? 1 : 0;
+		Bytes p = packet(protocol::FLOW_CONTROL, &arg, 1);
+		return writeAll(Fd, &p[0], p.size());
+	}
+	int Fd;
+	int NumLeds;
+	int Window;
+	int KeyInterval;
+	SoftCrc32 Crc;
+	PacketParser Parser;
+	uint8_t Type;
+	Bytes Reply;
+	FlowCounts Current;
+	FlowCounts Base;
+	bool HaveReply;
+	// frames acknowledged or written off, Acked - Lost were really acknowledged
+	uint32_t Acked;
+	uint32_t Lost;
+	uint32_t Sent;
+	uint32_t Late;
+	uint32_t Timeouts;
+	bool ForceKey;
+	uint64_t LastProgress;
+	uint64_t LastPoll;
+	uint64_t PayloadBytes;
+	uint64_t LinkBytes;
+	Bytes Prev;
+	Bytes Payload;
+	std::vector<uint64_t> SendTimes;
+	std::vector<uint64_t> Latencies;
+};
+
+static double percentile(std::vector<uint64_t> v, double p) {
+	if (v.empty())
+		return 0;
+	std::sort(v.begin(), v.end());
+	return v[std::min(v.size() - 1, (size_t) (p * v.size()))] / 1000.0;
+}
+
+static double average(const std::vector<uint64_t> &v, size_t from) {
+	uint64_t sum = 0;
+	for (size_t i = from; i < v.size(); i++)
+		sum += v[i];
+	return v.size() > from ? sum / 1000.0 / (v.size() - from) : 0;
+}
+
+static void report(Streamer *s, double seconds, int numLeds) {
+	const std::vector<uint64_t> &lat = s->getLatencies();
+	uint64_t raw = (uint64_t) s->getSent() * numLeds * 3;
+	printf("%.1fs: %u sent (%.1f fps), %u acknowledged, %u shown (%.1f fps), %u late, %u lost, %u rejected, "
+			"%u overwritten\n", seconds, s->getSent(), s->getSent() / seconds, s->getAcked(), s->getShown(),
+			s->getShown() / seconds, s->getLate(), s->getLost(), s->getRejected(), s->getDropped());
+	printf("latency ms: avg %.2f p50 %.2f p99 %.2f max %.2f\n", average(lat, 0), percentile(lat, 0.5),
+			percentile(lat, 0.99), percentile(lat, 1.0));
+	printf("payload %.1f kB/s (%.1f%% of raw), link %.1f kB/s\n", s->getPayloadBytes() / seconds / 1000,
+			raw ? 100.0 * s->getPayloadBytes() / raw : 0, s->getLinkBytes() / seconds / 1000);
+}
+
+static Source *openSource(const char *name, int numLeds, bool loop) {
+	static const char *kinds[] = { "gen:rainbow", "gen:chase", "gen:fade", "gen:noise" };
+	for (int i = 0; i < 4; i++) {
+		if (strcmp(name, kinds[i]) == 0)
+			return new Generator((Generator::KIND) i, numLeds);
+	}
+	FILE *f = strcmp(name, "-") == 0 ? stdin : fopen(name, "rb");
+	if (!f) {
+		perror(name);
+		return 0;
+	}
+	return new FileSource(f, numLeds * 3, loop && f != stdin);
+}
+
+static void usage() {
+	fprintf(stderr, "usage: ledstream [-d device | -p] [-b baud] -n leds [-r fps] [-w window] [-k N] [-t seconds] "
+			"[-m fps] [-l] file|-|gen:rainbow|gen:chase|gen:fade|gen:noise\n");
+	exit(2);
+}
+
+int main(int argc, char *argv[]) {
+	const char *device = 0;
+	bool fake = false, loop = false;
+	int baud = 1000000, numLeds = 0, window = 2, keyInterval = 25, opt;
+	double fps = 50, seconds = 0, minFps = 0;
+	while ((opt = getopt(argc, argv, "d:pb:n:r:w:k:t:m:l")) != -1) {
+		switch (opt) {
+		case 'd':
+			device = optarg;
+			break;
+		case 'p':
+			fake = true;
+			break;
+		case 'b':
+			baud = atoi(optarg);
+			break;
+		case 'n':
+			numLeds = atoi(optarg);
+			break;
+		case 'r':
+			fps = atof(optarg);
+			break;
+		case 'w':
+			window = atoi(optarg);
+			break;
+		case 'k':
+			keyInterval = atoi(optarg);
+			break;
+		case 't':
+			seconds = atof(optarg);
+			break;
+		case 'm':
+			minFps = atof(optarg);
+			break;
+		case 'l':
+			loop = true;
+			break;
+		default:
+			usage();
+		}
+	}
+	if (argc - optind != 1 || (device == 0) == !fake || numLeds < 1 || numLeds * 3 > protocol::MAX_PAYLOAD
+			|| fps < 0 || window < 1 || keyInterval < 1 || baudConstant(baud) == 0)
+		usage();
+
+	Source *source = openSource(argv[optind], numLeds, loop);
+	pid_t child = -1;
+	int fd = fake ? startFake(numLeds, baud, &child) : openSerial(device, baud);
+	if (!source || fd < 0)
+		return 1;
+	signal(SIGINT, onSignal);
+	signal(SIGPIPE, SIG_IGN);
+
+	Streamer streamer(fd, numLeds, window, keyInterval);
+	if (!streamer.start()) {
+		fprintf(stderr, "no FLOW_CONTROL reply, is the board running a WS2812_PROTOCOL build?\n");
+		return 1;
+	}
+	Bytes frame(numLeds * 3);
+	uint64_t period = fps > 0 ? (uint64_t) (1000000 / fps) : 0;
+	uint64_t start = micros(), nextReport = start + 1000000;
+	uint32_t lastSent = 0, lastShown = 0;
+	size_t lastLatency = 0;
+	bool ok = true;
+	for (uint64_t slot = 0; !Stop && ok; slot++) {
+		uint64_t due = start + slot * period;
+		if (seconds > 0 && (period ? due : micros()) - start >= seconds * 1000000)
+			break;
+		if (!source->next(&frame[0]))
+			break;
+		while (micros() < due && !Stop)
+			streamer.pump(due);
+		// with no target rate the window alone sets the pace
+		if (!streamer.waitForWindow(period ? due + period : UINT64_MAX))
+			streamer.late();
+		else if (!Stop)
+			ok = streamer.send(&frame[0]);
+
+		uint64_t now = micros();
+		if (now >= nextReport) {
+			const std::vector<uint64_t> &lat = streamer.getLatencies();
+			fprintf(stderr, "%u fps sent, %u shown, %u late, %u rejected, %u overwritten, latency %.2f ms\n",
+					streamer.getSent() - lastSent, streamer.getShown() - lastShown, streamer.getLate(),
+					streamer.getRejected(), streamer.getDropped(), average(lat, lastLatency));
+			lastSent = streamer.getSent();
+			lastShown = streamer.getShown();
+			lastLatency = lat.size();
+			nextReport += 1000000;
+		}
+	}
+	if (!ok)
+		perror(fake ? "pty" : device);
+	double elapsed = (micros() - start) / 1000000.0;
+	streamer.stop();
+	report(&streamer, elapsed, numLeds);
+	close(fd);
+	if (child > 0)
+		waitpid(child, 0, 0);
+	delete source;
+	if (minFps > 0 && streamer.getShown() / elapsed < minFps) {
+		printf("below %.1f fps\n", minFps);
+		return 1;
+	}
+	return ok ? 0 : 1;
+}